@@ -0,0 +1,144 @@
+/* global D3NE, CosmoScout */
+
+/**
+ * Contour Node definition
+ *
+ * @typedef {Object} Node
+ * @property {(number|string)} id
+ * @property {{
+ *   activeFile: string,
+ *   lastTransferFunction: string,
+ * }} data
+ * @property {Function} addOutput
+ * @property {Function} addInput
+ * @property {Function} addControl
+ */
+
+/**
+ * Node which draws isolines of the first texture of the input
+ */
+class ContourNode {
+  /**
+   * Node Editor Component builder
+   *
+   * @param {Node} node
+   * @returns {Node} D3NE Node
+   */
+  builder(node) {
+    // Comma separated isovalues, sent when the input is left or on enter
+    const isovaluesControl = new D3NE.Control(
+        `<div class="row">
+        <div class="col-6 text">Values:</div>
+        <div class="col-6">
+          <input type="text" class="form-control"
+            id="contour-node_${node.id}-isovalues" placeholder="e.g. 1, 2.5" />
+        </div>
+      </div>`,
+        (element, _control) => {
+          element.querySelector(`#contour-node_${node.id}-isovalues`)
+              .addEventListener('change', (event) => {
+                window.callNative('ContourNode.setIsovalues', node.id,
+                                  event.target.value);
+              });
+        },
+    );
+
+    // Checkbox to hide the isolines without extracting them again
+    const enableControl = new D3NE.Control(
+        `<div class="row">
+        <div class="col-2">
+          <label class="checklabel">
+            <input type="checkbox" id="contour-node_${node.id}-set_enabled"
+              checked />
+            <i class="material-icons"></i>
+          </label>
+        </div>
+        <div class="col-10 text">Show</div>
+      </div>`,
+        (element, _control) => {
+          element.querySelector(`#contour-node_${node.id}-set_enabled`)
+              .addEventListener('click', (event) => {
+                window.callNative('ContourNode.setEnabled', node.id,
+                                  event.target.checked === true);
+              });
+        },
+    );
+
+    node.addControl(isovaluesControl);
+    node.addControl(enableControl);
+
+    node.addInput(
+        new D3NE.Input('Texture(s)', CosmoScout.vestecNE.sockets.TEXTURES));
+    node.addInput(new D3NE.Input(
+        'Transfer Function', CosmoScout.vestecNE.sockets.TRANSFER_FUNCTION));
+
+    node.data.activeFile = '';
+    node.data.lastTransferFunction = '';
+
+    return node;
+  }
+
+  /**
+   * Node Editor Worker function
+   * Sends the first file of the input and the transfer function when they
+   * changed
+   *
+   * @param {Node} node
+   * @param {Array} inputs - Texture, Transfer Function
+   * @param {Array} _outputs - Unused
+   */
+  worker(node, inputs, _outputs) {
+    let file = '';
+    const textures = inputs[0][0];
+    if (typeof textures === 'string') {
+      file = textures;
+    } else if (Array.isArray(textures) && textures.length > 0) {
+      file = textures[0];
+    }
+
+    if (node.data.activeFile !== file) {
+      node.data.activeFile = file;
+      window.callNative('ContourNode.setFile', node.id, file);
+    }
+
+    const transferFunction = inputs[1][0];
+    if (typeof transferFunction !== 'undefined' &&
+        node.data.lastTransferFunction !== transferFunction) {
+      node.data.lastTransferFunction = transferFunction;
+      window.callNative('ContourNode.setTransferFunction', node.id,
+                        transferFunction);
+    }
+  }
+
+  /**
+   * Node Editor Component
+   *
+   * @returns {D3NE.Component}
+   * @throws {Error}
+   */
+  getComponent() {
+    this._checkD3NE();
+
+    return new D3NE.Component('ContourNode', {
+      builder : this.builder.bind(this),
+      worker : this.worker.bind(this),
+    });
+  }
+
+  /**
+   * Check if D3NE is available
+   *
+   * @throws {Error}
+   * @private
+   */
+  _checkD3NE() {
+    if (typeof D3NE === 'undefined') {
+      throw new Error('D3NE is not defined.');
+    }
+  }
+}
+
+(() => {
+  const contourNode = new ContourNode();
+  CosmoScout.vestecNE.addNode('ContourNode', contourNode.getComponent());
+})();
@@ -47,6 +47,7 @@
  *   },
  *
  *   downloadStatus: Map,
+ *   archiveFiles: Map,
  * }} data
  * @property {Function} addOutput
  * @property {Function} addInput
@@ -66,6 +67,19 @@ class IncidentNode {
    */
   static NUM_WORKITEMS_PER_STAGE = 2;
 
+  /**
+   * Dataset types which are extracted after the download. TTK and the
+   * persistence renderer only read regular files, all other zip archives are
+   * read directly by CosmoScout
+   *
+   * @type {string[]}
+   */
+  static extractedTypes = [
+    'CINEMA_DB_JSON',
+    'CINEMA_DB_PATH',
+    'MOSQUITO TOPOLOGICAL OUTPUT',
+  ];
+
   /**
    * Supported output types
    *
@@ -403,6 +417,7 @@ class IncidentNode {
     node.data.simulationUpdateInterval = null;
 
     node.data.downloadStatus = new Map();
+    node.data.archiveFiles = new Map();
 
     CosmoScout.vestecNE.updateEditor();
 
@@ -699,7 +714,8 @@ class IncidentNode {
       // Status will be updated by CosmoScout, only calls download / extract
       // once
       if (!node.data.downloadStatus.has(metadata.uuid)) {
-        if (metadata.name.includes('.zip')) {
+        if (metadata.name.includes('.zip') &&
+            IncidentNode.extractedTypes.includes(metadata.type)) {
           // TODO: The TTK Reader requires that the db folder ends with .cdb,
           // this hard code should be removed
           const addCDB = metadata.type === 'MOSQUITO TOPOLOGICAL OUTPUT';
@@ -715,6 +731,9 @@ class IncidentNode {
         node.data.downloadStatus.set(metadata.uuid, false);
       }
 
+      // Files of archives which are not extracted, undefined otherwise
+      const archiveFiles = node.data.archiveFiles.get(metadata.uuid);
+
       // This creates the corresponding output object based on the metadata type
       switch (metadata.type) {
       case 'CINEMA_DB_JSON': {
@@ -733,6 +752,11 @@ class IncidentNode {
       case 'CINEMA_DB':
         datasetOutput = `${CosmoScout.vestec.downloadDir}/extracted/${id}/${
             metadata.name.replace('.zip', '')}`;
+
+        if (typeof archiveFiles !== 'undefined') {
+          datasetOutput = `/vsizip/{${CosmoScout.vestec.downloadDir}/${id}}/${
+              metadata.name.replace('.zip', '')}`;
+        }
         break;
 
       case 'MOSQUITO TOPOLOGICAL OUTPUT':
@@ -740,6 +764,10 @@ class IncidentNode {
         break;
 
       default:
+        // Textures in an archive are offered as a set of files
+        if (typeof archiveFiles !== 'undefined') {
+          datasetOutput = archiveFiles;
+        }
         break;
       }
 
@@ -1302,6 +1330,27 @@ class IncidentNode {
       node.data.downloadStatus.delete(datasetUuid);
     }
   }
+
+  /**
+   * Sets the files of a downloaded zip archive, which are read from the
+   * archive instead of being extracted
+   *
+   * Called by CosmoScout before the dataset is ready
+   *
+   * @param {Number} nodeId
+   * @param {String} datasetUuid
+   * @param {String} files JSON array of file paths within the archive
+   */
+  static setArchiveFiles(nodeId, datasetUuid, files) {
+    const node = CosmoScout.vestecNE.editor.nodes.find(
+        (editorNode) => editorNode.id === nodeId);
+
+    if (typeof node === 'undefined') {
+      return;
+    }
+
+    node.data.archiveFiles.set(datasetUuid, JSON.parse(files));
+  }
 }
 
 (() => {
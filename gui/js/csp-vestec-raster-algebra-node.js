@@ -0,0 +1,167 @@
+/* global D3NE, CosmoScout */
+
+/**
+ * Raster Algebra Node definition
+ *
+ * @typedef {Object} Node
+ * @property {(number|string)} id
+ * @property {{
+ *   expressionInput: HTMLInputElement,
+ *   status: HTMLDivElement,
+ *   lastRequest: string,
+ *   result: string,
+ * }} data
+ * @property {Function} addOutput
+ * @property {Function} addInput
+ * @property {Function} addControl
+ */
+
+/**
+ * Node which derives a texture from up to four input textures with an
+ * expression. The first texture of each input is a variable (a to d)
+ */
+class RasterAlgebraNode {
+  static variables = [ 'a', 'b', 'c', 'd' ];
+
+  /**
+   * Node Editor Component builder
+   *
+   * @param {Node} node
+   * @returns {Node} D3NE Node
+   */
+  builder(node) {
+    // Text field for the expression, evaluated when it is confirmed
+    const expressionControl = new D3NE.Control(
+        `<div>
+        <div class="row">
+          <div class="col-4 text">Expression:</div>
+          <div class="col-8">
+            <input id="raster_algebra_node_expression_${
+            node.id}" type="text" value="a" style="display: block; width: 100%" />
+          </div>
+        </div>
+        <div class="row">
+          <div class="col-12 text" id="raster_algebra_node_status_${
+            node.id}"></div>
+        </div>
+      </div>`,
+        (element, control) => {
+          const input = element.querySelector(
+              `#raster_algebra_node_expression_${node.id}`);
+          input.addEventListener('change',
+                                 () => { CosmoScout.vestecNE.updateEditor(); });
+
+          control.putData('expressionInput', input);
+          control.putData(
+              'status',
+              element.querySelector(`#raster_algebra_node_status_${node.id}`));
+        },
+    );
+
+    node.addControl(expressionControl);
+
+    // Define the input and output types
+    RasterAlgebraNode.variables.forEach((variable) => {
+      node.addInput(new D3NE.Input(`Texture ${variable}`,
+                                   CosmoScout.vestecNE.sockets.TEXTURES));
+    });
+
+    node.addOutput(
+        new D3NE.Output('Texture', CosmoScout.vestecNE.sockets.TEXTURES));
+    return node;
+  }
+
+  /**
+   * Node Editor Worker function
+   * Requests an evaluation when the expression or an input changed
+   *
+   * @param {Node} node
+   * @param {Array} inputs - Textures a to d
+   * @param {Array} outputs - Texture
+   */
+  worker(node, inputs, outputs) {
+    // Variables after the last connected input are not needed
+    const files = inputs.map((input) => {
+      const textures = input[0];
+      if (typeof textures === 'string') {
+        return textures;
+      }
+      return Array.isArray(textures) && textures.length > 0 ? textures[0] : '';
+    });
+    while (files.length > 0 && files[files.length - 1] === '') {
+      files.pop();
+    }
+
+    const expression = node.data.expressionInput.value;
+    const request = JSON.stringify({expression, files});
+
+    if (files.length > 0 && !files.includes('') &&
+        node.data.lastRequest !== request) {
+      node.data.lastRequest = request;
+      node.data.result = undefined;
+      node.data.status.textContent = 'Computing...';
+      window.callNative('RasterAlgebraNode.evaluate', node.id, request);
+    }
+
+    if (typeof node.data.result !== 'undefined') {
+      outputs[0] = [ node.data.result ];
+    }
+  }
+
+  /**
+   * Node Editor Component
+   *
+   * @returns {D3NE.Component}
+   * @throws {Error}
+   */
+  getComponent() {
+    this._checkD3NE();
+
+    return new D3NE.Component('RasterAlgebraNode', {
+      builder : this.builder.bind(this),
+      worker : this.worker.bind(this),
+    });
+  }
+
+  /**
+   * Check if D3NE is available
+   *
+   * @throws {Error}
+   * @private
+   */
+  _checkD3NE() {
+    if (typeof D3NE === 'undefined') {
+      throw new Error('D3NE is not defined.');
+    }
+  }
+
+  /**
+   * Sets the path of the computed texture and passes it on
+   *
+   * @param {Number} id
+   * @param {string} path Empty if the expression could not be evaluated
+   * @param {string} error Description of the problem
+   */
+  static setResult(id, path, error) {
+    const node = CosmoScout.vestecNE.editor.nodes.find(node => node.id === id);
+
+    if (typeof node === 'undefined') {
+      return;
+    }
+
+    node.data.status.textContent = error;
+
+    if (path === '') {
+      return;
+    }
+
+    node.data.result = path;
+    CosmoScout.vestecNE.updateEditor();
+  }
+}
+
+(() => {
+  const rasterAlgebraNode = new RasterAlgebraNode();
+  CosmoScout.vestecNE.addNode('RasterAlgebraNode',
+                              rasterAlgebraNode.getComponent());
+})();
@@ -120,6 +120,52 @@ class TextureRenderNode {
         },
     );
 
+    // Checkbox to fit the data range to the displayed pixels
+    const autoRangeControl = new D3NE.Control(
+        `<div class="row">
+        <div class="col-2">
+          <label class="checklabel">
+            <input type="checkbox" id="texture-node_${
+            node.id}-set_auto_range" />
+            <i class="material-icons"></i>
+          </label>
+        </div>
+        <div class="col-10 text">Auto Range</div>
+      </div>`,
+        (element, _control) => {
+          element.querySelector(`#texture-node_${node.id}-set_auto_range`)
+              .addEventListener('click', (event) => {
+                window.callNative('TextureRenderNode.setAutoRange', node.id,
+                                  event.target.checked === true);
+              });
+        },
+    );
+
+    // Value of the texture under the cursor, hidden if there is none
+    const probeControl = new D3NE.Control(
+        `<div class="row" id="texture-node_${node.id}-probe_group">
+        <div class="col-6 text">Value:</div>
+        <div class="col-6 text" id="texture-node_${node.id}-probe_value"></div>
+      </div>`,
+        (element, _control) => { $(element).hide(); },
+    );
+
+    // Values of all layers under the cursor, only for multi layer files
+    const probeSeriesControl = new D3NE.Control(
+        `<div class="row" id="texture-node_${node.id}-probe_series_group">
+        <div class="col-6 text" id="texture-node_${
+            node.id}-probe_series_range"></div>
+        <div class="col-6">
+          <svg viewBox="0 0 100 30" preserveAspectRatio="none" width="100%"
+            height="30">
+            <path fill="none" stroke="currentColor" stroke-width="1.5"
+              vector-effect="non-scaling-stroke" />
+          </svg>
+        </div>
+      </div>`,
+        (element, _control) => { $(element).hide(); },
+    );
+
     //
     const textureSelectControl = new D3NE.Control(
         `<select id="texture-node_${
@@ -170,6 +216,9 @@ class TextureRenderNode {
     node.addControl(opacityControl);
     node.addControl(timeControl);
     node.addControl(layerControl);
+    node.addControl(autoRangeControl);
+    node.addControl(probeControl);
+    node.addControl(probeSeriesControl);
     node.addControl(textureSelectControl);
     node.addControl(mipMapReduceMode);
     node.addControl(mipMapLevelControl);
@@ -443,6 +492,77 @@ class TextureRenderNode {
     }
 
     node.data.range = [ min, max ];
+
+    // Lets a connected transfer function follow the new range
+    CosmoScout.vestecNE.updateEditor();
+  }
+
+  /**
+   * Shows the value of the texture under the cursor
+   * @param {Number} id
+   * @param {(Number|string)} value Empty if there is no value
+   */
+  static setProbeValue(id, value) {
+    const group = document.querySelector(`#texture-node_${id}-probe_group`);
+
+    if (group === null) {
+      return;
+    }
+
+    if (value === '') {
+      $(group).hide();
+      return;
+    }
+
+    document.querySelector(`#texture-node_${id}-probe_value`).textContent =
+        Number(value).toPrecision(4);
+    $(group).show();
+  }
+
+  /**
+   * Shows the values of all layers under the cursor as a line chart
+   * @param {Number} id
+   * @param {string} json Array of the values, null for layers without data.
+   *   Empty if there is no series
+   */
+  static setProbeSeries(id, json) {
+    const group =
+        document.querySelector(`#texture-node_${id}-probe_series_group`);
+
+    if (group === null) {
+      return;
+    }
+
+    const series = json === '' ? [] : JSON.parse(json);
+    const values = series.filter(value => value !== null);
+    if (values.length < 2) {
+      $(group).hide();
+      return;
+    }
+
+    const min = Math.min(...values);
+    const max = Math.max(...values);
+    const range = max > min ? max - min : 1;
+
+    // The chart spans the view box, layers without data split the line
+    const step = 100 / (series.length - 1);
+    let path = '';
+    let isGap = true;
+    series.forEach((value, i) => {
+      if (value === null) {
+        isGap = true;
+        return;
+      }
+      const x = (i * step).toFixed(1);
+      const y = (30 - (value - min) / range * 30).toFixed(1);
+      path += `${isGap ? 'M' : 'L'}${x} ${y} `;
+      isGap = false;
+    });
+
+    group.querySelector('path').setAttribute('d', path);
+    document.querySelector(`#texture-node_${id}-probe_series_range`)
+        .textContent = `${min.toPrecision(4)} - ${max.toPrecision(4)}`;
+    $(group).show();
   }
 
   /**
@@ -0,0 +1,167 @@
+/* global D3NE, CosmoScout */
+
+/**
+ * Zonal Statistics Node definition
+ *
+ * @typedef {Object} Node
+ * @property {(number|string)} id
+ * @property {{
+ *   activeFile: string,
+ * }} data
+ * @property {Function} addOutput
+ * @property {Function} addInput
+ * @property {Function} addControl
+ */
+
+/**
+ * Node which shows statistics of the first texture of the input within the
+ * incident area
+ */
+class ZonalStatisticsNode {
+  static rows = [
+    [ 'pixels', 'Pixels' ],
+    [ 'sum', 'Sum' ],
+    [ 'mean', 'Mean' ],
+    [ 'min', 'Min' ],
+    [ 'max', 'Max' ],
+  ];
+
+  /**
+   * Node Editor Component builder
+   *
+   * @param {Node} node
+   * @returns {Node} D3NE Node
+   */
+  builder(node) {
+    // One row per value and a bar chart of the histogram below
+    const rows = ZonalStatisticsNode.rows
+                     .map(([ name, label ]) => `<div class="row">
+          <div class="col-6 text">${label}:</div>
+          <div class="col-6 text" id="zonal_statistics_node_${node.id}-${
+                              name}">-</div>
+        </div>`)
+                     .join('');
+
+    const statisticsControl = new D3NE.Control(
+        `<div>
+        ${rows}
+        <div class="row">
+          <div class="col-12" id="zonal_statistics_node_${node.id}-histogram"
+            style="display: flex; align-items: flex-end; height: 40px"></div>
+        </div>
+      </div>`,
+        (_element, _control) => {},
+    );
+
+    node.addControl(statisticsControl);
+
+    node.addInput(
+        new D3NE.Input('Texture(s)', CosmoScout.vestecNE.sockets.TEXTURES));
+
+    return node;
+  }
+
+  /**
+   * Node Editor Worker function
+   * Sends the first file of the input when it changed
+   *
+   * @param {Node} node
+   * @param {Array} inputs - Texture
+   * @param {Array} _outputs - Unused
+   */
+  worker(node, inputs, _outputs) {
+    let file = '';
+    const textures = inputs[0][0];
+    if (typeof textures === 'string') {
+      file = textures;
+    } else if (Array.isArray(textures) && textures.length > 0) {
+      file = textures[0];
+    }
+
+    if (node.data.activeFile !== file) {
+      node.data.activeFile = file;
+      window.callNative('ZonalStatisticsNode.setFile', node.id, file);
+    }
+  }
+
+  /**
+   * Node Editor Component
+   *
+   * @returns {D3NE.Component}
+   * @throws {Error}
+   */
+  getComponent() {
+    this._checkD3NE();
+
+    return new D3NE.Component('ZonalStatisticsNode', {
+      builder : this.builder.bind(this),
+      worker : this.worker.bind(this),
+    });
+  }
+
+  /**
+   * Check if D3NE is available
+   *
+   * @throws {Error}
+   * @private
+   */
+  _checkD3NE() {
+    if (typeof D3NE === 'undefined') {
+      throw new Error('D3NE is not defined.');
+    }
+  }
+
+  /**
+   * Shows the statistics of the texture within the incident area
+   *
+   * @param {Number} id
+   * @param {string} json Statistics, empty if there are none
+   */
+  static setStatistics(id, json) {
+    const histogram =
+        document.querySelector(`#zonal_statistics_node_${id}-histogram`);
+
+    if (histogram === null) {
+      return;
+    }
+
+    const statistics = json === '' ? undefined : JSON.parse(json);
+    const valid =
+        typeof statistics !== 'undefined' && statistics.validPixels > 0;
+
+    ZonalStatisticsNode.rows.forEach(([ name ]) => {
+      const element =
+          document.querySelector(`#zonal_statistics_node_${id}-${name}`);
+
+      if (typeof statistics === 'undefined') {
+        element.textContent = '-';
+      } else if (name === 'pixels') {
+        element.textContent =
+            `${statistics.validPixels} / ${statistics.pixels}`;
+      } else {
+        element.textContent =
+            valid ? Number(statistics[name]).toPrecision(4) : '-';
+      }
+    });
+
+    histogram.innerHTML = '';
+    if (!valid) {
+      return;
+    }
+
+    const highest = Math.max(...statistics.histogram);
+    statistics.histogram.forEach((count) => {
+      const bar = document.createElement('div');
+      bar.style.flex = '1';
+      bar.style.height = `${100 * count / highest}%`;
+      bar.style.background = 'currentColor';
+      histogram.appendChild(bar);
+    });
+  }
+}
+
+(() => {
+  const zonalStatisticsNode = new ZonalStatisticsNode();
+  CosmoScout.vestecNE.addNode('ZonalStatisticsNode',
+                              zonalStatisticsNode.getComponent());
+})();
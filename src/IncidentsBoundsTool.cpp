@@ -251,7 +251,13 @@ void IncidentsBoundsTool::updateLineVertices() {
     ++currMark;
   }
 
-  mBoundingBox = boundingBox;
+  pBoundingBox = boundingBox;
+
+  std::vector<glm::dvec2> polygon;
+  for (auto const &mark : mPoints) {
+    polygon.push_back(mark->pLngLat.get());
+  }
+  pPolygon = polygon;
 
   // Last line to draw a polygon instead of a path
   currMark = mPoints.begin();
@@ -474,9 +480,13 @@ void IncidentsBoundsTool::reset() {
   mSampledPositions.clear();
   mIndexCount = 0;
   mVerticesDirty = true;
+  pBoundingBox = glm::dvec4(0.0);
+  pPolygon = std::vector<glm::dvec2>();
 
   pStartPosition.disconnectAll();
   pEndPosition.disconnectAll();
+  pBoundingBox.disconnectAll();
+  pPolygon.disconnectAll();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
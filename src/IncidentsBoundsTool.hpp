@@ -34,6 +34,14 @@ public:
   cs::utils::Property<glm::dvec2> pStartPosition = {};
   cs::utils::Property<glm::dvec2> pEndPosition = {};
 
+  /// Bounding box of the polygon in radians: minLng, maxLng, minLat, maxLat.
+  /// All zero if the polygon is empty
+  cs::utils::Property<glm::dvec4> pBoundingBox = glm::dvec4(0.0);
+
+  /// Corners of the polygon in radians (lng, lat). Empty if the polygon is
+  /// empty
+  cs::utils::Property<std::vector<glm::dvec2>> pPolygon;
+
   IncidentsBoundsTool(
       std::shared_ptr<cs::core::InputManager> const &pInputManager,
       std::shared_ptr<cs::core::SolarSystem> const &pSolarSystem,
@@ -111,9 +119,6 @@ private:
 
   int mScaleConnection = -1;
 
-  // minLng,maxLng,minLat,maxLat
-  glm::dvec4 mBoundingBox = glm::dvec4(0.0);
-
   static const int NUM_SAMPLES;
   static const char *SHADER_VERT;
   static const char *SHADER_FRAG;
@@ -81,6 +81,19 @@ public:
     return dynamic_cast<T *>(it->second);
   }
 
+  /**
+   * Retrieve all vestec nodes of a type
+   */
+  template <typename T> std::vector<T *> GetNodes() const {
+    std::vector<T *> nodes;
+    for (auto const &entry : m_mapNodes) {
+      if (auto *node = dynamic_cast<T *>(entry.second)) {
+        nodes.push_back(node);
+      }
+    }
+    return nodes;
+  }
+
 private:
   cs::gui::GuiItem *m_pWebView;
 
@@ -18,20 +18,32 @@
 #include <VistaKernel/GraphicsManager/VistaSceneGraph.h>
 #include <VistaKernel/VistaSystem.h>
 
+#include "common/CompressedRasterCache.hpp"
+#include "common/ContourExtractor.hpp"
+#include "common/GDALReader.hpp"
+#include "common/GridResampler.hpp"
+#include "common/RasterDiskCache.hpp"
+#include "common/RasterLoader.hpp"
+#include "common/RasterPrefetcher.hpp"
+#include "common/TimeSeriesStack.hpp"
+
 // Include VESTEC nodes
 #include "VestecNodes/CinemaDBNode.hpp"
+#include "VestecNodes/ContourNode.hpp"
 #include "VestecNodes/CriticalPointsNode.hpp"
 #include "VestecNodes/DiseasesSensorInputNode.hpp"
 #include "VestecNodes/DiseasesSimulationNode.hpp"
 #include "VestecNodes/IncidentConfigNode.hpp"
 #include "VestecNodes/IncidentNode.hpp"
 #include "VestecNodes/PersistenceNode.hpp"
+#include "VestecNodes/RasterAlgebraNode.hpp"
 #include "VestecNodes/TextureLoaderNode.hpp"
 #include "VestecNodes/TextureRenderNode.hpp"
 #include "VestecNodes/TextureUploadNode.hpp"
 #include "VestecNodes/TransferFunctionSourceNode.hpp"
 #include "VestecNodes/UncertaintyRenderNode.hpp"
 #include "VestecNodes/WildFireSourceNode.hpp"
+#include "VestecNodes/ZonalStatisticsNode.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -49,6 +61,9 @@ std::string csp::vestec::Plugin::vestecServer;
 std::string csp::vestec::Plugin::vestecDownloadDir;
 std::string csp::vestec::Plugin::vestecDiseasesDir;
 std::string csp::vestec::Plugin::vestecTexturesDir;
+std::mutex csp::vestec::Plugin::mIncidentBoundsMutex;
+std::optional<std::array<double, 4>> csp::vestec::Plugin::mIncidentBounds;
+std::vector<std::array<double, 2>> csp::vestec::Plugin::mIncidentPolygon;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -65,6 +80,23 @@ void from_json(nlohmann::json const &j, Plugin::Settings &o) {
                                   o.mVestecDownloadDir);
   cs::core::Settings::deserialize(j, "vestec-textures-dir",
                                   o.mVestecTexturesDir);
+  cs::core::Settings::deserialize(j, "vestec-texture-cache-size",
+                                  o.mTextureCacheSize);
+  cs::core::Settings::deserialize(j, "vestec-compressed-cache-size",
+                                  o.mCompressedCacheSize);
+  cs::core::Settings::deserialize(j, "vestec-time-series-cache-size",
+                                  o.mTimeSeriesCacheSize);
+  cs::core::Settings::deserialize(j, "vestec-aligned-cache-size",
+                                  o.mAlignedCacheSize);
+  cs::core::Settings::deserialize(j, "vestec-raster-cache-dir",
+                                  o.mRasterCacheDir);
+  cs::core::Settings::deserialize(j, "vestec-raster-cache-size",
+                                  o.mRasterCacheSize);
+  cs::core::Settings::deserialize(j, "vestec-warp-threads", o.mWarpThreads);
+  cs::core::Settings::deserialize(j, "vestec-raster-storage", o.mRasterStorage);
+  cs::core::Settings::deserialize(j, "vestec-prefetch-layers",
+                                  o.mPrefetchLayers);
+  cs::core::Settings::deserialize(j, "vestec-crop-nodata", o.mCropNoData);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -163,6 +195,30 @@ void Plugin::init() {
               "CosmoScout.vestec.setEndLatLong", data);
         });
 
+        mTool->pBoundingBox.connect([](glm::dvec4 const &box) {
+          if (box == glm::dvec4(0.0)) {
+            Plugin::setIncidentBounds(std::nullopt);
+          } else {
+            Plugin::setIncidentBounds(
+                std::array<double, 4>{box.x, box.y, box.z, box.w});
+          }
+        });
+
+        // Statistics over the area are updated while a corner is dragged
+        mTool->pPolygon.connect(
+            [this](std::vector<glm::dvec2> const &corners) {
+              std::vector<std::array<double, 2>> polygon;
+              for (auto const &corner : corners) {
+                polygon.push_back({corner.x, corner.y});
+              }
+              Plugin::setIncidentPolygon(polygon);
+
+              for (auto *node :
+                   m_pNodeEditor->GetNodes<ZonalStatisticsNode>()) {
+                node->SetPolygon(polygon);
+              }
+            });
+
         mPointsActive = true;
       }));
 
@@ -194,11 +250,72 @@ void Plugin::init() {
   Plugin::vestecDiseasesDir = mPluginSettings.mDiseasesDir;
   Plugin::vestecTexturesDir = mPluginSettings.mVestecTexturesDir;
 
+  if (mPluginSettings.mTextureCacheSize) {
+    GDALReader::SetCacheBudget(
+        static_cast<size_t>(mPluginSettings.mTextureCacheSize.value()) * 1024 *
+        1024);
+  }
+
+  if (mPluginSettings.mCompressedCacheSize) {
+    CompressedRasterCache::SetBudget(
+        static_cast<size_t>(mPluginSettings.mCompressedCacheSize.value()) *
+        1024 * 1024);
+  }
+
+  if (mPluginSettings.mTimeSeriesCacheSize) {
+    TimeSeriesStack::SetCacheBudget(
+        static_cast<size_t>(mPluginSettings.mTimeSeriesCacheSize.value()) *
+        1024 * 1024);
+  }
+
+  if (mPluginSettings.mAlignedCacheSize) {
+    GridResampler::SetCacheBudget(
+        static_cast<size_t>(mPluginSettings.mAlignedCacheSize.value()) * 1024 *
+        1024);
+  }
+
+  if (mPluginSettings.mWarpThreads) {
+    GDALReader::SetWarpThreads(
+        static_cast<int>(mPluginSettings.mWarpThreads.value()));
+  }
+
+  if (mPluginSettings.mPrefetchLayers) {
+    RasterPrefetcher::SetMaxLayers(
+        static_cast<int>(mPluginSettings.mPrefetchLayers.value()));
+  }
+
+  if (mPluginSettings.mRasterStorage) {
+    GDALReader::Storage storage;
+    if (GDALReader::ParseStorage(mPluginSettings.mRasterStorage.value(),
+                                 storage)) {
+      GDALReader::SetStorage(storage);
+    } else {
+      logger().warn("Unknown raster storage '{}', using '{}'",
+                    mPluginSettings.mRasterStorage.value(),
+                    GDALReader::GetStorageName(GDALReader::GetStorage()));
+    }
+  }
+
+  if (mPluginSettings.mCropNoData) {
+    GDALReader::SetCropping(mPluginSettings.mCropNoData.value());
+  }
+
   if (!boost::filesystem::exists(mPluginSettings.mVestecDownloadDir)) {
     cs::utils::filesystem::createDirectoryRecursively(
         mPluginSettings.mVestecDownloadDir + "/extracted");
   }
 
+  if (mPluginSettings.mRasterCacheSize) {
+    RasterDiskCache::SetBudget(
+        static_cast<uint64_t>(mPluginSettings.mRasterCacheSize.value()) *
+        1024 * 1024);
+  }
+
+  // Warped rasters are cached next to the downloads unless configured
+  // otherwise, an empty directory disables the cache
+  RasterDiskCache::SetDirectory(mPluginSettings.mRasterCacheDir.value_or(
+      mPluginSettings.mVestecDownloadDir + "/raster-cache"));
+
   // Initialize vestec flow editor
   m_pNodeEditor = new VNE::NodeEditor(mGuiManager->getGui());
 
@@ -277,6 +394,20 @@ void Plugin::init() {
       },
       [](VNE::NodeEditor *editor) { IncidentConfigNode::Init(editor); });
 
+  m_pNodeEditor->RegisterNodeType(
+      RasterAlgebraNode::GetName(), "Operations",
+      [](cs::gui::GuiItem *webView, int id) {
+        return new RasterAlgebraNode(webView, id);
+      },
+      [](VNE::NodeEditor *editor) { RasterAlgebraNode::Init(editor); });
+
+  m_pNodeEditor->RegisterNodeType(
+      ZonalStatisticsNode::GetName(), "Operations",
+      [](cs::gui::GuiItem *webView, int id) {
+        return new ZonalStatisticsNode(webView, id);
+      },
+      [](VNE::NodeEditor *editor) { ZonalStatisticsNode::Init(editor); });
+
   m_pNodeEditor->RegisterNodeType(
       PersistenceNode::GetName(), "Renderer",
       [](cs::gui::GuiItem *webView, int id) {
@@ -302,6 +433,15 @@ void Plugin::init() {
       },
       [](VNE::NodeEditor *editor) { CriticalPointsNode::Init(editor); });
 
+  m_pNodeEditor->RegisterNodeType(
+      ContourNode::GetName(), "Renderer",
+      [this](cs::gui::GuiItem *webView, int id) {
+        return new ContourNode(mPluginSettings, webView, id, mSolarSystem.get(),
+                               mVestecTransform.get(), mGraphicsEngine.get(),
+                               mAllSettings);
+      },
+      [](VNE::NodeEditor *editor) { ContourNode::Init(editor); });
+
   // m_pNodeEditor->RegisterNodeType(
   //    UncertaintyRenderNode::GetName(), "Renderer",
   //    [this](cs::gui::GuiItem* webView, int id) {
@@ -328,6 +468,24 @@ void Plugin::deInit() {
   mSolarSystem->unregisterAnchor(mVestecTransform);
   mSceneGraph->GetRoot()->DisconnectChild(mVestecTransform.get());
   delete m_pNodeEditor;
+
+  // The nodes cancelled their loads, wait for the reads which are running
+  RasterLoader::Shutdown();
+  CompressedRasterCache::Shutdown();
+
+  // Nothing reads the rasters anymore, release their memory
+  clearCaches();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::clearCaches() {
+  // The derived caches are cleared first, they would otherwise keep data of
+  // rasters alive which are not cached anymore
+  TimeSeriesStack::ClearCache();
+  GridResampler::ClearCache();
+  ContourExtractor::ClearCache();
+  GDALReader::ClearCache();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -342,6 +500,53 @@ void Plugin::update() {
   if (mTool) {
     mTool->update();
   }
+
+  // Show the values under the cursor in the texture render nodes
+  std::optional<std::array<double, 2>> hoveredLngLat;
+  auto const &hovered = mInputManager->pHoveredObject.get();
+  auto body = std::dynamic_pointer_cast<cs::scene::CelestialBody>(
+      hovered.mObject);
+  if (body && body->getCenterName() == "Earth") {
+    glm::dvec2 lngLat = cs::utils::convert::cartesianToLngLat(
+        hovered.mPosition, body->getRadii());
+    hoveredLngLat = std::array<double, 2>{lngLat.x, lngLat.y};
+  }
+
+  // The nodes look the values up again only if the position or their texture
+  // changed, e.g. when a new layer finished loading below a resting cursor
+  for (auto *node : m_pNodeEditor->GetNodes<TextureRenderNode>()) {
+    node->SetProbePosition(hoveredLngLat);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<std::array<double, 4>> Plugin::getIncidentBounds() {
+  std::lock_guard<std::mutex> lock(mIncidentBoundsMutex);
+  return mIncidentBounds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::setIncidentBounds(
+    std::optional<std::array<double, 4>> const &bounds) {
+  std::lock_guard<std::mutex> lock(mIncidentBoundsMutex);
+  mIncidentBounds = bounds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::array<double, 2>> Plugin::getIncidentPolygon() {
+  std::lock_guard<std::mutex> lock(mIncidentBoundsMutex);
+  return mIncidentPolygon;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Plugin::setIncidentPolygon(
+    std::vector<std::array<double, 2>> const &polygon) {
+  std::lock_guard<std::mutex> lock(mIncidentBoundsMutex);
+  mIncidentPolygon = polygon;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -19,6 +19,8 @@
 
 #include "NodeEditor/NodeEditor.hpp"
 
+#include <array>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -34,6 +36,23 @@ public:
   static std::string
       vestecTexturesDir; ///< Textures to be loaded by the texture loader node
 
+  /**
+   * Bounds of the incident area selected with the IncidentsBoundsTool in
+   * radians (minLng, maxLng, minLat, maxLat), empty if no area is selected.
+   * Render nodes only load this region of their rasters. Thread safe
+   */
+  static std::optional<std::array<double, 4>> getIncidentBounds();
+  static void
+  setIncidentBounds(std::optional<std::array<double, 4>> const &bounds);
+
+  /**
+   * Corners of the incident area in radians (lng, lat), empty if no area is
+   * selected. Thread safe
+   */
+  static std::vector<std::array<double, 2>> getIncidentPolygon();
+  static void
+  setIncidentPolygon(std::vector<std::array<double, 2>> const &polygon);
+
   struct Settings {
     std::string mVestecDataDir; ///< Directory where cinemaDB is stored
     std::string
@@ -45,6 +64,27 @@ public:
     std::string mVestecDownloadDir; ///< Vestec Downloaded files location
 
     std::string mVestecTexturesDir; ///< Vestec Textures
+
+    std::optional<uint32_t>
+        mTextureCacheSize; ///< Memory budget of the texture cache in MB
+    std::optional<uint32_t>
+        mCompressedCacheSize; ///< Budget of compressed evicted textures in MB
+    std::optional<uint32_t>
+        mTimeSeriesCacheSize; ///< Budget of time major layer stacks in MB
+    std::optional<uint32_t>
+        mAlignedCacheSize; ///< Budget of rasters resampled to a common grid
+    std::optional<std::string>
+        mRasterCacheDir; ///< Directory of the persistent warped raster cache
+    std::optional<uint32_t>
+        mRasterCacheSize; ///< Budget of the raster cache directory in MB
+    std::optional<uint32_t>
+        mWarpThreads; ///< Threads used to warp a raster, 0 uses all cores
+    std::optional<std::string>
+        mRasterStorage; ///< Pixel type of warped rasters, e.g. "float16"
+    std::optional<uint32_t>
+        mPrefetchLayers; ///< Layers prefetched while scrubbing, 0 disables
+    std::optional<bool>
+        mCropNoData; ///< Crop the no data borders of warped rasters
   };
 
   // ------------------------------------------------
@@ -60,6 +100,12 @@ public:
   friend class Singleton<Plugin>;
 
 private:
+  /**
+   * Clears the raster caches and the caches of the stacks, aligned sets and
+   * isolines which are derived from the rasters
+   */
+  void clearCaches();
+
   Settings mPluginSettings;
   std::shared_ptr<cs::scene::CelestialAnchorNode> mVestecTransform;
 
@@ -69,6 +115,10 @@ private:
   std::shared_ptr<IncidentsBoundsTool> mTool;
 
   bool mPointsActive = false;
+
+  static std::mutex mIncidentBoundsMutex;
+  static std::optional<std::array<double, 4>> mIncidentBounds;
+  static std::vector<std::array<double, 2>> mIncidentPolygon;
 };
 
 } // namespace csp::vestec
@@ -0,0 +1,266 @@
+// Plugin Includes
+#include "ContourRenderer.hpp"
+
+// VISTA includes
+#include <VistaKernel/DisplayManager/VistaDisplayManager.h>
+#include <VistaKernel/DisplayManager/VistaProjection.h>
+#include <VistaKernel/DisplayManager/VistaViewport.h>
+#include <VistaKernel/VistaSystem.h>
+#include <VistaOGLExt/VistaBufferObject.h>
+#include <VistaOGLExt/VistaGLSLShader.h>
+#include <VistaOGLExt/VistaVertexArrayObject.h>
+
+// CosmoScout includes
+#include "../../../../src/cs-utils/FrameTimings.hpp"
+#include "../../../../src/cs-utils/convert.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// Lifts the isolines above the terrain so that they are not hidden by it
+const double LINE_HEIGHT = 10.0;
+
+struct Vertex {
+  glm::vec3 position; //! Relative to the origin of the renderer
+  float value;
+};
+
+} // namespace
+
+ContourRenderer::ContourRenderer(cs::core::SolarSystem *pSolarSystem,
+                                 std::shared_ptr<cs::core::Settings> settings)
+    : mTransferFunction(
+          std::make_unique<cs::graphics::ColorMap>(boost::filesystem::path(
+              "../share/resources/transferfunctions/BlackBody.json"))),
+      mSolarSystem(pSolarSystem), mSettings(std::move(settings)) {
+  csp::vestec::logger().debug("[ContourRenderer] Compiling shader");
+
+  m_pShader = new VistaGLSLShader();
+  m_pShader->InitVertexShaderFromString(CONTOUR_VERT);
+  m_pShader->InitFragmentShaderFromString(CONTOUR_FRAG);
+  m_pShader->Link();
+
+  // create buffers ----------------------------------------------------------
+  m_VBO = new VistaBufferObject();
+  m_VAO = new VistaVertexArrayObject();
+
+  m_VAO->EnableAttributeArray(0);
+  m_VAO->SpecifyAttributeArrayFloat(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                    0, m_VBO);
+  m_VAO->EnableAttributeArray(1);
+  m_VAO->SpecifyAttributeArrayFloat(1, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                    offsetof(Vertex, value), m_VBO);
+
+  // The vertices follow the terrain, so they change with its height scale
+  mScaleConnection = mSettings->mGraphics.pHeightScale.connect(
+      [this](float /*h*/) { mVerticesDirty = true; });
+
+  csp::vestec::logger().debug("[ContourRenderer] Compiling shader done");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ContourRenderer::~ContourRenderer() {
+  mSettings->mGraphics.pHeightScale.disconnect(mScaleConnection);
+
+  delete m_pShader;
+  delete m_VAO;
+  delete m_VBO;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourRenderer::SetIsolines(std::vector<Isoline> isolines) {
+  std::lock_guard<std::mutex> lock(mIsolinesMutex);
+  mIsolines = std::move(isolines);
+  mIsolinesChanged = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourRenderer::SetEnabled(bool enabled) { mEnabled = enabled; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourRenderer::SetTransferFunction(std::string json) {
+  mTransferFunction = std::make_unique<cs::graphics::ColorMap>(json);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourRenderer::UploadVertices() {
+  std::vector<Isoline> isolines;
+  {
+    // The polylines are shared, only the pointers are copied
+    std::lock_guard<std::mutex> lock(mIsolinesMutex);
+    isolines = mIsolines;
+  }
+
+  mFirsts.clear();
+  mCounts.clear();
+  mMinValue = std::numeric_limits<float>::max();
+  mMaxValue = std::numeric_limits<float>::lowest();
+
+  auto activeBody = mSolarSystem->pActiveBody.get();
+  glm::dvec3 radii = activeBody->getRadii();
+  double heightScale = mSettings->mGraphics.pHeightScale.get();
+
+  auto toCartesian = [&](std::array<double, 2> const &point) {
+    glm::dvec2 lngLat(point[0], point[1]);
+    double height = activeBody->getHeight(lngLat) * heightScale + LINE_HEIGHT;
+    return cs::utils::convert::toCartesian(lngLat, radii, height);
+  };
+
+  // The vertices are stored relative to a point of the first polyline, so that
+  // float precision suffices close to the isolines
+  mOrigin = glm::dvec3(0.0);
+  for (auto const &isoline : isolines) {
+    if (isoline.polylines && !isoline.polylines->empty() &&
+        !isoline.polylines->front().empty()) {
+      mOrigin = toCartesian(isoline.polylines->front().front());
+      break;
+    }
+  }
+
+  std::vector<Vertex> vertices;
+  for (auto const &isoline : isolines) {
+    if (!isoline.polylines) {
+      continue;
+    }
+
+    mMinValue = std::min(mMinValue, isoline.value);
+    mMaxValue = std::max(mMaxValue, isoline.value);
+
+    for (auto const &polyline : *isoline.polylines) {
+      mFirsts.push_back(static_cast<GLint>(vertices.size()));
+      mCounts.push_back(static_cast<GLsizei>(polyline.size()));
+
+      for (auto const &point : polyline) {
+        vertices.push_back(
+            {glm::vec3(toCartesian(point) - mOrigin), isoline.value});
+      }
+    }
+  }
+
+  if (!vertices.empty()) {
+    m_VBO->Bind(GL_ARRAY_BUFFER);
+    m_VBO->BufferData(vertices.size() * sizeof(Vertex), vertices.data(),
+                      GL_STATIC_DRAW);
+    m_VBO->Release();
+  }
+
+  csp::vestec::logger().debug(
+      "[ContourRenderer] Uploaded {} polylines with {} vertices",
+      mCounts.size(), vertices.size());
+  mVerticesDirty = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ContourRenderer::Do() {
+  {
+    std::lock_guard<std::mutex> lock(mIsolinesMutex);
+    if (mIsolinesChanged) {
+      mIsolinesChanged = false;
+      mVerticesDirty = true;
+    }
+  }
+
+  // Hidden isolines keep their vertices, showing them again is for free
+  if (!mEnabled) {
+    return false;
+  }
+
+  // get active planet
+  if (mSolarSystem->pActiveBody.get() == nullptr ||
+      mSolarSystem->pActiveBody.get()->getCenterName() != "Earth") {
+    return false;
+  }
+
+  if (mVerticesDirty) {
+    UploadVertices();
+  }
+
+  if (mCounts.empty()) {
+    return false;
+  }
+
+  cs::utils::FrameTimings::ScopedTimer timer("Render Contours");
+
+  glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_LINE_BIT);
+
+  // Enables alpha blending
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  // Enables and configures line rendering
+  glEnable(GL_LINE_SMOOTH);
+  glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+  glLineWidth(2);
+
+  double nearClip;
+  double farClip;
+
+  GetVistaSystem()
+      ->GetDisplayManager()
+      ->GetCurrentRenderInfo()
+      ->m_pViewport->GetProjection()
+      ->GetProjectionProperties()
+      ->GetClippingRange(nearClip, farClip);
+
+  // get matrices and related values -----------------------------------------
+  GLfloat glMatP[16];
+  glGetFloatv(GL_PROJECTION_MATRIX, &glMatP[0]);
+
+  // The translation to the origin is applied in double precision
+  glm::mat4 matModelView(
+      mSolarSystem->pActiveBody.get()->getWorldTransform() *
+      glm::translate(glm::dmat4(1.0), mOrigin));
+  // get matrices and related values -----------------------------------------
+
+  m_VAO->Bind();
+  m_pShader->Bind();
+
+  mTransferFunction->bind(GL_TEXTURE0);
+  m_pShader->SetUniform(m_pShader->GetUniformLocation("uTransferFunction"), 0);
+
+  int loc = m_pShader->GetUniformLocation("uMatP");
+  glUniformMatrix4fv(loc, 1, GL_FALSE, glMatP);
+  loc = m_pShader->GetUniformLocation("uMatMV");
+  glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(matModelView));
+
+  m_pShader->SetUniform(m_pShader->GetUniformLocation("uFarClip"),
+                        static_cast<float>(farClip));
+  m_pShader->SetUniform(m_pShader->GetUniformLocation("uMinValue"), mMinValue);
+  m_pShader->SetUniform(m_pShader->GetUniformLocation("uMaxValue"), mMaxValue);
+
+  // One line strip per polyline
+  glMultiDrawArrays(GL_LINE_STRIP, mFirsts.data(), mCounts.data(),
+                    static_cast<GLsizei>(mCounts.size()));
+
+  mTransferFunction->unbind(GL_TEXTURE0);
+
+  m_pShader->Release();
+  m_VAO->Release();
+
+  glPopAttrib();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ContourRenderer::GetBoundingBox(VistaBoundingBox &oBoundingBox) {
+  float fMin[3] = {-6371000.0f, -6371000.0f, -6371000.0f};
+  float fMax[3] = {6371000.0f, 6371000.0f, 6371000.0f};
+
+  oBoundingBox.SetBounds(fMin, fMax);
+
+  return true;
+}
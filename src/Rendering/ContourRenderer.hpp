@@ -0,0 +1,107 @@
+#ifndef CONTOUR_RENDERER
+#define CONTOUR_RENDERER
+
+#include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
+#include <VistaMath/VistaBoundingBox.h>
+
+#include "../../../../src/cs-core/Settings.hpp"
+#include "../../../../src/cs-core/SolarSystem.hpp"
+#include "../../../../src/cs-graphics/ColorMap.hpp"
+#include "../common/ContourExtractor.hpp"
+#include "../logger.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// FORWARD DEFINITIONS
+class VistaGLSLShader;
+class VistaBufferObject;
+class VistaVertexArrayObject;
+
+/**
+ * The Contour Renderer draws isolines on the terrain of the active body. Each
+ * isoline is colored by its value with the transfer function, the value range
+ * is given by the smallest and the largest value.
+ *
+ * The isolines can be hidden and shown again without extracting or uploading
+ * them again.
+ */
+class ContourRenderer : public IVistaOpenGLDraw {
+public:
+  /**
+   * The polylines of a single value
+   */
+  struct Isoline {
+    float value;
+    std::shared_ptr<const std::vector<ContourExtractor::Polyline>> polylines;
+  };
+
+  /**
+   * Constructor requires the SolarSystem to get the current active planet
+   * and the settings to follow the height scale of the terrain
+   */
+  ContourRenderer(cs::core::SolarSystem *pSolarSystem,
+                  std::shared_ptr<cs::core::Settings> settings);
+  virtual ~ContourRenderer();
+
+  /**
+   * Sets the isolines to render. They are uploaded with the next frame, so
+   * this may be called from any thread
+   */
+  void SetIsolines(std::vector<Isoline> isolines);
+
+  /**
+   * Shows or hides the isolines
+   * Default: true
+   */
+  void SetEnabled(bool enabled);
+
+  /**
+   * Sets the transfer function for the shader
+   */
+  void SetTransferFunction(std::string json);
+
+  // --------------------------------------------
+  // INTERFACE IMPLEMENTATION OF IVistaOpenGLDraw
+  // --------------------------------------------
+  virtual bool Do();
+  virtual bool GetBoundingBox(VistaBoundingBox &bb);
+
+private:
+  /**
+   * Converts the isolines to vertices on the terrain and uploads them
+   */
+  void UploadVertices();
+
+  bool mEnabled = true;        //! Whether the isolines are drawn
+  float mMinValue = 0;         //! Value range min
+  float mMaxValue = 1;         //! Value range max
+  bool mVerticesDirty = false; //! True if the vertices need to be uploaded
+
+  std::mutex mIsolinesMutex;      //! Guards the pending isolines
+  std::vector<Isoline> mIsolines; //! Isolines set by SetIsolines
+  bool mIsolinesChanged = false;  //! True if SetIsolines was called
+
+  VistaGLSLShader *m_pShader = nullptr; //! Vista GLSL shader object
+
+  static const std::string CONTOUR_VERT; //! Code for the vertex shader
+  static const std::string CONTOUR_FRAG; //! Code for the fragment shader
+
+  std::unique_ptr<cs::graphics::ColorMap>
+      mTransferFunction; //! Transfer function used in shader
+
+  cs::core::SolarSystem *mSolarSystem; //! Pointer to the CosmoScout solar
+                                       //! system used to retriev matrices
+  std::shared_ptr<cs::core::Settings> mSettings; //! To get the height scale
+  int mScaleConnection = -1; //! Connection to the height scale
+
+  glm::dvec3 mOrigin{}; //! Vertices are relative to this point on the body
+  std::vector<GLint> mFirsts;   //! First vertex of each polyline
+  std::vector<GLsizei> mCounts; //! Number of vertices of each polyline
+
+  VistaVertexArrayObject *m_VAO;
+  VistaBufferObject *m_VBO;
+};
+
+#endif // CONTOUR_RENDERER
@@ -0,0 +1,47 @@
+#include "ContourRenderer.hpp"
+#include <string>
+
+const std::string ContourRenderer::CONTOUR_VERT = R"(
+#version 330
+
+layout(location = 0) in vec3  iPosition;
+layout(location = 1) in float iValue;
+
+out vec4  vPosition;
+out float vValue;
+
+uniform mat4 uMatP;
+uniform mat4 uMatMV;
+
+void main()
+{
+    vPosition   = uMatMV * vec4(iPosition, 1.0);
+    vValue      = iValue;
+    gl_Position = uMatP * vPosition;
+}
+)";
+
+const std::string ContourRenderer::CONTOUR_FRAG = R"(
+#version 330
+
+in vec4  vPosition;
+in float vValue;
+
+uniform float     uFarClip;
+uniform float     uMinValue = 0;
+uniform float     uMaxValue = 1;
+uniform sampler1D uTransferFunction;
+
+layout(location = 0) out vec4 oColor;
+
+void main()
+{
+    // A single isoline takes the center of the transfer function
+    float value = uMaxValue > uMinValue
+                ? (vValue - uMinValue) / (uMaxValue - uMinValue)
+                : 0.5;
+    oColor = texture(uTransferFunction, value);
+
+    gl_FragDepth = length(vPosition.xyz) / uFarClip;
+}
+)";
@@ -59,6 +59,7 @@ uniform float         uOpacity = 1;
 uniform float         uTime    = 6;
 uniform bool          uUseTime = false;
 uniform dvec4         uBounds;
+uniform dvec4         uClipBounds; // Tiles are only drawn inside this area
 uniform vec2          uRange;
 uniform vec3          uRadii;
 
@@ -196,7 +197,9 @@ void main()
         double max_lat   = uBounds.y;
 
         if(lnglat.x > min_long && lnglat.x < max_long &&
-        lnglat.y > min_lat && lnglat.y < max_lat)
+        lnglat.y > min_lat && lnglat.y < max_lat &&
+        lnglat.x > uClipBounds.x && lnglat.x <= uClipBounds.z &&
+        lnglat.y > uClipBounds.w && lnglat.y <= uClipBounds.y)
         {
             double norm_u = (lnglat.x - min_long) / (max_long - min_long);
             double norm_v = (lnglat.y - min_lat) / (max_lat - min_lat);
@@ -333,3 +336,48 @@ void main() {
     imageStore(uOut, storePos, vec4(oOutputValue, 0.0, 0.0, 0.0));
 }
 )";
+
+const std::string TextureOverlayRenderer::DECODE = R"(
+#version 430
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// Only the sampler matching uSourceKind is used
+layout (binding = 0) uniform sampler2D uFloatSource;
+layout (binding = 1) uniform usampler2D uUnsignedSource;
+layout (binding = 2) uniform isampler2D uSignedSource;
+
+layout (r32f, binding = 2) writeonly uniform image2D uOut;
+
+uniform int uSourceKind; // 0 = float, 1 = unsigned integer, 2 = signed integer
+uniform float uScale;
+uniform float uOffset;
+uniform bool uHasNoData;
+uniform float uNoData;
+
+void main() {
+    ivec2 storePos = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size     = imageSize(uOut);
+
+    if (storePos.x >= size.x || storePos.y >= size.y) {
+        return;
+    }
+
+    float stored;
+    if (uSourceKind == 0) {
+        stored = texelFetch(uFloatSource, storePos, 0).r;
+    } else if (uSourceKind == 1) {
+        stored = float(texelFetch(uUnsignedSource, storePos, 0).r);
+    } else {
+        stored = float(texelFetch(uSignedSource, storePos, 0).r);
+    }
+
+    // Pixels without data are negative, they are discarded by the surface shader
+    float value = stored * uScale + uOffset;
+    if (isnan(stored) || (uHasNoData && stored == uNoData)) {
+        value = -100000.0;
+    }
+
+    // We only use the red channel
+    imageStore(uOut, storePos, vec4(value, 0.0, 0.0, 0.0));
+}
+)";
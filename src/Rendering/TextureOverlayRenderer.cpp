@@ -21,11 +21,40 @@
 #include <functional>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <cmath>
 
+namespace {
+
+// Rasters larger than this are split into tiles, even if the driver supports
+// larger textures. A single 16k x 16k float texture already needs 1 GB
+const int MAX_TEXTURE_SIZE = 8192;
+const int TILE_SIZE = 512;
+
+// The tile budget keeps the GPU memory of a tiled raster at about 100 MB
+const size_t MAX_VISIBLE_TILES = 64;
+const size_t MAX_RESIDENT_TILES = 96;
+
+// Uploads per frame, the remaining tiles are drawn coarser in the meantime
+const size_t MAX_TILE_UPLOADS = 4;
+
+// Tiles are refined until a tile pixel appears smaller than this angle
+const double TILE_PIXEL_ANGLE = 0.002;
+const double EARTH_RADIUS = 6371000.0;
+
+// Number of levels of a full mip map chain of the texture
+int CountMipMapLevels(GDALReader::GreyScaleTexture const &texture) {
+  return static_cast<int>(std::max(
+      1.0, std::floor(std::log2(std::max(texture.x, texture.y))) + 1));
+}
+
+} // namespace
+
 TextureOverlayRenderer::TextureOverlayRenderer(
     cs::core::SolarSystem *pSolarSystem)
-    : mTransferFunction(
+    : mTileSelector(EARTH_RADIUS, TILE_PIXEL_ANGLE, MAX_VISIBLE_TILES),
+      mTileResidency(MAX_RESIDENT_TILES),
+      mTransferFunction(
           std::make_unique<cs::graphics::ColorMap>(boost::filesystem::path(
               "../share/resources/transferfunctions/BlackBody.json"))),
       mSolarSystem(pSolarSystem) {
@@ -52,6 +81,16 @@ TextureOverlayRenderer::TextureOverlayRenderer(
   glLinkProgram(m_pComputeShader);
   glDeleteShader(computeShader);
 
+  auto decodeShader = glCreateShader(GL_COMPUTE_SHADER);
+  pSource = DECODE.c_str();
+  glShaderSource(decodeShader, 1, &pSource, nullptr);
+  glCompileShader(decodeShader);
+
+  m_pDecodeShader = glCreateProgram();
+  glAttachShader(m_pDecodeShader, decodeShader);
+  glLinkProgram(m_pDecodeShader);
+  glDeleteShader(decodeShader);
+
   // create textures ---------------------------------------------------------
   for (auto const &viewport :
        GetVistaSystem()->GetDisplayManager()->GetViewports()) {
@@ -84,6 +123,7 @@ TextureOverlayRenderer::TextureOverlayRenderer(
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TextureOverlayRenderer::~TextureOverlayRenderer() {
+  ReleaseTiles();
   for (auto data : mGBufferData) {
     delete data.second.mDepthBuffer;
     delete data.second.mColorBuffer;
@@ -92,6 +132,177 @@ TextureOverlayRenderer::~TextureOverlayRenderer() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void TextureOverlayRenderer::DecodeTexture(RasterView const &pixels,
+                                           GLuint target) {
+  // Integer pixels are fetched unnormalized, so the shader sees stored values
+  GLenum internalFormat = GL_R16F;
+  GLenum format = GL_RED;
+  GLenum type = GL_HALF_FLOAT;
+  int sourceKind = 0;
+  switch (pixels.Type()) {
+  case PixelType::Float32:
+    internalFormat = GL_R32F;
+    type = GL_FLOAT;
+    break;
+  case PixelType::Float16:
+    break;
+  case PixelType::Byte:
+    internalFormat = GL_R8UI;
+    format = GL_RED_INTEGER;
+    type = GL_UNSIGNED_BYTE;
+    sourceKind = 1;
+    break;
+  case PixelType::UInt16:
+    internalFormat = GL_R16UI;
+    format = GL_RED_INTEGER;
+    type = GL_UNSIGNED_SHORT;
+    sourceKind = 1;
+    break;
+  case PixelType::Int16:
+    internalFormat = GL_R16I;
+    format = GL_RED_INTEGER;
+    type = GL_SHORT;
+    sourceKind = 2;
+    break;
+  }
+
+  // The samplers of the decode shader use the texture units 0 to 2
+  GLuint source = 0;
+  glGenTextures(1, &source);
+  glActiveTexture(GL_TEXTURE0 + sourceKind);
+  glBindTexture(GL_TEXTURE_2D, source);
+  glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, pixels.Width(),
+                 pixels.Height());
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  // Rows of 8 and 16 bit pixels are not necessarily 4 byte aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(pixels.RowStride()));
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pixels.Width(), pixels.Height(),
+                  format, type, pixels.Data());
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  auto const &encoding = pixels.Encoding();
+  glUseProgram(m_pDecodeShader);
+  glUniform1i(glGetUniformLocation(m_pDecodeShader, "uSourceKind"),
+              sourceKind);
+  glUniform1f(glGetUniformLocation(m_pDecodeShader, "uScale"), encoding.scale);
+  glUniform1f(glGetUniformLocation(m_pDecodeShader, "uOffset"),
+              encoding.offset);
+  glUniform1i(glGetUniformLocation(m_pDecodeShader, "uHasNoData"),
+              encoding.hasNoData);
+  glUniform1f(glGetUniformLocation(m_pDecodeShader, "uNoData"),
+              static_cast<float>(encoding.noData));
+  glBindImageTexture(2, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+  glDispatchCompute(
+      static_cast<uint32_t>(std::ceil(1.0 * pixels.Width() / 16)),
+      static_cast<uint32_t>(std::ceil(1.0 * pixels.Height() / 16)), 1);
+
+  // The mip map levels are computed from the decoded level
+  glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glDeleteTextures(1, &source);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureOverlayRenderer::UploadTexture(RasterView const &source,
+                                           GLuint target, int levels) {
+  // Sub-rectangle views are uploaded directly, strided views are copied
+  RasterView pixels = source.PixelStride() == 1 ? source : source.Compact();
+  if (pixels.IsPlainFloat()) {
+    glPixelStorei(GL_UNPACK_ROW_LENGTH,
+                  static_cast<GLint>(pixels.RowStride()));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pixels.Width(), pixels.Height(),
+                    GL_RED, GL_FLOAT, pixels.Data());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  } else {
+    DecodeTexture(pixels, target);
+  }
+
+  glUseProgram(m_pComputeShader);
+  glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+
+  for (int i(1); i < levels; ++i) {
+    // Calculates the width and height for the current MipMap Level
+    // This also sets the number of dispatched compute groups
+    int width = static_cast<int>(std::max(
+        1.0, std::floor(static_cast<double>(pixels.Width()) / std::pow(2, i))));
+    int height = static_cast<int>(std::max(
+        1.0,
+        std::floor(static_cast<double>(pixels.Height()) / std::pow(2, i))));
+    glUniform1i(glGetUniformLocation(m_pComputeShader, "uLevel"), i);
+    glUniform1i(glGetUniformLocation(m_pComputeShader, "uMipMapReduceMode"),
+                mMipMapReduceMode);
+    glBindImageTexture(2, target, i, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindImageTexture(1, target, i - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+
+    // Make sure writing has finished.
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    glDispatchCompute(static_cast<uint32_t>(std::ceil(1.0 * width / 16)),
+                      static_cast<uint32_t>(std::ceil(1.0 * height / 16)), 1);
+  }
+
+  // The surface shader samples the texture in the same frame
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TileResidency::DrawTile>
+TextureOverlayRenderer::StreamTiles(TileSelector::Observer const &observer) {
+  auto changes = mTileResidency.Update(
+      mTileSelector.Select(*mTiledRaster, observer), MAX_TILE_UPLOADS);
+
+  for (auto const &tile : changes.evict) {
+    auto it = mTileTextures.find(tile);
+    if (it != mTileTextures.end()) {
+      glDeleteTextures(1, &it->second);
+      mTileTextures.erase(it);
+    }
+  }
+
+  for (auto const &tile : changes.load) {
+    RasterView pixels = mTiledRaster->TilePixels(tile);
+    int levels = static_cast<int>(
+        std::floor(std::log2(std::max(pixels.Width(), pixels.Height()))) + 1);
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, pixels.Width(),
+                   pixels.Height());
+
+    UploadTexture(pixels, texture, levels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    mTileTextures[tile] = texture;
+  }
+
+  return changes.draw;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureOverlayRenderer::ReleaseTiles() {
+  for (auto const &tile : mTileTextures) {
+    glDeleteTextures(1, &tile.second);
+  }
+  mTileTextures.clear();
+  mTileResidency.Clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void TextureOverlayRenderer::SetOpacity(float val) { mOpacity = val; }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -104,7 +315,10 @@ void TextureOverlayRenderer::EnableManualMipMaps(bool val) {
 
 void TextureOverlayRenderer::SetMipMapLevel(double val) { mMipMapLevel = val; }
 
-int TextureOverlayRenderer::GetMipMapLevels() { return mMipMapLevels; }
+int TextureOverlayRenderer::GetMipMapLevels() {
+  std::lock_guard<std::mutex> lock(mTextureMutex);
+  return mPendingMipMapLevels;
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -133,26 +347,52 @@ void TextureOverlayRenderer::SetUseTime(bool use) { mUseTime = use; }
 
 void TextureOverlayRenderer::SetOverlayTexture(
     GDALReader::GreyScaleTexture &texture) {
-  mTexture = texture;
-  mUpdateTexture = true;
+  std::lock_guard<std::mutex> lock(mTextureMutex);
+  mPendingTexture = texture;
+  mPendingMipMapLevels = CountMipMapLevels(texture);
+  mTextureChanged = true;
+
+  // A range set before belongs to the previous texture
+  mPendingRange.reset();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TextureOverlayRenderer::SetDataRange(float min, float max) {
-  mTexture.dataRange[0] = min;
-  mTexture.dataRange[1] = max;
+  std::lock_guard<std::mutex> lock(mTextureMutex);
+  mPendingRange = std::array<double, 2>{min, max};
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TextureOverlayRenderer::UnloadTexture() { mTexture.buffer = nullptr; }
+void TextureOverlayRenderer::UnloadTexture() {
+  std::lock_guard<std::mutex> lock(mTextureMutex);
+  mPendingTexture = GDALReader::GreyScaleTexture();
+  mPendingMipMapLevels = 0;
+  mTextureChanged = true;
+  mPendingRange.reset();
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 bool TextureOverlayRenderer::Do() {
   cs::utils::FrameTimings::ScopedTimer timer("Render Texture");
 
+  {
+    // The loader threads only hand over the pixels, they are uploaded here
+    std::lock_guard<std::mutex> lock(mTextureMutex);
+    if (mTextureChanged) {
+      mTexture = std::move(mPendingTexture);
+      mPendingTexture = GDALReader::GreyScaleTexture();
+      mTextureChanged = false;
+      mUpdateTexture = true;
+    }
+    if (mPendingRange) {
+      mTexture.dataRange = mPendingRange.value();
+      mPendingRange.reset();
+    }
+  }
+
   // get active planet
   if (mSolarSystem->pActiveBody.get() == nullptr ||
       mSolarSystem->pActiveBody.get()->getCenterName() != "Earth") {
@@ -163,6 +403,11 @@ bool TextureOverlayRenderer::Do() {
   }
 
   if (!mTexture.buffer) {
+    // The tiles of an unloaded texture are released on the render thread
+    if (mTiledRaster) {
+      ReleaseTiles();
+      mTiledRaster.reset();
+    }
     return false;
   }
 
@@ -202,66 +447,51 @@ bool TextureOverlayRenderer::Do() {
     csp::vestec::logger().debug("[TextureOverlayRenderer] Update texture");
     cs::utils::FrameTimings::ScopedTimer timer("Compute LOD");
 
-    delete data.mColorBuffer;
-    data.mColorBuffer = new VistaTexture(GL_TEXTURE_2D);
-    data.mColorBuffer->Bind();
-    data.mColorBuffer->SetWrapS(GL_CLAMP);
-    data.mColorBuffer->SetWrapT(GL_CLAMP);
-    data.mColorBuffer->SetMinFilter(GL_NEAREST);
-    data.mColorBuffer->SetMagFilter(GL_NEAREST);
-    data.mColorBuffer->Unbind();
+    ReleaseTiles();
+    mTiledRaster.reset();
 
-    data.mColorBuffer->Bind();
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    mMipMapLevels = CountMipMapLevels(mTexture);
 
-    mMipMapLevels = static_cast<int>(std::max(
-        1.0, std::floor(std::log2(std::max(mTexture.x, mTexture.y))) + 1));
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                    GL_NEAREST_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-    glTexStorage2D(GL_TEXTURE_2D, mMipMapLevels, GL_R32F, mTexture.x,
-                   mTexture.y);
-    // Hacky, update error can occur when mode changes, catch this here so
-    // nothing gets displayed
-    int error = glGetError();
-    if (error != 0) {
+    if (std::max(mTexture.x, mTexture.y) >
+        std::min<int>(maxTextureSize, MAX_TEXTURE_SIZE)) {
+      // The tiles are uploaded on demand while drawing
+      mTiledRaster = std::make_unique<TiledRaster>(mTexture, TILE_SIZE);
       csp::vestec::logger().debug(
-          "[TextureOverlayRenderer] Error after texture change: {}",
-          std::to_string(error));
-    }
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mTexture.x, mTexture.y, GL_RED,
-                    GL_FLOAT, mTexture.buffer);
-
-    glUseProgram(m_pComputeShader);
-    glBindImageTexture(0, data.mColorBuffer->GetId(), 0, GL_FALSE, 0,
-                       GL_READ_ONLY, GL_R32F);
-
-    for (int i(1); i < mMipMapLevels; ++i) {
-      // Calculates the width and height for the current MipMap Level
-      // This also sets the number of dispatched compute groups
-      int width = static_cast<int>(std::max(
-          1.0, std::floor(static_cast<double>(static_cast<int>(mTexture.x)) /
-                          std::pow(2, i))));
-      int height = static_cast<int>(std::max(
-          1.0, std::floor(static_cast<double>(static_cast<int>(mTexture.y)) /
-                          std::pow(2, i))));
-      glUniform1i(glGetUniformLocation(m_pComputeShader, "uLevel"), i);
-      glUniform1i(glGetUniformLocation(m_pComputeShader, "uMipMapReduceMode"),
-                  mMipMapReduceMode);
-      glBindImageTexture(2, data.mColorBuffer->GetId(), i, GL_FALSE, 0,
-                         GL_WRITE_ONLY, GL_R32F);
-
-      if (i > 0) {
-        glBindImageTexture(1, data.mColorBuffer->GetId(), i - 1, GL_FALSE, 0,
-                           GL_READ_ONLY, GL_R32F);
+          "[TextureOverlayRenderer] Drawing {}x{} texture as {} tile levels",
+          mTexture.x, mTexture.y, mTiledRaster->Levels());
+    } else {
+      delete data.mColorBuffer;
+      data.mColorBuffer = new VistaTexture(GL_TEXTURE_2D);
+      data.mColorBuffer->Bind();
+      data.mColorBuffer->SetWrapS(GL_CLAMP);
+      data.mColorBuffer->SetWrapT(GL_CLAMP);
+      data.mColorBuffer->SetMinFilter(GL_NEAREST);
+      data.mColorBuffer->SetMagFilter(GL_NEAREST);
+      data.mColorBuffer->Unbind();
+
+      data.mColorBuffer->Bind();
+
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                      GL_NEAREST_MIPMAP_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+      glTexStorage2D(GL_TEXTURE_2D, mMipMapLevels, GL_R32F, mTexture.x,
+                     mTexture.y);
+      // Hacky, update error can occur when mode changes, catch this here so
+      // nothing gets displayed
+      int error = glGetError();
+      if (error != 0) {
+        csp::vestec::logger().debug(
+            "[TextureOverlayRenderer] Error after texture change: {}",
+            std::to_string(error));
       }
 
-      // Make sure writing has finished.
-      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-      glDispatchCompute(static_cast<uint32_t>(std::ceil(1.0 * width / 16)),
-                        static_cast<uint32_t>(std::ceil(1.0 * height / 16)), 1);
+      UploadTexture(mTexture.buffer, data.mColorBuffer->GetId(),
+                    mMipMapLevels);
     }
 
     mUpdateTexture = false;
@@ -285,6 +515,29 @@ bool TextureOverlayRenderer::Do() {
   VistaTransformMatrix matInvMVP(matInvMV * matInvP);
   // get matrices and related values -----------------------------------------
 
+  // From Application.cpp
+  auto *pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
+  VistaTransformNode *pTrans =
+      dynamic_cast<VistaTransformNode *>(pSG->GetNode("Platform-User-Node"));
+
+  auto vWorldPos = glm::vec4(1);
+  pTrans->GetWorldPosition(vWorldPos.x, vWorldPos.y, vWorldPos.z);
+
+  auto polar = cs::utils::convert::cartesianToLngLatHeight(
+      (glm::inverse(mSolarSystem->pActiveBody.get()->getWorldTransform()) *
+       vWorldPos)
+          .xyz(),
+      mSolarSystem->pActiveBody.get()->getRadii());
+
+  double observerHeight =
+      polar.z / 1 - mSolarSystem->pActiveBody.get()->getHeight(polar.xy());
+
+  // Tiles are uploaded before the surface shader is bound
+  std::vector<TileResidency::DrawTile> tiles;
+  if (mTiledRaster) {
+    tiles = StreamTiles({polar.x, polar.y, observerHeight});
+  }
+
   // Bind shader before draw
   m_pSurfaceShader->Bind();
 
@@ -320,8 +573,10 @@ bool TextureOverlayRenderer::Do() {
   //    m_pSurfaceShader->GetUniformLocation("uBounds"), 4, 1,
   //    mTexture.lnglatBounds.data());
   // Double precision bounds
-  loc = m_pSurfaceShader->GetUniformLocation("uBounds");
-  glUniform4dv(loc, 1, mTexture.lnglatBounds.data());
+  GLint boundsLocation = m_pSurfaceShader->GetUniformLocation("uBounds");
+  GLint clipLocation = m_pSurfaceShader->GetUniformLocation("uClipBounds");
+  glUniform4dv(boundsLocation, 1, mTexture.lnglatBounds.data());
+  glUniform4dv(clipLocation, 1, mTexture.lnglatBounds.data());
   m_pSurfaceShader->SetUniform(m_pSurfaceShader->GetUniformLocation("uRange"),
                                static_cast<float>(mTexture.dataRange[0]),
                                static_cast<float>(mTexture.dataRange[1]));
@@ -332,22 +587,6 @@ bool TextureOverlayRenderer::Do() {
   m_pSurfaceShader->SetUniform(m_pSurfaceShader->GetUniformLocation("uUseTime"),
                                mUseTime);
 
-  // From Application.cpp
-  auto *pSG = GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
-  VistaTransformNode *pTrans =
-      dynamic_cast<VistaTransformNode *>(pSG->GetNode("Platform-User-Node"));
-
-  auto vWorldPos = glm::vec4(1);
-  pTrans->GetWorldPosition(vWorldPos.x, vWorldPos.y, vWorldPos.z);
-
-  auto polar = cs::utils::convert::cartesianToLngLatHeight(
-      (glm::inverse(mSolarSystem->pActiveBody.get()->getWorldTransform()) *
-       vWorldPos)
-          .xyz(),
-      mSolarSystem->pActiveBody.get()->getRadii());
-
-  double observerHeight =
-      polar.z / 1 - mSolarSystem->pActiveBody.get()->getHeight(polar.xy());
   int lod;
   if (!mManualMipMaps) {
     int heightMipMapLevel0 = 1500;
@@ -367,9 +606,6 @@ bool TextureOverlayRenderer::Do() {
     lod = static_cast<int>(fmin(mMipMapLevel, mMipMapLevels));
   }
 
-  m_pSurfaceShader->SetUniform(m_pSurfaceShader->GetUniformLocation("uTexLod"),
-                               static_cast<int>(lod));
-
   auto sunDirection = glm::normalize(
       glm::inverse(matWorldTransform) *
       (mSolarSystem->getSun()->getWorldTransform()[3] - matWorldTransform[3]));
@@ -388,8 +624,31 @@ bool TextureOverlayRenderer::Do() {
   int depthBits = 0;
   glGetIntegerv(GL_DEPTH_BITS, &depthBits);
 
-  // Dummy draw
-  glDrawArrays(GL_POINTS, 0, 1);
+  GLint lodLocation = m_pSurfaceShader->GetUniformLocation("uTexLod");
+  if (mTiledRaster) {
+    // Every tile has its own bounds and mip maps. The selector already picked
+    // the tile level, so the automatic lod only applies to untiled textures.
+    // A coarser tile which stands in for a missing one is clipped to it
+    for (auto const &draw : tiles) {
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, mTileTextures[draw.tile]);
+      auto bounds = mTiledRaster->TileBounds(draw.tile);
+      auto clipBounds = mTiledRaster->TileBounds(draw.region);
+      glUniform4dv(boundsLocation, 1, bounds.data());
+      glUniform4dv(clipLocation, 1, clipBounds.data());
+      m_pSurfaceShader->SetUniform(
+          lodLocation, mManualMipMaps ? std::max(lod - draw.tile.level, 0) : 0);
+
+      glDrawArrays(GL_POINTS, 0, 1);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+  } else {
+    m_pSurfaceShader->SetUniform(lodLocation, static_cast<int>(lod));
+
+    // Dummy draw
+    glDrawArrays(GL_POINTS, 0, 1);
+  }
 
   data.mDepthBuffer->Unbind(GL_TEXTURE0);
   data.mColorBuffer->Unbind(GL_TEXTURE1);
@@ -2,6 +2,7 @@
 #define TEXTURE_OVERLAY_RENDERER
 
 #include "../common/GDALReader.hpp"
+#include "../common/TiledRaster.hpp"
 #include <VistaKernel/GraphicsManager/VistaOpenGLDraw.h>
 #include <VistaKernel/GraphicsManager/VistaTransformNode.h>
 #include <VistaMath/VistaBoundingBox.h>
@@ -13,6 +14,9 @@
 #include <array>
 #include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -48,7 +52,8 @@ public:
   void SetMipMapLevel(double val);
 
   /**
-   * Get the max mip map levels of the texture
+   * Get the max mip map levels of the texture which was set last, it may not
+   * be uploaded yet
    */
   int GetMipMapLevels();
 
@@ -78,17 +83,19 @@ public:
   void SetUseTime(bool use);
 
   /**
-   * Adding a texture used for overlay rendering
+   * Adding a texture used for overlay rendering. It is uploaded with the next
+   * frame, so this may be called from any thread
    */
   void SetOverlayTexture(GDALReader::GreyScaleTexture &texture);
 
   /**
-   * Change the min and max value used to compute a color
+   * Change the min and max value used to compute a color. May be called from
+   * any thread, the range applies to the texture which was set last
    */
   void SetDataRange(float min, float max);
 
   /**
-   * Unloads the currently active texture
+   * Unloads the currently active texture. May be called from any thread
    */
   void UnloadTexture();
 
@@ -111,11 +118,37 @@ private:
   VistaGLSLShader *m_pSurfaceShader =
       nullptr;             //! Vista GLSL shader object used for rendering
   GLuint m_pComputeShader; //! Vista GLSL shader object used for computing lod
+  GLuint m_pDecodeShader;  //! Converts encoded pixels to float on the GPU
 
   static const std::string SURFACE_GEOM; //! Code for the geometry shader
   static const std::string SURFACE_VERT; //! Code for the vertex shader
   static const std::string SURFACE_FRAG; //! Code for the fragment shader
   static const std::string COMPUTE;      //! Code for the compute shader
+  static const std::string DECODE;       //! Code for the decode shader
+
+  /**
+   * Uploads pixels which are not plain floats (integer or half float pixels
+   * and scaled values) to a temporary texture and decodes them into the first
+   * level of the float target texture
+   */
+  void DecodeTexture(RasterView const &pixels, GLuint target);
+
+  /**
+   * Uploads the pixels into the first level of a float texture with the given
+   * number of levels and computes the remaining mip map levels
+   */
+  void UploadTexture(RasterView const &pixels, GLuint target, int levels);
+
+  /**
+   * Uploads the tiles which are needed for the current observer and releases
+   * the ones which are no longer needed. Returns the tiles to draw
+   */
+  std::vector<TileResidency::DrawTile> StreamTiles(TileSelector::Observer const &observer);
+
+  /**
+   * Releases the textures of all resident tiles
+   */
+  void ReleaseTiles();
 
   /**
    * Struct which stores the depth buffer and color buffer from the previous
@@ -132,7 +165,21 @@ private:
       mGBufferData; //! Store one buffer per viewport
 
   GDALReader::GreyScaleTexture
-      mTexture; //! The textured passed from outside via SetOverlayTexture
+      mTexture; //! The uploaded texture, only accessed by the render thread
+
+  std::mutex mTextureMutex; //! Guards the pending texture and data range
+  GDALReader::GreyScaleTexture
+      mPendingTexture;          //! Texture set by SetOverlayTexture
+  bool mTextureChanged = false; //! True if a texture was set or unloaded
+  std::optional<std::array<double, 2>>
+      mPendingRange;             //! Range set by SetDataRange
+  int mPendingMipMapLevels = 0; //! Mip map levels of the pending texture
+
+  //! Rasters which exceed the texture size limit are drawn as tiles
+  std::unique_ptr<TiledRaster> mTiledRaster;
+  TileSelector mTileSelector;
+  TileResidency mTileResidency;
+  std::map<TileId, GLuint> mTileTextures; //! Textures of the resident tiles
 
   std::unique_ptr<cs::graphics::ColorMap>
       mTransferFunction; //! Transfer function used in shader
@@ -380,7 +380,7 @@ void UncertaintyOverlayRenderer::UploadTextures() {
   auto const &data = mGBufferData[viewport];
 
   // Get the first texture
-  GDALReader::GreyScaleTexture texture0 = mvecTextures[0];
+  GDALReader::GreyScaleTexture const &texture0 = mvecTextures[0];
 
   // Allocate memory for the SSBO
   int group_size_x = (mvecTextures[0].x / 16) + 1;
@@ -401,11 +401,19 @@ void UncertaintyOverlayRenderer::UploadTextures() {
   }
 
   int layerCount = 0;
-  for (auto texture : mvecTextures) {
+  for (auto const &texture : mvecTextures) {
+    // Sub-rectangle float views are uploaded directly, strided or encoded
+    // views are converted to contiguous floats first
+    RasterView pixels =
+        texture.buffer.PixelStride() == 1 && texture.buffer.IsPlainFloat()
+            ? texture.buffer
+            : texture.buffer.Decoded();
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(pixels.RowStride()));
     glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layerCount, texture.x,
-                    texture.y, 1, GL_RED, GL_FLOAT, texture.buffer);
+                    texture.y, 1, GL_RED, GL_FLOAT, pixels.Data());
     layerCount++;
   }
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
   mUpdateTextures = false;
   data.mColorBuffer->Unbind();
 }
@@ -0,0 +1,175 @@
+#include "ContourNode.hpp"
+#include "../../../../src/cs-utils/filesystem.hpp"
+#include "../NodeEditor/NodeEditor.hpp"
+
+#include <VistaKernel/GraphicsManager/VistaGraphicsManager.h>
+#include <VistaKernel/GraphicsManager/VistaSceneGraph.h>
+#include <VistaKernel/VistaSystem.h>
+#include <VistaKernelOpenSGExt/VistaOpenSGMaterialTools.h>
+
+#include <algorithm>
+#include <sstream>
+
+ContourNode::ContourNode(csp::vestec::Plugin::Settings const &config,
+                         cs::gui::GuiItem *pItem, int id,
+                         cs::core::SolarSystem *pSolarSystem,
+                         cs::scene::CelestialAnchorNode *pAnchor,
+                         cs::core::GraphicsEngine *pEngine,
+                         std::shared_ptr<cs::core::Settings> settings)
+    : VNE::Node(pItem, id, 2, 0), m_pAnchor(pAnchor) {
+  // Store config data for later usage
+  mPluginConfig = config;
+
+  // Initialize GDAL only once
+  GDALReader::InitGDAL();
+
+  m_pRenderer = new ContourRenderer(pSolarSystem, std::move(settings));
+
+  // Add the ContourRenderer to the VISTA scene graph
+  VistaSceneGraph *pSG =
+      GetVistaSystem()->GetGraphicsManager()->GetSceneGraph();
+  m_pNode.reset(pSG->NewOpenGLNode(m_pAnchor, m_pRenderer));
+
+  // Render after the planets and the texture overlays, the lines are blended
+  VistaOpenSGMaterialTools::SetSortKeyOnSubtree(
+      m_pNode.get(), static_cast<int>(cs::utils::DrawOrder::eTransparentItems));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ContourNode::~ContourNode() {
+  // A running extraction must not pass its isolines to the renderer anymore
+  if (mTicket) {
+    mTicket->Cancel();
+  }
+
+  m_pAnchor->DisconnectChild(m_pNode.get());
+  delete m_pRenderer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string ContourNode::GetName() { return "ContourNode"; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourNode::Init(VNE::NodeEditor *pEditor) {
+  csp::vestec::logger().debug("[{}] Init", GetName());
+
+  const std::string node = cs::utils::filesystem::loadToString(
+      "../share/resources/gui/js/csp-vestec-contour-node.js");
+  pEditor->GetGuiItem()->executeJavascript(node);
+
+  pEditor->GetGuiItem()->registerCallback<double, std::string>(
+      "ContourNode.setFile", "Sets the texture whose isolines are drawn",
+      std::function([pEditor](double id, std::string file) {
+        pEditor->GetNode<ContourNode>(std::lround(id))->SetFile(file);
+      }));
+
+  pEditor->GetGuiItem()->registerCallback<double, std::string>(
+      "ContourNode.setIsovalues", "Sets the values of the isolines",
+      std::function([pEditor](double id, std::string values) {
+        pEditor->GetNode<ContourNode>(std::lround(id))->SetIsovalues(values);
+      }));
+
+  pEditor->GetGuiItem()->registerCallback<double, bool>(
+      "ContourNode.setEnabled", "Shows or hides the isolines",
+      std::function([pEditor](double id, bool enabled) {
+        pEditor->GetNode<ContourNode>(std::lround(id))->SetEnabled(enabled);
+      }));
+
+  pEditor->GetGuiItem()->registerCallback<double, std::string>(
+      "ContourNode.setTransferFunction",
+      "Sets the transfer function for rendering",
+      std::function([pEditor](double id, std::string val) {
+        pEditor->GetNode<ContourNode>(std::lround(id))
+            ->SetTransferFunction(val);
+      }));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourNode::SetFile(const std::string &file) {
+  if (file == mFile) {
+    return;
+  }
+
+  mFile = file;
+  UpdateIsolines();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourNode::SetIsovalues(const std::string &values) {
+  std::string list = values;
+  std::replace(list.begin(), list.end(), ',', ' ');
+
+  std::vector<float> isovalues;
+  std::stringstream stream(list);
+  std::string entry;
+  while (stream >> entry) {
+    try {
+      isovalues.push_back(std::stof(entry));
+    } catch (std::exception const &) {
+      csp::vestec::logger().warn("[{}] Ignoring isovalue '{}'", GetName(),
+                                 entry);
+    }
+  }
+
+  if (isovalues == mIsovalues) {
+    return;
+  }
+
+  mIsovalues = isovalues;
+  UpdateIsolines();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourNode::SetEnabled(bool enabled) { m_pRenderer->SetEnabled(enabled); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourNode::SetTransferFunction(std::string json) {
+  m_pRenderer->SetTransferFunction(json);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourNode::UpdateIsolines() {
+  // The isolines of the previous file or values are not needed anymore
+  if (mTicket) {
+    mTicket->Cancel();
+    mTicket.reset();
+  }
+
+  if (mFile.empty() || mIsovalues.empty()) {
+    m_pRenderer->SetIsolines({});
+    return;
+  }
+
+  // Extracting may take a while, do not block the main thread. Isolines which
+  // were shown before come from the cache
+  mTicket = RasterLoader::Run(
+      GetName(), RasterLoader::Priority::Normal,
+      [pRenderer = m_pRenderer, file = mFile,
+       isovalues = mIsovalues](RasterLoader::Ticket &ticket) {
+        std::vector<ContourRenderer::Isoline> isolines;
+        for (float value : isovalues) {
+          // Another file or other values were selected meanwhile
+          if (ticket.IsCancelled()) {
+            return;
+          }
+
+          auto polylines = ContourExtractor::Get(file, 1, value);
+          if (!polylines) {
+            return;
+          }
+          isolines.push_back({value, polylines});
+        }
+
+        // The renderer is deleted only after the ticket is cancelled
+        ticket.Deliver(
+            [&]() { pRenderer->SetIsolines(std::move(isolines)); });
+      });
+}
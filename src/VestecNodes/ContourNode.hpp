@@ -0,0 +1,90 @@
+#ifndef CONTOUR_NODE_HPP_
+#define CONTOUR_NODE_HPP_
+
+#include "../NodeEditor/Node.hpp"
+#include "../Plugin.hpp"
+#include "../Rendering/ContourRenderer.hpp"
+#include "../common/RasterLoader.hpp"
+
+#include "../../../../src/cs-core/GraphicsEngine.hpp"
+#include "../../../../src/cs-core/SolarSystem.hpp"
+#include "../../../../src/cs-scene/CelestialAnchorNode.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace VNE {
+class NodeEditor;
+}
+
+/**
+ * The contour node draws isolines of the input texture, e.g. the fire front
+ * at given times from a wildfire arrival time raster. The isovalues are given
+ * as a comma separated list. Isolines are extracted in the background and
+ * cached per texture and value, hiding them does not discard them.
+ *
+ * @see ContourExtractor
+ * @see ContourRenderer
+ */
+class ContourNode : public VNE::Node {
+public:
+  ContourNode(csp::vestec::Plugin::Settings const &config,
+              cs::gui::GuiItem *pItem, int id,
+              cs::core::SolarSystem *pSolarSystem,
+              cs::scene::CelestialAnchorNode *pAnchor,
+              cs::core::GraphicsEngine *pEngine,
+              std::shared_ptr<cs::core::Settings> settings);
+  virtual ~ContourNode();
+
+  /**
+   * These static functions are required and needs to be implemented
+   */
+  static void Init(VNE::NodeEditor *pEditor);
+
+  /**
+   * Returns the unique identifier for the node as string
+   */
+  static std::string GetName();
+
+  /**
+   * Sets the texture whose isolines are drawn. An empty path removes them
+   */
+  void SetFile(const std::string &file);
+
+  /**
+   * Sets the isovalues from a list of numbers separated by commas or spaces.
+   * Entries which are not numbers are ignored
+   */
+  void SetIsovalues(const std::string &values);
+
+  /**
+   * Shows or hides the isolines
+   */
+  void SetEnabled(bool enabled);
+
+  /**
+   * Sets the transfer function for the rendering
+   */
+  void SetTransferFunction(std::string json);
+
+private:
+  /**
+   * Extracts the isolines of the current file and values in the background
+   * and passes them to the renderer
+   */
+  void UpdateIsolines();
+
+  csp::vestec::Plugin::Settings
+      mPluginConfig; //! Needed to access a path defined in the Plugin::Settings
+  cs::scene::CelestialAnchorNode *m_pAnchor =
+      nullptr; //! Anchor on which the ContourRenderer is added (normally
+               //! centered in earth)
+  ContourRenderer *m_pRenderer = nullptr; //! The renderer of the isolines
+
+  std::string mFile;             //! The texture of the isolines
+  std::vector<float> mIsovalues; //! The values of the isolines
+  std::shared_ptr<RasterLoader::Ticket>
+      mTicket; //! Extraction of the current file and values
+};
+
+#endif /* CONTOUR_NODE_HPP_ */
@@ -1,5 +1,6 @@
 
 #include "DiseasesSensorInputNode.hpp"
+#include "../common/ArchiveReader.hpp"
 
 #include "../../../../src/cs-utils/filesystem.hpp"
 
@@ -52,7 +53,7 @@ void DiseasesSensorInputNode::Init(VNE::NodeEditor *pEditor) {
 
 void DiseasesSensorInputNode::ReadSensorFileNames(int id,
                                                   const std::string &path) {
-  std::set<std::string> lFiles(cs::utils::filesystem::listFiles(path));
+  std::set<std::string> lFiles(ArchiveReader::ListFiles(path));
   nlohmann::json args(lFiles);
   m_pItem->callJavascript("DiseasesSensorInputNode.fillWithSensorFiles", id,
                           args.dump());
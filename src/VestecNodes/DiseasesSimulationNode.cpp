@@ -1,8 +1,11 @@
 
 #include "DiseasesSimulationNode.hpp"
+#include "../common/ArchiveReader.hpp"
+#include "../common/NetCDFReader.hpp"
 
 #include "../../../../src/cs-utils/filesystem.hpp"
 
+#include <cmath>
 #include <nlohmann/json.hpp>
 #include <set>
 
@@ -61,7 +64,7 @@ void DiseasesSimulation::Init(VNE::NodeEditor *pEditor) {
         // pEditor->GetNode<DiseasesSimulation>(id)->SetSimulationModes(id,
         // path);
 
-        std::set<std::string> lDirs(cs::utils::filesystem::listDirs(path));
+        std::set<std::string> lDirs(ArchiveReader::ListDirs(path));
 
         nlohmann::json args(lDirs);
 
@@ -75,19 +78,28 @@ void DiseasesSimulation::Init(VNE::NodeEditor *pEditor) {
 void DiseasesSimulation::GetFileNamesForTimeStep(int id,
                                                  const std::string &mode,
                                                  double t) {
-  std::set<std::string> lDirs(cs::utils::filesystem::listDirs(mode));
+  std::set<std::string> lDirs(ArchiveReader::ListDirs(mode));
   std::set<std::string> listOfFiles;
   // Get the file for the timestep in every member
   for (const auto &dir : lDirs) {
-    std::set<std::string> lFiles(cs::utils::filesystem::listFiles(dir));
+    std::set<std::string> lFiles(ArchiveReader::ListFiles(dir));
+    bool found = false;
     for (const auto &file : lFiles) {
       std::stringstream number;
       number << t;
       std::string search = "day_" + number.str() + ".nc";
       if (file.find(search) != std::string::npos) {
         listOfFiles.insert(file);
+        found = true;
       }
     }
+
+    // Members which store all days in one file get the slice of the day
+    int day = static_cast<int>(std::lround(t));
+    std::string slice = found ? "" : GetTimeSeriesSlice(lFiles, day);
+    if (!slice.empty()) {
+      listOfFiles.insert(slice);
+    }
   }
 
   nlohmann::json args(listOfFiles);
@@ -95,22 +107,57 @@ void DiseasesSimulation::GetFileNamesForTimeStep(int id,
                           args.dump());
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void DiseasesSimulation::SetNumberOfEnsembleMembers(int id,
                                                     const std::string &path) {
-  std::set<std::string> lDirs(cs::utils::filesystem::listDirs(path));
+  std::set<std::string> lDirs(ArchiveReader::ListDirs(path));
 
   // TODO Awkward
   std::string a = *lDirs.begin();
-  std::set<std::string> lFiles(cs::utils::filesystem::listFiles(a + "/"));
+  std::set<std::string> lFiles(ArchiveReader::ListFiles(a + "/"));
+
+  // A time series file contains all days of a member
+  size_t days = lFiles.size();
+  for (const auto &file : lFiles) {
+    if (IsTimeSeries(file)) {
+      days = NetCDFReader::GetNumberOfTimeSteps(file);
+      break;
+    }
+  }
 
   m_pItem->callJavascript("DiseasesSimulationNode.setNumberOfEnsembleMembers",
-                          id, lDirs.size(), lFiles.size());
+                          id, lDirs.size(), days);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DiseasesSimulation::IsTimeSeries(const std::string &file) {
+  return file.size() > 3 && file.compare(file.size() - 3, 3, ".nc") == 0 &&
+         file.find("day_") == std::string::npos &&
+         NetCDFReader::GetNumberOfTimeSteps(file) > 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string
+DiseasesSimulation::GetTimeSeriesSlice(std::set<std::string> const &files,
+                                       int day) {
+  for (const auto &file : files) {
+    if (IsTimeSeries(file)) {
+      std::string slice = NetCDFReader::GetSlicePath(file, day);
+      if (!slice.empty()) {
+        return slice;
+      }
+    }
+  }
+  return "";
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void DiseasesSimulation::SetSimulationModes(int id, const std::string &path) {
-  std::set<std::string> lDirs(cs::utils::filesystem::listDirs(path));
+  std::set<std::string> lDirs(ArchiveReader::ListDirs(path));
 
   nlohmann::json args(lDirs);
 
@@ -5,6 +5,9 @@
 #include "../NodeEditor/Node.hpp"
 #include "../Plugin.hpp"
 
+#include <set>
+#include <string>
+
 namespace VNE {
 class NodeEditor;
 }
@@ -47,6 +50,19 @@ private:
    */
   void SetSimulationModes(int id, const std::string &path);
 
+  /**
+   * Returns true for netCDF files which contain more than one day, instead of
+   * one file per day
+   */
+  static bool IsTimeSeries(const std::string &file);
+
+  /**
+   * Returns the layer path of a day (starting at 0) in the first time series
+   * file of a member, or an empty string
+   */
+  static std::string GetTimeSeriesSlice(std::set<std::string> const &files,
+                                        int day);
+
 private:
   csp::vestec::Plugin::Settings mPluginConfig;
 };
@@ -12,12 +12,14 @@
 #include "../../../../src/cs-utils/filesystem.hpp"
 #include "../NodeEditor/NodeEditor.hpp"
 #include "../Plugin.hpp"
+#include "../common/ArchiveReader.hpp"
 #include "IncidentNode.hpp"
 
 #include <curlpp/Easy.hpp>
 #include <curlpp/Info.hpp>
 #include <curlpp/Infos.hpp>
 #include <curlpp/Options.hpp>
+#include <nlohmann/json.hpp>
 #include <utility>
 
 #include <zipper/unzipper.h>
@@ -49,6 +51,11 @@ void IncidentNode::Init(VNE::NodeEditor *pEditor) {
           std::cout << "Downloading dataset" << uuid << std::endl;
           auto success = IncidentNode::DownloadDataset(uuid, token);
 
+          // Archives are not extracted, their files are read directly
+          if (success) {
+            IncidentNode::SendArchiveFiles(pEditor, id, uuid);
+          }
+
           pEditor->GetGuiItem()->callJavascript("IncidentNode.setDatasetReady",
                                                 id, uuid, success);
         }))
@@ -134,6 +141,24 @@ bool IncidentNode::DownloadDataset(const std::string uuid,
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void IncidentNode::SendArchiveFiles(VNE::NodeEditor *pEditor, double id,
+                                    const std::string &uuid) {
+  std::string archive(csp::vestec::Plugin::vestecDownloadDir + "/" + uuid);
+  if (!ArchiveReader::IsArchive(archive)) {
+    return;
+  }
+
+  std::set<std::string> files(ArchiveReader::ListMembers(archive));
+  csp::vestec::logger().debug("Reading {} files directly from archive '{}'.",
+                              files.size(), uuid);
+
+  nlohmann::json args(files);
+  pEditor->GetGuiItem()->callJavascript("IncidentNode.setArchiveFiles", id,
+                                        uuid, args.dump());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool IncidentNode::ExtractDataset(const std::string uuid, bool appendCDB) {
 
   std::string zip(csp::vestec::Plugin::vestecDownloadDir + "/" + uuid);
@@ -39,6 +39,14 @@ public:
 private:
   static bool DownloadDataset(const std::string uuid, const std::string token);
   static bool ExtractDataset(const std::string uuid, bool appendCDB);
+
+  /**
+   * Sends the files within a downloaded zip archive to the node as paths
+   * which can be read without extracting the archive. Does nothing if the
+   * dataset is not an archive
+   */
+  static void SendArchiveFiles(VNE::NodeEditor *pEditor, double id,
+                               const std::string &uuid);
 };
 
 #endif // COSMOSCOUT_VR_INCIDENTNODE_HPP
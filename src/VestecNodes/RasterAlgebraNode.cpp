@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR //
+//      and may be used under the terms of the MIT license. See the LICENSE file
+//      for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR) //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "RasterAlgebraNode.hpp"
+#include "../../../../src/cs-utils/filesystem.hpp"
+#include "../NodeEditor/NodeEditor.hpp"
+#include "../common/RasterAlgebra.hpp"
+
+#include <nlohmann/json.hpp>
+
+RasterAlgebraNode::RasterAlgebraNode(cs::gui::GuiItem *pItem, int id)
+    : VNE::Node(pItem, id, RasterAlgebra::MAX_INPUTS, 1) {
+  // Initialize GDAL only once
+  GDALReader::InitGDAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterAlgebraNode::~RasterAlgebraNode() {
+  // A running computation must not report to the node anymore
+  if (mTicket) {
+    mTicket->Cancel();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string RasterAlgebraNode::GetName() { return "RasterAlgebraNode"; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterAlgebraNode::Init(VNE::NodeEditor *pEditor) {
+  csp::vestec::logger().debug("[{}] Init", GetName());
+
+  const std::string node = cs::utils::filesystem::loadToString(
+      "../share/resources/gui/js/csp-vestec-raster-algebra-node.js");
+  pEditor->GetGuiItem()->executeJavascript(node);
+
+  pEditor->GetGuiItem()->registerCallback<double, std::string>(
+      "RasterAlgebraNode.evaluate",
+      "Evaluates an expression on the input textures",
+      std::function([pEditor](double id, std::string json) {
+        pEditor->GetNode<RasterAlgebraNode>(std::lround(id))->Evaluate(json);
+      }));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterAlgebraNode::Evaluate(const std::string &json) {
+  nlohmann::json args = nlohmann::json::parse(json);
+  std::string expression = args["expression"];
+  std::vector<std::string> files = args["files"];
+
+  // The result of the previous expression or inputs is not needed anymore
+  if (mTicket) {
+    mTicket->Cancel();
+  }
+
+  // Reading the inputs may take a while, do not block the main thread
+  mTicket = RasterLoader::Run(
+      GetName(), RasterLoader::Priority::Normal,
+      [pItem = m_pItem, id = GetID(), expression,
+       files](RasterLoader::Ticket &ticket) {
+        std::string error;
+        std::string path = RasterAlgebra::Compute(expression, files, error);
+
+        ticket.Deliver([&]() {
+          if (path.empty()) {
+            csp::vestec::logger().warn("[RasterAlgebraNode] '{}': {}",
+                                       expression, error);
+          }
+          pItem->callJavascript("RasterAlgebraNode.setResult", id, path,
+                                error);
+        });
+      });
+}
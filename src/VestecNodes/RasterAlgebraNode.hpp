@@ -0,0 +1,49 @@
+#ifndef RASTER_ALGEBRA_NODE_HPP_
+#define RASTER_ALGEBRA_NODE_HPP_
+
+#include "../NodeEditor/Node.hpp"
+#include "../Plugin.hpp"
+#include "../common/RasterLoader.hpp"
+
+#include <memory>
+
+namespace VNE {
+class NodeEditor;
+}
+
+/**
+ * Derives a texture from up to four input textures with an expression, e.g.
+ * a risk index from temperature, rain and population. The inputs are the
+ * variables a to d of the expression. The result is written to a GeoTIFF
+ * whose path is passed on like the output of the other texture nodes.
+ *
+ * @see RasterAlgebra
+ */
+class RasterAlgebraNode : public VNE::Node {
+public:
+  RasterAlgebraNode(cs::gui::GuiItem *pItem, int id);
+  virtual ~RasterAlgebraNode();
+
+  /**
+   * These static functions are required and needs to be implemented
+   */
+  static void Init(VNE::NodeEditor *pEditor);
+
+  /**
+   * Returns the unique identifier for the node as string
+   */
+  static std::string GetName();
+
+  /**
+   * Evaluates the expression on the first file of each input in the
+   * background. The json contains the expression and the files. The path of
+   * the result or an error is sent to the node editor once it is computed
+   */
+  void Evaluate(const std::string &json);
+
+private:
+  std::shared_ptr<RasterLoader::Ticket>
+      mTicket; //! Evaluation of the latest expression and inputs
+};
+
+#endif /* RASTER_ALGEBRA_NODE_HPP_ */
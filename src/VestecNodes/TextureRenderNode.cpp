@@ -1,5 +1,8 @@
 
 #include "TextureRenderNode.hpp"
+#include "../common/RasterProbe.hpp"
+#include "../common/RasterStatistics.hpp"
+#include "../common/TextureStatistics.hpp"
 #include "../../../../src/cs-utils/filesystem.hpp"
 
 #include <VistaKernel/GraphicsManager/VistaGraphicsManager.h>
@@ -7,9 +10,12 @@
 #include <VistaKernel/VistaSystem.h>
 #include <VistaKernelOpenSGExt/VistaOpenSGMaterialTools.h>
 
+#include <nlohmann/json.hpp>
+
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 
+#include <chrono>
 #include <thread>
 #include <vector>
 
@@ -42,6 +48,14 @@ TextureRenderNode::TextureRenderNode(
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TextureRenderNode::~TextureRenderNode() {
+  {
+    // Loading threads must not access the node anymore
+    std::lock_guard<std::mutex> lock(mLoadState->mMutex);
+    mLoadState->mIsAlive = false;
+    CancelLoad();
+    CancelStack();
+    ReleasePin(mPinned);
+  }
   m_pAnchor->DisconnectChild(m_pNode.get());
   delete m_pRenderer;
 }
@@ -84,6 +98,14 @@ void TextureRenderNode::Init(VNE::NodeEditor *pEditor) {
             ->SetMinMaxDataRange(filePath);
       }));
 
+  pEditor->GetGuiItem()->registerCallback<double, bool>(
+      "TextureRenderNode.setAutoRange",
+      "Fits the data range to the percentiles of the displayed pixels",
+      std::function([pEditor](double id, bool enable) {
+        pEditor->GetNode<TextureRenderNode>(std::lround(id))
+            ->SetAutoRange(enable);
+      }));
+
   // Callback which reads simulation data (path+x is given from JavaScript)
   pEditor->GetGuiItem()->registerCallback<double, std::string>(
       "TextureRenderNode.readSimulationResults", "Reads simulation data",
@@ -209,52 +231,349 @@ void TextureRenderNode::SetUseTime(bool use) { m_pRenderer->SetUseTime(use); }
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void TextureRenderNode::SetMinMaxDataRange(std::string filePath) {
-  std::thread(std::function([this, filePath]() {
-    int bands = GDALReader::ReadNumberOfLayers(filePath);
-    double min = INT_MAX;
-    double max = INT_MIN;
-
-    GDALReader::GreyScaleTexture texture;
-    for (int l = 1; l < bands + 1; ++l) {
-      GDALReader::ReadGrayScaleTexture(texture, filePath, l);
-      min = std::min(min, texture.dataRange[0]);
-      max = std::max(max, texture.dataRange[1]);
+  {
+    std::lock_guard<std::mutex> lock(mLoadState->mMutex);
+    mLoadState->mRangeFile = filePath;
+  }
+
+  std::thread(std::function([this, state = mLoadState, filePath]() {
+    // The statistics are only computed once per file, afterwards this is a
+    // lookup and no band needs to be warped
+    std::array<double, 2> range{};
+    if (!RasterStatistics::GetRange(filePath, 0, range)) {
+      return;
+    }
+
+    // The node may be removed or another file selected meanwhile. The loading
+    // threads read the texture under the same lock
+    std::lock_guard<std::mutex> lock(state->mMutex);
+    if (!state->mIsAlive || state->mRangeFile != filePath) {
+      return;
     }
-    m_Texture.dataRange[0] = min;
-    m_Texture.dataRange[1] = max;
+    m_Texture.dataRange = range;
 
-    m_pItem->callJavascript("TextureRenderNode.setRange", GetID(), min, max);
+    // The range of the displayed pixels is sent once the texture is loaded
+    if (state->mAutoRange) {
+      return;
+    }
+
+    m_pItem->callJavascript("TextureRenderNode.setRange", GetID(), range[0],
+                            range[1]);
   }))
       .detach();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TextureRenderNode::UnloadTexture() { m_pRenderer->UnloadTexture(); }
+void TextureRenderNode::SetAutoRange(bool enable) {
+  std::lock_guard<std::mutex> lock(mLoadState->mMutex);
+  mLoadState->mAutoRange = enable;
+  if (!m_Texture.buffer) {
+    return;
+  }
+
+  // The percentiles were computed by the loader, so toggling does not scan
+  // the pixels on the main thread
+  std::array<double, 2> range = m_Texture.dataRange;
+  if (enable) {
+    if (!mPercentileRange) {
+      return;
+    }
+    range = mPercentileRange.value();
+  }
+
+  m_pRenderer->SetDataRange(static_cast<float>(range[0]),
+                            static_cast<float>(range[1]));
+  m_pItem->callJavascript("TextureRenderNode.setRange", GetID(), range[0],
+                          range[1]);
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void TextureRenderNode::ReadSimulationResult(std::string filename) {
-  // Read the GDAL texture (grayscale only 1 float channel)
-  GDALReader::ReadGrayScaleTexture(m_Texture, filename, m_iLayerID);
-
-  // If we have multiple laxers compute the global min max range
-  int bands = GDALReader::ReadNumberOfLayers(filename);
-  if (bands > 1) {
-    double min = INT_MAX;
-    double max = INT_MIN;
-    GDALReader::GreyScaleTexture texture;
-    for (int l = 1; l < bands + 1; ++l) {
-      GDALReader::ReadGrayScaleTexture(texture, filename, l);
-      min = std::min(min, texture.dataRange[0]);
-      max = std::max(max, texture.dataRange[1]);
+void TextureRenderNode::SetProbePosition(
+    std::optional<std::array<double, 2>> const &lngLat) {
+  GDALReader::GreyScaleTexture texture;
+  std::shared_ptr<const TimeSeriesStack::Stack> stack;
+  {
+    // Copies share the pixels, the lookup does not block the loading threads
+    std::lock_guard<std::mutex> lock(mLoadState->mMutex);
+    if (lngLat == mProbePosition &&
+        mLoadState->mProbeRevision == mProbedRevision) {
+      return;
+    }
+    mProbePosition = lngLat;
+    mProbedRevision = mLoadState->mProbeRevision;
+    texture = m_Texture;
+    stack = mStack;
+
+    // Only files which are probed need their stack
+    if (lngLat) {
+      RequestStack();
     }
-    m_Texture.dataRange[0] = min;
-    m_Texture.dataRange[1] = max;
   }
 
-  // Add the new texture for rendering
-  m_pRenderer->SetOverlayTexture(m_Texture);
-  m_pItem->callJavascript("TextureRenderNode.setMipMapLevels", GetID(),
-                          m_pRenderer->GetMipMapLevels());
+  std::optional<float> value;
+  float sample = 0.F;
+  if (lngLat && RasterProbe::Sample(texture, lngLat.value()[0],
+                                    lngLat.value()[1], sample)) {
+    value = sample;
+  }
+
+  // The values of a pixel are next to each other in the stack
+  std::vector<float> series;
+  if (lngLat && stack) {
+    TimeSeriesStack::ReadSeries(*stack, lngLat.value()[0], lngLat.value()[1],
+                                series);
+  }
+
+  if (series != mProbeSeries) {
+    mProbeSeries = series;
+
+    nlohmann::json values = nlohmann::json::array();
+    for (float entry : series) {
+      values.push_back(entry == RASTER_NO_DATA ? nlohmann::json()
+                                               : nlohmann::json(entry));
+    }
+    m_pItem->callJavascript("TextureRenderNode.setProbeSeries", GetID(),
+                            series.empty() ? "" : values.dump());
+  }
+
+  // Only changes are sent, e.g. neighbouring pixels often have the same value
+  if (value == mProbeValue) {
+    return;
+  }
+  mProbeValue = value;
+
+  if (value) {
+    m_pItem->callJavascript("TextureRenderNode.setProbeValue", GetID(),
+                            value.value());
+  } else {
+    m_pItem->callJavascript("TextureRenderNode.setProbeValue", GetID(), "");
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRenderNode::UnloadTexture() {
+  std::lock_guard<std::mutex> lock(mLoadState->mMutex);
+
+  // Pending loads must not show their texture anymore
+  ++mLoadState->mGeneration;
+  CancelLoad();
+  mPrefetcher.Cancel();
+  m_pRenderer->UnloadTexture();
+  ReleasePin(mPinned);
+
+  // The unloaded pixels must not be probed anymore
+  m_Texture.buffer = RasterView();
+  mPercentileRange.reset();
+  CancelStack();
+  mStackFile.clear();
+  ++mLoadState->mProbeRevision;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRenderNode::ReleasePin(PinnedTexture &pin) {
+  if (!pin.mFile.empty()) {
+    GDALReader::UnpinTexture(pin.mFile, pin.mLayer, pin.mWindow);
+    pin.mFile.clear();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRenderNode::CancelLoad() {
+  if (mLoadTicket) {
+    mLoadTicket->Cancel();
+    mLoadTicket.reset();
+  }
+  ReleasePin(mPending);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRenderNode::SetStackSource(
+    std::string const &filename,
+    std::optional<GDALReader::Window> const &window) {
+  // Scrubbing through the layers of a file keeps its stack
+  if (filename == mStackFile && window == mStackWindow) {
+    return;
+  }
+  CancelStack();
+  mStackFile = filename;
+  mStackWindow = window;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRenderNode::RequestStack() {
+  if (mStackFile.empty() || !mStackKey.empty()) {
+    return;
+  }
+
+  // Layer 0 stands for all layers, like the keys of the stack cache
+  std::string key = GDALReader::GetCacheKey(mStackFile, 0, mStackWindow);
+  mStackKey = key;
+
+  // All layers are warped, which takes a while for large files. The stack
+  // must not delay the reads of displayed layers
+  mStackTicket = RasterLoader::Run(
+      GetName(), RasterLoader::Priority::Low,
+      [this, state = mLoadState, filename = mStackFile, window = mStackWindow,
+       key](RasterLoader::Ticket &ticket) {
+        if (GDALReader::ReadNumberOfLayers(filename) < 2) {
+          return;
+        }
+        auto stack = TimeSeriesStack::Get(filename, window);
+
+        std::lock_guard<std::mutex> lock(state->mMutex);
+        if (state->mIsAlive && !ticket.IsCancelled() && mStackKey == key) {
+          mStack = stack;
+          ++state->mProbeRevision;
+        }
+      });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRenderNode::CancelStack() {
+  // The task checks the ticket with the mutex of the load state locked, so it
+  // does not use Ticket::Deliver, which Cancel would wait for
+  if (mStackTicket) {
+    mStackTicket->Cancel();
+    mStackTicket.reset();
+  }
+  mStack.reset();
+  mStackKey.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureRenderNode::ReadSimulationResult(std::string filename) {
+  // Only the region around the incident area is loaded if one is selected
+  auto window = csp::vestec::Plugin::getIncidentBounds();
+  int layer = m_iLayerID;
+
+  std::lock_guard<std::mutex> lock(mLoadState->mMutex);
+
+  // Scrubbing through files or layers must not queue up loads which are never
+  // shown. A load which is running already still ends up in the cache
+  CancelLoad();
+  uint64_t generation = ++mLoadState->mGeneration;
+
+  // Keep the texture in the cache while it is loaded and shown, loading other
+  // textures must not evict it
+  GDALReader::PinTexture(filename, layer, window);
+  mPending = {filename, layer, window};
+
+  auto start = std::chrono::steady_clock::now();
+  auto milliseconds = [start]() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+
+  // A newer file was selected or the node was removed meanwhile. The
+  // callbacks run on a loader thread and may race with a cancellation
+  auto isCurrent = [state = mLoadState, generation]() {
+    return state->mIsAlive && state->mGeneration == generation;
+  };
+
+  // Set if the preview replaced the displayed texture, guarded by the mutex
+  // of the load state
+  auto previewShown = std::make_shared<bool>(false);
+
+  // Show a coarse preview first, large files take a while to be warped
+  auto onPreview = [this, state = mLoadState, isCurrent, milliseconds,
+                    filename,
+                    previewShown](GDALReader::GreyScaleTexture const &preview) {
+    std::lock_guard<std::mutex> lock(state->mMutex);
+    if (isCurrent()) {
+      GDALReader::GreyScaleTexture texture = preview;
+      m_pRenderer->SetOverlayTexture(texture);
+      *previewShown = true;
+      csp::vestec::logger().info(
+          "[TextureRenderNode] Preview of {} shown after {:.1f} ms", filename,
+          milliseconds());
+    }
+  };
+
+  auto onLoaded = [this, state = mLoadState, isCurrent, milliseconds, filename,
+                   window,
+                   previewShown](GDALReader::GreyScaleTexture const &loaded) {
+    if (!loaded.buffer) {
+      std::lock_guard<std::mutex> lock(state->mMutex);
+      if (!isCurrent()) {
+        return;
+      }
+      csp::vestec::logger().error(
+          "[TextureRenderNode] Failed to load {}, keeping the shown texture",
+          filename);
+
+      // The displayed texture stays pinned, only the failed one is released.
+      // A preview of the failed file is replaced by the previous texture
+      if (*previewShown) {
+        m_pRenderer->SetOverlayTexture(m_Texture);
+      }
+      ReleasePin(mPending);
+      return;
+    }
+
+    GDALReader::GreyScaleTexture texture = loaded;
+
+    // If we have multiple layers use the global min max range of all layers
+    std::array<double, 2> range{};
+    if (GDALReader::ReadNumberOfLayers(filename) > 1 &&
+        RasterStatistics::GetRange(filename, 0, range)) {
+      texture.dataRange = range;
+    }
+
+    // The percentiles are computed on the loader thread, even if the auto
+    // range is disabled, so that enabling it is a lookup. The node keeps the
+    // range of the file, so that the auto range can be disabled again
+    std::optional<std::array<double, 2>> percentileRange;
+    std::array<double, 2> autoRange{};
+    if (TextureStatistics::GetAutoRange(texture, autoRange)) {
+      percentileRange = autoRange;
+    }
+
+    std::lock_guard<std::mutex> lock(state->mMutex);
+    if (!isCurrent()) {
+      return;
+    }
+
+    // Replace the preview with the full resolution texture
+    m_Texture = texture;
+    mPercentileRange = percentileRange;
+    ++state->mProbeRevision;
+    m_pRenderer->SetOverlayTexture(m_Texture);
+    if (state->mAutoRange && percentileRange) {
+      m_pRenderer->SetDataRange(static_cast<float>(autoRange[0]),
+                                static_cast<float>(autoRange[1]));
+      m_pItem->callJavascript("TextureRenderNode.setRange", GetID(),
+                              autoRange[0], autoRange[1]);
+    }
+    csp::vestec::logger().info(
+        "[TextureRenderNode] Full resolution of {} shown after {:.1f} ms",
+        filename, milliseconds());
+
+    // The previous texture is not displayed anymore and may be evicted
+    ReleasePin(mPinned);
+    mPinned = mPending;
+    mPending = PinnedTexture();
+
+    // The stack is built once the displayed file is probed
+    SetStackSource(filename, window);
+
+    m_pItem->callJavascript("TextureRenderNode.setMipMapLevels", GetID(),
+                            m_pRenderer->GetMipMapLevels());
+  };
+
+  mLoadTicket =
+      RasterLoader::Load(filename, layer, window, RasterLoader::Priority::High,
+                         onLoaded, onPreview);
+
+  // Scrubbing through layers or time steps should only hit the cache
+  mPrefetcher.Update(filename, layer, window);
 }
\ No newline at end of file
@@ -5,11 +5,22 @@
 #include "../NodeEditor/Node.hpp"
 #include "../Plugin.hpp"
 #include "../Rendering/TextureOverlayRenderer.hpp"
+#include "../common/RasterLoader.hpp"
+#include "../common/RasterPrefetcher.hpp"
+#include "../common/TimeSeriesStack.hpp"
 
 #include "../../../../src/cs-core/GraphicsEngine.hpp"
 #include "../../../../src/cs-core/SolarSystem.hpp"
 #include "../../../../src/cs-scene/CelestialAnchorNode.hpp"
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
 namespace VNE {
 class NodeEditor;
 }
@@ -45,7 +56,9 @@ public:
 
   /**
    * Reads the simulation results from the file into a GL texture
-   * which is used to draw an overlay over a planet
+   * which is used to draw an overlay over a planet. The file is read in the
+   * background, a low resolution preview is shown until the full resolution
+   * texture is available. A load which is not finished yet is cancelled
    */
   void ReadSimulationResult(std::string filename);
 
@@ -89,6 +102,26 @@ public:
    */
   void SetMinMaxDataRange(std::string filePath);
 
+  /**
+   * Fits the data range to the 2nd and 98th percentile of the displayed
+   * pixels, so that a few outliers do not squeeze the transfer function.
+   * Disabling it restores the range of the file. The percentiles are computed
+   * when the texture is loaded
+   */
+  void SetAutoRange(bool enable);
+
+  /**
+   * Shows the value of the displayed texture at a position (lng, lat in
+   * radians), e.g. the one under the cursor. The value is looked up in main
+   * memory without a GPU readback. For files with multiple layers, the values
+   * of all layers are shown as a chart once their time series stack is built.
+   * The stack is only requested when the displayed file is probed first.
+   * No position hides the values. The values are only looked up again if the
+   * position, the texture or the stack changed, so this may be called every
+   * frame
+   */
+  void SetProbePosition(std::optional<std::array<double, 2>> const &lngLat);
+
   /**
    * Unloads the currently used texture
    */
@@ -105,8 +138,83 @@ public:
   void SetTextureLayerID(int layerID);
 
 private:
+  /**
+   * A texture layer which is pinned in the GDALReader cache
+   */
+  struct PinnedTexture {
+    std::string mFile; //! Empty if nothing is pinned
+    int mLayer = 1;
+    std::optional<GDALReader::Window> mWindow;
+  };
+
+  /**
+   * Releases a pin in the GDALReader cache
+   */
+  static void ReleasePin(PinnedTexture &pin);
+
+  /**
+   * Cancels the pending load and releases its pin. Must be called with the
+   * mutex of the load state locked
+   */
+  void CancelLoad();
+
+  /**
+   * Sets the file and window whose stack is built on the first probe. The
+   * stack of another file is discarded. Must be called with the mutex of the
+   * load state locked
+   */
+  void SetStackSource(std::string const &filename,
+                      std::optional<GDALReader::Window> const &window);
+
+  /**
+   * Builds the time series stack of the displayed file in the background as
+   * a low priority loader task, unless it was requested already. Files with
+   * a single layer have no stack. Must be called with the mutex of the load
+   * state locked
+   */
+  void RequestStack();
+
+  /**
+   * Cancels the stack request and discards the stack. Must be called with the
+   * mutex of the load state locked
+   */
+  void CancelStack();
+
+  /**
+   * State shared with the loading threads, which may outlive the node
+   */
+  struct LoadState {
+    std::mutex mMutex;
+    uint64_t mGeneration = 0;            //! Incremented per load and unload
+    bool mIsAlive = true;                //! False once the node is destroyed
+    std::atomic<bool> mAutoRange{false}; //! Range from the pixel percentiles
+    std::string mRangeFile; //! File of the latest SetMinMaxDataRange call
+    uint64_t mProbeRevision = 0; //! Incremented when m_Texture or mStack change
+  };
+
+  std::shared_ptr<LoadState> mLoadState = std::make_shared<LoadState>();
+
+  std::shared_ptr<RasterLoader::Ticket> mLoadTicket; //! The pending load
+  PinnedTexture mPinned;            //! The displayed texture
+  PinnedTexture mPending;           //! The texture which is being loaded
+  RasterPrefetcher mPrefetcher;     //! Warms the layers after the selected one
+  std::optional<float> mProbeValue; //! Value shown in the node editor
+  std::vector<float> mProbeSeries;  //! Series shown in the node editor
+  std::optional<std::array<double, 2>>
+      mProbePosition;           //! Position of mProbeValue and mProbeSeries
+  uint64_t mProbedRevision = 0; //! Probe revision of mProbeValue
+
+  std::shared_ptr<const TimeSeriesStack::Stack>
+      mStack;             //! All layers of the displayed file, for the probe
+  std::string mStackFile; //! File of the displayed texture, empty if none
+  std::optional<GDALReader::Window> mStackWindow; //! Window of mStackFile
+  std::string mStackKey; //! Identifies the requested stack, empty if none
+  std::shared_ptr<RasterLoader::Ticket> mStackTicket; //! Builds mStack
+
   GDALReader::GreyScaleTexture
       m_Texture;      //! This texture will be rendered as overlay
+  std::optional<std::array<double, 2>>
+      mPercentileRange; //! Auto range of m_Texture, computed by the loader
   int m_iLayerID = 1; //! The current layer within the texture (geoTiff)
   std::vector<double>
       minMaxRange; //! The data range used to define a texture color
@@ -1,5 +1,7 @@
 
 #include "UncertaintyRenderNode.hpp"
+#include "../common/GridResampler.hpp"
+#include "../common/RasterStatistics.hpp"
 #include "../../../../src/cs-utils/filesystem.hpp"
 
 #include <VistaKernel/GraphicsManager/VistaGraphicsManager.h>
@@ -7,6 +9,7 @@
 #include <VistaKernel/VistaSystem.h>
 #include <VistaKernelOpenSGExt/VistaOpenSGMaterialTools.h>
 
+#include <algorithm>
 #include <iomanip>
 #include <thread>
 #include <vector>
@@ -40,8 +43,16 @@ UncertaintyRenderNode::UncertaintyRenderNode(
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 UncertaintyRenderNode::~UncertaintyRenderNode() {
+  {
+    // Loading threads must not access the node anymore
+    std::lock_guard<std::mutex> lock(mState->mMutex);
+    mState->mIsAlive = false;
+  }
+
+  CancelLoads();
   m_pAnchor->DisconnectChild(m_pNode.get());
   delete m_pRenderer;
+  ReplacePinnedFiles({}, std::nullopt);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -154,39 +165,163 @@ void UncertaintyRenderNode::SetTransferFunctionUncertainty(std::string json) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void UncertaintyRenderNode::SetTextureFiles(std::string jsonFilenames) {
-  double min = 100000;
-  double max = 0;
+  nlohmann::json args = nlohmann::json::parse(jsonFilenames);
+
+  // Only the region around the incident area is loaded if one is selected
+  auto window = csp::vestec::Plugin::getIncidentBounds();
+
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(mState->mMutex);
+    generation = ++mState->mGeneration;
+  }
+
+  // Pin the textures first, reading a later member must not evict an earlier
+  // one. All members are requested at once, the loader reads them in parallel
+  // and cancels them if another set of files is selected before
+  std::vector<std::string> files;
+  std::vector<std::shared_ptr<RasterLoader::Ticket>> tickets;
+  for (auto &filename : args) {
+    files.push_back(filename);
+    GDALReader::PinTexture(filename, 1, window);
+    tickets.push_back(RasterLoader::Load(filename, 1, window,
+                                         RasterLoader::Priority::Normal));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mLoadTicketsMutex);
+    for (auto const &ticket : mLoadTickets) {
+      ticket->Cancel();
+    }
+    mLoadTickets = tickets;
 
-  // Create a thead to load the data and do not block main thread
-  std::thread threadLoad([=, &min, &max]() {
-    // Forward to OGL renderer
-    nlohmann::json args = nlohmann::json::parse(jsonFilenames);
+    // Warm the files of the following time steps of every member
+    mPrefetchers.resize(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+      if (!mPrefetchers[i]) {
+        mPrefetchers[i] = std::make_unique<RasterPrefetcher>();
+      }
+      mPrefetchers[i]->Update(files[i], 1, window);
+    }
+  }
+
+  // Create a thead to wait for the data and do not block main thread
+  std::thread threadLoad([this, state = mState, generation, files, tickets,
+                          window]() {
+    // Another set of files was selected or the node was removed meanwhile.
+    // Must be called with the mutex of the state locked
+    auto isCurrent = [&state, generation]() {
+      return state->mIsAlive && state->mGeneration == generation;
+    };
+    auto unpinFiles = [&files, &window]() {
+      for (auto const &filename : files) {
+        GDALReader::UnpinTexture(filename, 1, window);
+      }
+    };
 
     // Create textures
     std::vector<GDALReader::GreyScaleTexture> vecTextures;
 
-    // range-based for over persistence pairs
-    for (auto &filename : args) {
-      // Read the GDAL texture (grayscale only 1 float channel)
-      GDALReader::GreyScaleTexture texture;
-      GDALReader::ReadGrayScaleTexture(texture, filename);
-      vecTextures.push_back(texture);
-      if (texture.dataRange[0] < min) {
-        min = texture.dataRange[0];
+    // The range is known from the statistics before any texture is warped
+    double min = 100000;
+    double max = 0;
+    for (auto &filename : files) {
+      std::array<double, 2> range{};
+      if (RasterStatistics::GetRange(filename, 1, range)) {
+        min = std::min(min, range[0]);
+        max = std::max(max, range[1]);
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(state->mMutex);
+      if (!isCurrent()) {
+        unpinFiles();
+        return;
+      }
+      m_pItem->callJavascript("UncertaintyRenderNode.setRange", GetID(), min,
+                              max);
+    }
+
+    for (size_t i = 0; i < tickets.size(); ++i) {
+      auto texture = tickets[i]->Wait();
+
+      // Another set of files was selected meanwhile
+      if (!texture) {
+        unpinFiles();
+        return;
       }
 
-      if (texture.dataRange[1] > max) {
-        max = texture.dataRange[1];
+      // The renderer combines all members, the shown set is kept if one of
+      // them is missing
+      if (!texture->buffer) {
+        csp::vestec::logger().error(
+            "[UncertaintyRenderNode] Failed to load {}, keeping the shown "
+            "textures",
+            files[i]);
+        unpinFiles();
+        return;
       }
+      vecTextures.push_back(texture.value());
+    }
+
+    // The members are cropped to their own valid pixels and may even come
+    // from different grids, the renderer needs them on a common grid
+    if (!GridResampler::Align(vecTextures, GridResampler::Kernel::Bilinear)) {
+      csp::vestec::logger().error(
+          "[UncertaintyRenderNode] Failed to align the textures, keeping the "
+          "shown textures");
+      unpinFiles();
+      return;
     }
+
+    // The renderer is deleted only after the node is marked as dead
+    std::lock_guard<std::mutex> lock(state->mMutex);
+    if (!isCurrent()) {
+      unpinFiles();
+      return;
+    }
+
     // Add the new texture for rendering
     m_pRenderer->SetOverlayTextures(vecTextures);
+    ReplacePinnedFiles(files, window);
   });
   threadLoad.detach();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  m_pItem->callJavascript("UncertaintyRenderNode.setRange", GetID(), min, max);
+void UncertaintyRenderNode::UnloadTexture() {
+  {
+    // Pending loads must not show their textures anymore
+    std::lock_guard<std::mutex> lock(mState->mMutex);
+    ++mState->mGeneration;
+  }
+
+  CancelLoads();
+  m_pRenderer->UnloadTexture();
+  ReplacePinnedFiles({}, std::nullopt);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UncertaintyRenderNode::ReplacePinnedFiles(
+    std::vector<std::string> files,
+    std::optional<GDALReader::Window> const &window) {
+  std::lock_guard<std::mutex> lock(mPinnedFilesMutex);
+  for (auto const &file : mPinnedFiles) {
+    GDALReader::UnpinTexture(file, 1, mPinnedWindow);
+  }
+  mPinnedFiles = std::move(files);
+  mPinnedWindow = window;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void UncertaintyRenderNode::UnloadTexture() { m_pRenderer->UnloadTexture(); }
\ No newline at end of file
+void UncertaintyRenderNode::CancelLoads() {
+  std::lock_guard<std::mutex> lock(mLoadTicketsMutex);
+  for (auto const &ticket : mLoadTickets) {
+    ticket->Cancel();
+  }
+  mLoadTickets.clear();
+  mPrefetchers.clear();
+}
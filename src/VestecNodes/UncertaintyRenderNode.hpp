@@ -5,11 +5,18 @@
 #include "../NodeEditor/Node.hpp"
 #include "../Plugin.hpp"
 #include "../Rendering/UncertaintyRenderer.hpp"
+#include "../common/RasterLoader.hpp"
+#include "../common/RasterPrefetcher.hpp"
 
 #include "../../../../src/cs-core/GraphicsEngine.hpp"
 #include "../../../../src/cs-core/SolarSystem.hpp"
 #include "../../../../src/cs-scene/CelestialAnchorNode.hpp"
 
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
 namespace VNE {
 class NodeEditor;
 }
@@ -65,8 +72,40 @@ public:
   UncertaintyOverlayRenderer *GetRenderNode();
 
 private:
+  /**
+   * Releases the pins of the displayed textures and stores the new ones
+   */
+  void ReplacePinnedFiles(std::vector<std::string> files,
+                          std::optional<GDALReader::Window> const &window);
+
+  /**
+   * Cancels the loads of the previous set of files and all prefetches
+   */
+  void CancelLoads();
+
+  /**
+   * State shared with the loading threads, which may outlive the node
+   */
+  struct State {
+    std::mutex mMutex;
+    uint64_t mGeneration = 0; //! Incremented per set of files and unload
+    bool mIsAlive = true;     //! False once the node is destroyed
+  };
+
+  std::shared_ptr<State> mState = std::make_shared<State>();
+
   csp::vestec::Plugin::Settings
       mPluginConfig; //! Needed to access a path defined in the Plugin::Settings
+  std::mutex mPinnedFilesMutex; //! Loading threads may replace the pins
+  std::vector<std::string>
+      mPinnedFiles; //! Files pinned in the GDALReader cache while displayed
+  std::optional<GDALReader::Window>
+      mPinnedWindow; //! Window of the pinned files
+  std::mutex mLoadTicketsMutex;
+  std::vector<std::shared_ptr<RasterLoader::Ticket>>
+      mLoadTickets; //! Loads of the most recently selected files
+  std::vector<std::unique_ptr<RasterPrefetcher>>
+      mPrefetchers; //! Warm the following files of each ensemble member
   cs::scene::CelestialAnchorNode *m_pAnchor =
       nullptr; //! Anchor on which the TextureOverlayRenderer is added (normally
                //! centered in earth)
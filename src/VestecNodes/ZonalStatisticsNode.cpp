@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR //
+//      and may be used under the terms of the MIT license. See the LICENSE file
+//      for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR) //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "ZonalStatisticsNode.hpp"
+#include "../../../../src/cs-utils/filesystem.hpp"
+#include "../NodeEditor/NodeEditor.hpp"
+
+#include <nlohmann/json.hpp>
+
+ZonalStatisticsNode::ZonalStatisticsNode(cs::gui::GuiItem *pItem, int id)
+    : VNE::Node(pItem, id, 1, 0) {
+  // Initialize GDAL only once
+  GDALReader::InitGDAL();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ZonalStatisticsNode::~ZonalStatisticsNode() {
+  // Running tasks must not report to the node anymore
+  CancelTasks();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string ZonalStatisticsNode::GetName() { return "ZonalStatisticsNode"; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ZonalStatisticsNode::Init(VNE::NodeEditor *pEditor) {
+  csp::vestec::logger().debug("[{}] Init", GetName());
+
+  const std::string node = cs::utils::filesystem::loadToString(
+      "../share/resources/gui/js/csp-vestec-zonal-statistics-node.js");
+  pEditor->GetGuiItem()->executeJavascript(node);
+
+  pEditor->GetGuiItem()->registerCallback<double, std::string>(
+      "ZonalStatisticsNode.setFile",
+      "Sets the texture whose statistics are computed",
+      std::function([pEditor](double id, std::string file) {
+        pEditor->GetNode<ZonalStatisticsNode>(std::lround(id))->SetFile(file);
+      }));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ZonalStatisticsNode::SetFile(const std::string &file) {
+  // The statistics of the previous file are not needed anymore
+  CancelTasks();
+  mState = std::make_shared<State>();
+
+  if (file.empty()) {
+    m_pItem->callJavascript("ZonalStatisticsNode.setStatistics", GetID(), "");
+    return;
+  }
+
+  // Reading the file may take a while, do not block the main thread
+  mReadTicket = RasterLoader::Run(
+      GetName(), RasterLoader::Priority::Normal,
+      [pItem = m_pItem, id = GetID(), state = mState,
+       file](RasterLoader::Ticket &ticket) {
+        GDALReader::GreyScaleTexture texture;
+        GDALReader::ReadGrayScaleTexture(texture, file);
+
+        // Polygons set before the texture was read are not computed, this
+        // task computes the latest one
+        bool delivered = ticket.Deliver([&]() {
+          std::lock_guard<std::mutex> lock(state->mMutex);
+          state->mTexture = texture;
+          state->mPolygon = csp::vestec::Plugin::getIncidentPolygon();
+          state->mPolygonChanged = true;
+          state->mIsComputing = true;
+        });
+
+        if (delivered) {
+          ComputeStatistics(pItem, id, state, ticket);
+        }
+      });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ZonalStatisticsNode::SetPolygon(ZonalStatistics::Polygon const &polygon) {
+  std::lock_guard<std::mutex> lock(mState->mMutex);
+
+  // The polygon is emitted every frame while a corner is dragged
+  if (polygon == mState->mPolygon) {
+    return;
+  }
+  mState->mPolygon = polygon;
+  mState->mPolygonChanged = true;
+
+  // A running task picks the latest polygon up when it is done
+  if (!mState->mTexture.buffer || mState->mIsComputing) {
+    return;
+  }
+  mState->mIsComputing = true;
+
+  mComputeTicket = RasterLoader::Run(
+      GetName(), RasterLoader::Priority::Normal,
+      [pItem = m_pItem, id = GetID(),
+       state = mState](RasterLoader::Ticket &ticket) {
+        ComputeStatistics(pItem, id, state, ticket);
+      });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ZonalStatisticsNode::ComputeStatistics(
+    cs::gui::GuiItem *pItem, int id, std::shared_ptr<State> const &state,
+    RasterLoader::Ticket &ticket) {
+  std::unique_lock<std::mutex> lock(state->mMutex);
+  while (state->mPolygonChanged && state->mTexture.buffer &&
+         !ticket.IsCancelled()) {
+    state->mPolygonChanged = false;
+
+    // Copies share the pixels, the statistics do not block the other threads
+    GDALReader::GreyScaleTexture texture = state->mTexture;
+    ZonalStatistics::Polygon polygon = state->mPolygon;
+    lock.unlock();
+
+    std::optional<ZonalStatistics::Statistics> statistics(std::in_place);
+    if (!ZonalStatistics::Compute(texture, polygon, statistics.value())) {
+      statistics.reset();
+    }
+    ticket.Deliver([&]() { SendStatistics(pItem, id, statistics); });
+
+    lock.lock();
+  }
+  state->mIsComputing = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ZonalStatisticsNode::CancelTasks() {
+  for (auto const &ticket : {mReadTicket, mComputeTicket}) {
+    if (ticket) {
+      ticket->Cancel();
+    }
+  }
+  mReadTicket.reset();
+  mComputeTicket.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ZonalStatisticsNode::SendStatistics(
+    cs::gui::GuiItem *pItem, int id,
+    std::optional<ZonalStatistics::Statistics> const &statistics) {
+  if (!statistics) {
+    pItem->callJavascript("ZonalStatisticsNode.setStatistics", id, "");
+    return;
+  }
+
+  nlohmann::json json;
+  json["pixels"] = statistics->pixels;
+  json["validPixels"] = statistics->validPixels;
+  json["sum"] = statistics->sum;
+  json["mean"] = statistics->mean;
+  json["min"] = statistics->min;
+  json["max"] = statistics->max;
+  json["histogram"] = statistics->histogram;
+  json["histogramRange"] = statistics->histogramRange;
+  pItem->callJavascript("ZonalStatisticsNode.setStatistics", id, json.dump());
+}
@@ -0,0 +1,95 @@
+#ifndef ZONAL_STATISTICS_NODE_HPP_
+#define ZONAL_STATISTICS_NODE_HPP_
+
+#include "../NodeEditor/Node.hpp"
+#include "../Plugin.hpp"
+#include "../common/RasterLoader.hpp"
+#include "../common/ZonalStatistics.hpp"
+
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace VNE {
+class NodeEditor;
+}
+
+/**
+ * Shows the sum, mean, minimum, maximum and histogram of the input texture
+ * within the incident area, e.g. the population at risk. The statistics are
+ * updated while a corner of the area is dragged.
+ *
+ * @see ZonalStatistics
+ */
+class ZonalStatisticsNode : public VNE::Node {
+public:
+  ZonalStatisticsNode(cs::gui::GuiItem *pItem, int id);
+  virtual ~ZonalStatisticsNode();
+
+  /**
+   * These static functions are required and needs to be implemented
+   */
+  static void Init(VNE::NodeEditor *pEditor);
+
+  /**
+   * Returns the unique identifier for the node as string
+   */
+  static std::string GetName();
+
+  /**
+   * Reads the first layer of the file in the background. The whole raster is
+   * read, so that moving the incident area does not read it again. An empty
+   * path clears the statistics
+   */
+  void SetFile(const std::string &file);
+
+  /**
+   * Computes the statistics within the polygon in the background and sends
+   * them to the node editor. Called whenever the incident area changes.
+   * Polygons set while the statistics are computed are coalesced, only the
+   * latest one is computed next. An unchanged polygon is ignored
+   */
+  void SetPolygon(ZonalStatistics::Polygon const &polygon);
+
+private:
+  /**
+   * State of the selected file shared with the loader tasks. Each file gets a
+   * new state, tasks of a previous file only see their own
+   */
+  struct State {
+    std::mutex mMutex;
+    GDALReader::GreyScaleTexture mTexture;
+    ZonalStatistics::Polygon mPolygon; //! Latest incident area
+    bool mIsComputing = false;    //! True while a task computes statistics
+    bool mPolygonChanged = false; //! True if mPolygon is not computed yet
+  };
+
+  /**
+   * Computes the statistics of the latest polygon until it does not change
+   * anymore or the ticket is cancelled. Runs as a loader task, at most one
+   * per node
+   */
+  static void ComputeStatistics(cs::gui::GuiItem *pItem, int id,
+                                std::shared_ptr<State> const &state,
+                                RasterLoader::Ticket &ticket);
+
+  /**
+   * Sends the statistics to the node editor. No statistics clear them
+   */
+  static void
+  SendStatistics(cs::gui::GuiItem *pItem, int id,
+                 std::optional<ZonalStatistics::Statistics> const &statistics);
+
+  /**
+   * Cancels the tasks of the selected file
+   */
+  void CancelTasks();
+
+  std::shared_ptr<State> mState = std::make_shared<State>();
+  std::shared_ptr<RasterLoader::Ticket>
+      mReadTicket; //! Reads the file and computes the first statistics
+  std::shared_ptr<RasterLoader::Ticket>
+      mComputeTicket; //! Computes the statistics of a changed polygon
+};
+
+#endif /* ZONAL_STATISTICS_NODE_HPP_ */
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR //
+//      and may be used under the terms of the MIT license. See the LICENSE file
+//      for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR) //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../common/TextureStatistics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+namespace {
+
+/**
+ * Returns the best time of the repetitions in milliseconds
+ */
+double Measure(int repetitions, std::function<void()> const &function) {
+  double best = 0.0;
+  for (int repetition = 0; repetition < repetitions; ++repetition) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = repetition == 0 ? elapsed.count() : std::min(best, elapsed.count());
+  }
+  return best;
+}
+
+} // namespace
+
+/**
+ * Compares the scalar and the vectorized kernels of the TextureStatistics on a
+ * synthetic warped raster. Usage:
+ *
+ *   csp-vestec-statistics-benchmark [size] [repetitions]
+ *
+ * The raster is size x size pixels (default 4096). Like a warped raster it
+ * has no data outside of a circle, which is about a fifth of the pixels.
+ */
+int main(int argc, char **argv) {
+  int size = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 4096;
+  int repetitions = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 5;
+
+  auto pixels =
+      RasterBuffer::Allocate(static_cast<size_t>(size) * size, RASTER_NO_DATA);
+  auto *data = static_cast<float *>(pixels->Data());
+  double radius = 0.5 * size;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      double dx = x - radius;
+      double dy = y - radius;
+      if (dx * dx + dy * dy < radius * radius) {
+        double value = 1000.0 * std::sin(0.01 * x) * std::cos(0.01 * y);
+        data[static_cast<size_t>(y) * size + x] = static_cast<float>(value);
+      }
+    }
+  }
+
+  GDALReader::GreyScaleTexture texture;
+  texture.buffer = RasterView(std::move(pixels), size, size);
+  texture.x = size;
+  texture.y = size;
+
+  std::printf("%d x %d pixels, %d repetitions\n", size, size, repetitions);
+  std::printf("%-14s %12s %12s %8s\n", "kernel", "scalar [ms]", "simd [ms]",
+              "speedup");
+
+  struct Kernel {
+    const char *name;
+    std::function<void()> function;
+  };
+
+  std::array<double, 2> range{};
+  Kernel kernels[] = {
+      {"range",
+       [&]() { TextureStatistics::ComputeRange(texture.buffer, range); }},
+      {"histogram", [&]() { TextureStatistics::Compute(texture.buffer); }},
+      {"auto range",
+       [&]() { TextureStatistics::GetAutoRange(texture, range); }},
+  };
+
+  TextureStatistics::SetVectorized(true);
+  bool hasVectorized = TextureStatistics::IsVectorized();
+
+  for (auto const &kernel : kernels) {
+    TextureStatistics::SetVectorized(false);
+    double scalar = Measure(repetitions, kernel.function);
+
+    if (!hasVectorized) {
+      std::printf("%-14s %12.1f %12s %8s\n", kernel.name, scalar, "-", "-");
+      continue;
+    }
+
+    TextureStatistics::SetVectorized(true);
+    double vectorized = Measure(repetitions, kernel.function);
+    std::printf("%-14s %12.1f %12.1f %8.2f\n", kernel.name, scalar, vectorized,
+                scalar / vectorized);
+  }
+
+  TextureStatistics::SetVectorized(true);
+  return 0;
+}
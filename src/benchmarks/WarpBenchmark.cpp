@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                               This file is part of CosmoScout VR //
+//      and may be used under the terms of the MIT license. See the LICENSE file
+//      for details.     //
+//                        Copyright: (c) 2019 German Aerospace Center (DLR) //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "../common/GDALReader.hpp"
+#include "../common/RasterDiskCache.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+ * Measures how the reprojection of all rasters in a directory scales with the
+ * number of warp threads. Usage:
+ *
+ *   csp-vestec-benchmarks [directory] [repetitions]
+ *
+ * The directory defaults to the bundled tif files. The caches are cleared
+ * before every file, so each repetition performs a full warp.
+ */
+int main(int argc, char **argv) {
+  std::string directory =
+      argc > 1 ? argv[1] : "../share/vestec/data/tif_files";
+  int repetitions = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 3;
+
+  std::vector<std::string> files;
+  boost::system::error_code error;
+  for (boost::filesystem::directory_iterator it(directory, error), end;
+       !error && it != end; it.increment(error)) {
+    if (it->path().extension() == ".tif") {
+      files.push_back(it->path().string());
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  if (files.empty()) {
+    std::fprintf(stderr, "No tif files found in '%s'\n", directory.c_str());
+    return 1;
+  }
+
+  GDALReader::InitGDAL();
+  RasterDiskCache::SetDirectory("");
+
+  GDALReader::SetWarpThreads(0);
+  int maxThreads = GDALReader::GetWarpThreads();
+
+  std::vector<int> threadCounts;
+  for (int threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  std::printf("%zu files, %d repetitions\n", files.size(), repetitions);
+  std::printf("%8s %12s %8s\n", "threads", "time [ms]", "speedup");
+
+  double singleThreaded = 0.0;
+  for (int threads : threadCounts) {
+    GDALReader::SetWarpThreads(threads);
+
+    double best = 0.0;
+    for (int repetition = 0; repetition < repetitions; ++repetition) {
+      double total = 0.0;
+      for (auto const &file : files) {
+        GDALReader::ClearCache();
+
+        std::vector<GDALReader::GreyScaleTexture> layers;
+        auto start = std::chrono::steady_clock::now();
+        GDALReader::ReadAllLayers(layers, file);
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        total += elapsed.count();
+      }
+      best = repetition == 0 ? total : std::min(best, total);
+    }
+
+    if (threads == 1) {
+      singleThreaded = best;
+    }
+
+    std::printf("%8d %12.1f %8.2f\n", threads, best, singleThreaded / best);
+  }
+
+  return 0;
+}
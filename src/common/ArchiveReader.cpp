@@ -0,0 +1,154 @@
+#include "ArchiveReader.hpp"
+#include "../../../../src/cs-utils/filesystem.hpp"
+
+// GDAL c++ includes
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+
+namespace {
+
+const std::string ARCHIVE_PREFIX = "/vsizip/";
+
+// Local file header signature at the start of every zip archive
+const std::string ZIP_SIGNATURE = "PK\x03\x04";
+
+std::string WithoutTrailingSlash(std::string path) {
+  while (path.size() > 1 && path.back() == '/') {
+    path.pop_back();
+  }
+  return path;
+}
+
+bool Stat(const std::string &path, VSIStatBufL &stat) {
+  return VSIStatL(path.c_str(), &stat) == 0;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArchiveReader::IsArchive(const std::string &filename) {
+  std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
+  std::string signature(ZIP_SIGNATURE.size(), '\0');
+  return file.read(&signature[0], signature.size()) &&
+         signature == ZIP_SIGNATURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string ArchiveReader::GetMemberPath(const std::string &archive,
+                                         const std::string &member) {
+  // The braces allow archives without a .zip extension, like the downloads
+  // which are named by their uuid
+  std::string path = ARCHIVE_PREFIX + "{" + archive + "}";
+  if (!member.empty()) {
+    path += "/" + member;
+  }
+  return path;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArchiveReader::IsArchivePath(const std::string &path) {
+  return path.compare(0, ARCHIVE_PREFIX.size(), ARCHIVE_PREFIX) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string ArchiveReader::GetArchiveFile(const std::string &path) {
+  if (!IsArchivePath(path)) {
+    return path;
+  }
+
+  size_t start = ARCHIVE_PREFIX.size();
+  if (path.compare(start, 1, "{") == 0) {
+    size_t end = path.find('}', start);
+    return end == std::string::npos ? path
+                                    : path.substr(start + 1, end - start - 1);
+  }
+
+  // Archives with an extension may be addressed without braces
+  size_t end = path.find(".zip", start);
+  return end == std::string::npos ? path : path.substr(start, end + 4 - start);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ArchiveReader::IsFile(const std::string &path) {
+  if (!IsArchivePath(path)) {
+    boost::system::error_code error;
+    return boost::filesystem::is_regular_file(path, error);
+  }
+
+  VSIStatBufL stat{};
+  return Stat(path, stat) && VSI_ISREG(stat.st_mode);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::set<std::string> ArchiveReader::ListFiles(const std::string &directory) {
+  if (!IsArchivePath(directory)) {
+    return cs::utils::filesystem::listFiles(directory);
+  }
+  return ListEntries(directory, false);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::set<std::string> ArchiveReader::ListDirs(const std::string &directory) {
+  if (!IsArchivePath(directory)) {
+    return cs::utils::filesystem::listDirs(directory);
+  }
+  return ListEntries(directory, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::set<std::string> ArchiveReader::ListMembers(const std::string &archive) {
+  std::set<std::string> members;
+  if (!IsArchive(archive)) {
+    return members;
+  }
+
+  std::string root = GetMemberPath(archive);
+  char **entries = VSIReadDirRecursive(root.c_str());
+  for (int i = 0; i < CSLCount(entries); ++i) {
+    std::string member = WithoutTrailingSlash(entries[i]);
+    VSIStatBufL stat{};
+    if (Stat(root + "/" + member, stat) && VSI_ISREG(stat.st_mode)) {
+      members.insert(GetMemberPath(archive, member));
+    }
+  }
+  CSLDestroy(entries);
+
+  return members;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::set<std::string> ArchiveReader::ListEntries(const std::string &directory,
+                                                 bool directories) {
+  std::set<std::string> result;
+  std::string parent = WithoutTrailingSlash(directory);
+
+  char **entries = VSIReadDir(parent.c_str());
+  for (int i = 0; i < CSLCount(entries); ++i) {
+    std::string name = WithoutTrailingSlash(entries[i]);
+    if (name == "." || name == "..") {
+      continue;
+    }
+
+    std::string path = parent + "/" + name;
+    VSIStatBufL stat{};
+    if (Stat(path, stat) && (VSI_ISDIR(stat.st_mode) != 0) == directories) {
+      result.insert(path);
+    }
+  }
+  CSLDestroy(entries);
+
+  return result;
+}
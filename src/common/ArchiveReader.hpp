@@ -0,0 +1,69 @@
+#ifndef VESTEC_ARCHIVE_READER
+#define VESTEC_ARCHIVE_READER
+
+#include <set>
+#include <string>
+
+/**
+ * Access to the members of downloaded zip archives without extracting them.
+ * Members are addressed with paths of GDAL's /vsizip/ virtual file system,
+ * e.g. "/vsizip/{/downloads/<uuid>}/results/day_1.tif". Such paths can be
+ * passed to the GDALReader like any other file name. GDAL reads the members
+ * directly from the archive and only inflates the requested parts.
+ *
+ * The listing functions accept archive paths as well as regular directories,
+ * so nodes which list files do not need to distinguish them.
+ */
+class ArchiveReader {
+public:
+  /**
+   * Returns true if the file is a zip archive, independent of its extension
+   */
+  static bool IsArchive(const std::string &filename);
+
+  /**
+   * Returns the path of a member (or directory) within an archive. An empty
+   * member addresses the root of the archive
+   */
+  static std::string GetMemberPath(const std::string &archive,
+                                   const std::string &member = "");
+
+  /**
+   * Returns true if the path addresses something within an archive
+   */
+  static bool IsArchivePath(const std::string &path);
+
+  /**
+   * Returns the archive file of an archive path, or the path itself for
+   * regular paths
+   */
+  static std::string GetArchiveFile(const std::string &path);
+
+  /**
+   * Returns true if the path is a regular file or a file within an archive
+   */
+  static bool IsFile(const std::string &path);
+
+  /**
+   * Full paths of the files or directories directly within a directory. Like
+   * cs::utils::filesystem::listFiles and listDirs for regular directories
+   */
+  static std::set<std::string> ListFiles(const std::string &directory);
+  static std::set<std::string> ListDirs(const std::string &directory);
+
+  /**
+   * Full paths of all files within an archive, including those in
+   * subdirectories. Returns an empty set if the file is not an archive
+   */
+  static std::set<std::string> ListMembers(const std::string &archive);
+
+private:
+  /**
+   * Lists the entries of a directory within an archive which are
+   * directories or not
+   */
+  static std::set<std::string> ListEntries(const std::string &directory,
+                                           bool directories);
+};
+
+#endif // VESTEC_ARCHIVE_READER
@@ -0,0 +1,307 @@
+#include "CompressedRasterCache.hpp"
+
+// GDAL c++ includes
+#include "cpl_conv.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// Blocks are large enough to compress well and small enough to be spread
+// over all threads
+const size_t BLOCK_BYTES = 256 * 1024;
+
+// Fastest zlib level, most of the gain comes from the no data areas
+const int COMPRESSION_LEVEL = 1;
+
+// Textures which compress worse than this are cheaper to read again
+const double MAX_COMPRESSION_RATIO = 0.75;
+
+// Evicted textures keep their pixels until they are compressed. If loading
+// evicts faster than the compression keeps up, the oldest ones are dropped
+const size_t MAX_QUEUED_BYTES = 256ul * 1024ul * 1024ul;
+
+// Bytes of the band of a texture, the buffer may be shared with other bands
+size_t GetPixelBytes(GDALReader::GreyScaleTexture const &texture) {
+  return static_cast<size_t>(texture.buffer.Width()) *
+         texture.buffer.Height() * texture.buffer.BytesPerPixel();
+}
+
+} // namespace
+
+// Default budget of the compressed tier, can be overwritten in the plugin
+// settings with "vestec-compressed-cache-size"
+LRUCache<std::shared_ptr<const CompressedRasterCache::Raster>>
+    CompressedRasterCache::mCache(256ul * 1024ul * 1024ul);
+std::mutex CompressedRasterCache::mQueueMutex;
+std::condition_variable CompressedRasterCache::mWakeUp;
+std::list<std::pair<std::string, GDALReader::GreyScaleTexture>>
+    CompressedRasterCache::mQueue;
+size_t CompressedRasterCache::mQueuedBytes = 0;
+std::thread CompressedRasterCache::mWorker;
+bool CompressedRasterCache::mIsStopping = false;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CompressedRasterCache::SetBudget(size_t bytes) {
+  csp::vestec::logger().info(
+      "[CompressedRasterCache] Compressed cache budget set to {} MB",
+      bytes / (1024 * 1024));
+  mCache.SetBudget(bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CompressedRasterCache::Store(const std::string &key,
+                                  GDALReader::GreyScaleTexture const &texture) {
+  if (!texture.buffer || mCache.GetStatistics().budget == 0 ||
+      mCache.Contains(key)) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mQueueMutex);
+  if (mIsStopping) {
+    return;
+  }
+
+  for (auto const &queued : mQueue) {
+    if (queued.first == key) {
+      return;
+    }
+  }
+
+  mQueue.emplace_back(key, texture);
+  mQueuedBytes += GetPixelBytes(texture);
+  while (mQueuedBytes > MAX_QUEUED_BYTES && mQueue.size() > 1) {
+    csp::vestec::logger().debug(
+        "[CompressedRasterCache] Compression lags behind, dropping {}",
+        mQueue.front().first);
+    mQueuedBytes -= GetPixelBytes(mQueue.front().second);
+    mQueue.pop_front();
+  }
+
+  if (!mWorker.joinable()) {
+    mWorker = std::thread(&CompressedRasterCache::Work);
+  }
+  mWakeUp.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CompressedRasterCache::Work() {
+  while (true) {
+    std::pair<std::string, GDALReader::GreyScaleTexture> entry;
+    {
+      std::unique_lock<std::mutex> lock(mQueueMutex);
+      mWakeUp.wait(lock, []() { return mIsStopping || !mQueue.empty(); });
+      if (mIsStopping) {
+        return;
+      }
+
+      // The entry stays queued until it is stored, so that it can be restored
+      // while it is compressed
+      entry = mQueue.front();
+    }
+
+    Compress(entry.first, entry.second);
+
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    auto it = std::find_if(mQueue.begin(), mQueue.end(), [&entry](auto &e) {
+      return e.first == entry.first;
+    });
+    if (it != mQueue.end()) {
+      mQueuedBytes -= GetPixelBytes(it->second);
+      mQueue.erase(it);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CompressedRasterCache::Compress(
+    const std::string &key, GDALReader::GreyScaleTexture const &texture) {
+  auto start = std::chrono::steady_clock::now();
+  RasterView pixels = texture.buffer.Compact();
+  size_t rowBytes =
+      static_cast<size_t>(pixels.Width()) * pixels.BytesPerPixel();
+  size_t rawBytes = rowBytes * pixels.Height();
+  if (rawBytes == 0) {
+    return;
+  }
+
+  auto raster = std::make_shared<Raster>();
+  raster->texture = texture;
+  raster->texture.x = pixels.Width();
+  raster->texture.y = pixels.Height();
+  raster->texture.buffer = RasterView();
+  raster->type = pixels.Type();
+  raster->encoding = pixels.Encoding();
+  raster->blockRows = static_cast<int>(std::max<size_t>(
+      1, std::min<size_t>(BLOCK_BYTES / rowBytes, pixels.Height())));
+
+  int blocks = (pixels.Height() + raster->blockRows - 1) / raster->blockRows;
+  raster->blocks.resize(blocks);
+  auto const *data = static_cast<const unsigned char *>(pixels.Data());
+
+  bool failed = false;
+#pragma omp parallel for schedule(dynamic)
+  for (int block = 0; block < blocks; ++block) {
+    int y = block * raster->blockRows;
+    int rows = std::min(raster->blockRows, pixels.Height() - y);
+
+    size_t size = 0;
+    void *compressed =
+        CPLZLibDeflate(data + y * rowBytes, rows * rowBytes, COMPRESSION_LEVEL,
+                       nullptr, 0, &size);
+    if (compressed == nullptr) {
+#pragma omp atomic write
+      failed = true;
+      continue;
+    }
+
+    auto const *bytes = static_cast<const uint8_t *>(compressed);
+    raster->blocks[block].assign(bytes, bytes + size);
+    CPLFree(compressed);
+  }
+
+  size_t compressedBytes = 0;
+  for (auto const &block : raster->blocks) {
+    compressedBytes += block.size();
+  }
+
+  if (failed || compressedBytes > rawBytes * MAX_COMPRESSION_RATIO) {
+    csp::vestec::logger().debug(
+        "[CompressedRasterCache] Not storing {}, it compresses to {:.0f}%", key,
+        100.0 * compressedBytes / rawBytes);
+    return;
+  }
+
+  mCache.Insert(key, raster, compressedBytes);
+  csp::vestec::logger().debug(
+      "[CompressedRasterCache] Compressed {} from {} to {} KB in {:.1f} ms",
+      key, rawBytes / 1024, compressedBytes / 1024,
+      std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CompressedRasterCache::Restore(const std::string &key,
+                                    GDALReader::GreyScaleTexture &texture) {
+  {
+    // The pixels of a queued texture are still in memory
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    for (auto const &queued : mQueue) {
+      if (queued.first == key) {
+        texture = queued.second;
+        return true;
+      }
+    }
+  }
+
+  auto raster = mCache.Get(key);
+  if (!raster) {
+    return false;
+  }
+
+  auto const &compressed = *raster.value();
+  int width = compressed.texture.x;
+  int height = compressed.texture.y;
+  auto buffer = RasterBuffer::Allocate(static_cast<size_t>(width) * height,
+                                       compressed.type, 0.0);
+  if (!Decompress(compressed, buffer->Data())) {
+    return false;
+  }
+
+  texture = compressed.texture;
+  texture.buffer = RasterView(buffer, width, height, 1, compressed.encoding);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CompressedRasterCache::Contains(const std::string &key) {
+  {
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    for (auto const &queued : mQueue) {
+      if (queued.first == key) {
+        return true;
+      }
+    }
+  }
+  return mCache.Contains(key);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CompressedRasterCache::Clear() {
+  {
+    // A texture which is compressed right now is still stored afterwards
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    mQueue.clear();
+    mQueuedBytes = 0;
+  }
+  mCache.Clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void CompressedRasterCache::Shutdown() {
+  std::thread worker;
+  {
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    mIsStopping = true;
+    mQueue.clear();
+    mQueuedBytes = 0;
+    worker.swap(mWorker);
+  }
+  mWakeUp.notify_all();
+
+  if (worker.joinable()) {
+    worker.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mQueueMutex);
+  mIsStopping = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+LRUCache<std::shared_ptr<const CompressedRasterCache::Raster>>::Statistics
+CompressedRasterCache::GetStatistics() {
+  return mCache.GetStatistics();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CompressedRasterCache::Decompress(Raster const &raster, void *target) {
+  size_t rowBytes =
+      static_cast<size_t>(raster.texture.x) * GetPixelSize(raster.type);
+  auto *data = static_cast<unsigned char *>(target);
+
+  int blocks = static_cast<int>(raster.blocks.size());
+  bool failed = false;
+#pragma omp parallel for schedule(dynamic)
+  for (int block = 0; block < blocks; ++block) {
+    int y = block * raster.blockRows;
+    int rows = std::min(raster.blockRows, raster.texture.y - y);
+    size_t expected = rows * rowBytes;
+
+    size_t size = 0;
+    auto const &compressed = raster.blocks[block];
+    if (CPLZLibInflate(compressed.data(), compressed.size(),
+                       data + y * rowBytes, expected, &size) == nullptr ||
+        size != expected) {
+#pragma omp atomic write
+      failed = true;
+    }
+  }
+
+  if (failed) {
+    csp::vestec::logger().error(
+        "[CompressedRasterCache] Failed to decompress a raster");
+  }
+  return !failed;
+}
@@ -0,0 +1,114 @@
+#ifndef VESTEC_COMPRESSED_RASTER_CACHE
+#define VESTEC_COMPRESSED_RASTER_CACHE
+
+#include "GDALReader.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Second, compressed tier of the GDALReader texture cache. Textures which are
+ * evicted from the memory cache are compressed and kept here within their own
+ * byte budget, until they are requested again and promoted back. Warped
+ * rasters are mostly no data outside of the source, so they shrink a lot.
+ * Decompressing a texture is much cheaper than reading and warping it again.
+ *
+ * The pixels are compressed in blocks of rows with the zlib deflate of GDAL.
+ * All blocks are compressed and decompressed in parallel. Evicted textures are
+ * compressed on a background thread, so that an insertion into the memory
+ * cache does not wait for the compression of the textures it evicts.
+ */
+class CompressedRasterCache {
+public:
+  /**
+   * A compressed texture. The texture itself carries the size, bounds and
+   * data range but no pixels
+   */
+  struct Raster {
+    GDALReader::GreyScaleTexture texture;
+    PixelType type = PixelType::Float32;
+    PixelEncoding encoding;
+    int blockRows{}; //! Rows per block, the last block may have less
+    std::vector<std::vector<uint8_t>> blocks;
+  };
+
+  /**
+   * Sets the budget of the compressed textures in bytes. 0 disables the tier
+   */
+  static void SetBudget(size_t bytes);
+
+  /**
+   * Queues a texture which is evicted from the memory cache for compression.
+   * Textures which do not compress well are not stored. If the textures
+   * waiting for compression exceed their budget, the oldest ones are dropped
+   */
+  static void Store(const std::string &key,
+                    GDALReader::GreyScaleTexture const &texture);
+
+  /**
+   * Decompresses a texture into a new buffer. Returns false if the key is not
+   * stored. The texture stays in this tier, so it does not need to be
+   * compressed again when it is evicted from the memory cache the next time.
+   * A texture which still waits for compression is returned as it is
+   */
+  static bool Restore(const std::string &key,
+                      GDALReader::GreyScaleTexture &texture);
+
+  /**
+   * Returns true if the key is stored or waits for compression. Does not
+   * change the eviction order
+   */
+  static bool Contains(const std::string &key);
+
+  /**
+   * Removes all compressed textures and the ones waiting for compression
+   */
+  static void Clear();
+
+  /**
+   * Drops the queued textures and waits for the running compression
+   */
+  static void Shutdown();
+
+  /**
+   * Counters of the compressed tier, the bytes are compressed bytes
+   */
+  static LRUCache<std::shared_ptr<const Raster>>::Statistics GetStatistics();
+
+private:
+  /**
+   * Compresses a texture and stores it, runs on the compression thread
+   */
+  static void Compress(const std::string &key,
+                       GDALReader::GreyScaleTexture const &texture);
+
+  /**
+   * Decompresses all blocks of a raster into target in parallel
+   */
+  static bool Decompress(Raster const &raster, void *target);
+
+  /**
+   * Main loop of the compression thread
+   */
+  static void Work();
+
+  static LRUCache<std::shared_ptr<const Raster>> mCache;
+
+  static std::mutex mQueueMutex; //! Guards the queue and the worker
+  static std::condition_variable mWakeUp;
+  //! Textures waiting for compression, oldest first
+  static std::list<std::pair<std::string, GDALReader::GreyScaleTexture>>
+      mQueue;
+  static size_t mQueuedBytes; //! Uncompressed size of the queued textures
+  static std::thread mWorker;
+  static bool mIsStopping;
+};
+
+#endif // VESTEC_COMPRESSED_RASTER_CACHE
@@ -0,0 +1,350 @@
+#include "ContourExtractor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+// Number of cells per side of a tile which is processed by a single thread
+const int TILE_SIZE = 64;
+
+bool IsNoData(float value) {
+  return std::isnan(value) || value == RASTER_NO_DATA;
+}
+
+/**
+ * Crossing of an isoline with two cell edges. Edges are identified by their
+ * first pixel and their direction, so both cells of an edge use the same id
+ */
+struct Segment {
+  std::array<uint64_t, 2> edges;
+};
+
+uint64_t HorizontalEdge(int width, int x, int y) {
+  return (static_cast<uint64_t>(y) * width + x) * 2;
+}
+
+uint64_t VerticalEdge(int width, int x, int y) {
+  return (static_cast<uint64_t>(y) * width + x) * 2 + 1;
+}
+
+/**
+ * Position in pixels where the isoline crosses an edge. The position is
+ * interpolated linearly between the two pixels of the edge
+ */
+std::array<double, 2> GetCrossing(const float *values, int width,
+                                  float isovalue, uint64_t edge) {
+  int x = static_cast<int>((edge / 2) % width);
+  int y = static_cast<int>((edge / 2) / width);
+  bool isVertical = edge % 2 == 1;
+
+  float from = values[static_cast<size_t>(y) * width + x];
+  float to = isVertical ? values[static_cast<size_t>(y + 1) * width + x]
+                        : values[static_cast<size_t>(y) * width + x + 1];
+  double t = (isovalue - from) / static_cast<double>(to - from);
+
+  return {x + (isVertical ? 0.0 : t), y + (isVertical ? t : 0.0)};
+}
+
+/**
+ * Appends the segments of the cells in [x0, x1) x [y0, y1) to segments
+ */
+void MarchCells(const float *values, int width, float isovalue, int x0,
+                int y0, int x1, int y1, std::vector<Segment> &segments) {
+  for (int y = y0; y < y1; ++y) {
+    for (int x = x0; x < x1; ++x) {
+      // Corners and edges in clockwise order, starting top left. Edge k
+      // connects corner k and corner k + 1
+      std::array<float, 4> corners = {
+          values[static_cast<size_t>(y) * width + x],
+          values[static_cast<size_t>(y) * width + x + 1],
+          values[static_cast<size_t>(y + 1) * width + x + 1],
+          values[static_cast<size_t>(y + 1) * width + x]};
+      if (std::any_of(corners.begin(), corners.end(), IsNoData)) {
+        continue;
+      }
+
+      std::array<bool, 4> isAbove{};
+      int aboveCorners = 0;
+      for (int k = 0; k < 4; ++k) {
+        isAbove[k] = corners[k] >= isovalue;
+        aboveCorners += isAbove[k] ? 1 : 0;
+      }
+      if (aboveCorners == 0 || aboveCorners == 4) {
+        continue;
+      }
+
+      std::array<uint64_t, 4> edges = {
+          HorizontalEdge(width, x, y), VerticalEdge(width, x + 1, y),
+          HorizontalEdge(width, x, y + 1), VerticalEdge(width, x, y)};
+
+      std::array<int, 4> crossed{};
+      int crossings = 0;
+      for (int k = 0; k < 4; ++k) {
+        if (isAbove[k] != isAbove[(k + 1) % 4]) {
+          crossed[crossings++] = k;
+        }
+      }
+
+      if (crossings == 2) {
+        segments.push_back({{edges[crossed[0]], edges[crossed[1]]}});
+        continue;
+      }
+
+      // A saddle: each corner on the other side of the isovalue than the
+      // center of the cell is cut off by its own segment
+      float center = (corners[0] + corners[1] + corners[2] + corners[3]) / 4.F;
+      bool isCenterAbove = center >= isovalue;
+      for (int k = 0; k < 4; ++k) {
+        if (isAbove[k] != isCenterAbove) {
+          segments.push_back({{edges[(k + 3) % 4], edges[k]}});
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Connects segments which share an edge into chains of edges
+ */
+std::vector<std::vector<uint64_t>>
+StitchSegments(std::vector<Segment> const &segments) {
+  // Every edge belongs to two cells at most, so an end of a segment has one
+  // neighbour at most
+  std::vector<std::pair<uint64_t, int>> ends;
+  ends.reserve(segments.size() * 2);
+  for (int i = 0; i < static_cast<int>(segments.size()); ++i) {
+    ends.emplace_back(segments[i].edges[0], i);
+    ends.emplace_back(segments[i].edges[1], i);
+  }
+  std::sort(ends.begin(), ends.end());
+
+  std::vector<std::array<int, 2>> neighbours(segments.size(), {-1, -1});
+  for (size_t i = 0; i + 1 < ends.size(); ++i) {
+    if (ends[i].first != ends[i + 1].first) {
+      continue;
+    }
+    uint64_t edge = ends[i].first;
+    int a = ends[i].second;
+    int b = ends[i + 1].second;
+    neighbours[a][segments[a].edges[0] == edge ? 0 : 1] = b;
+    neighbours[b][segments[b].edges[0] == edge ? 0 : 1] = a;
+  }
+
+  // Follows the neighbours from a segment through the given end
+  std::vector<bool> isVisited(segments.size(), false);
+  auto follow = [&](int first, int end, std::vector<uint64_t> &chain) {
+    int current = first;
+    uint64_t edge = segments[first].edges[end];
+    for (;;) {
+      int next = neighbours[current][segments[current].edges[0] == edge ? 0
+                                                                        : 1];
+      if (next < 0 || isVisited[next]) {
+        return next == first;
+      }
+      isVisited[next] = true;
+      edge = segments[next].edges[segments[next].edges[0] == edge ? 1 : 0];
+      chain.push_back(edge);
+      current = next;
+    }
+  };
+
+  std::vector<std::vector<uint64_t>> chains;
+  for (int i = 0; i < static_cast<int>(segments.size()); ++i) {
+    if (isVisited[i]) {
+      continue;
+    }
+    isVisited[i] = true;
+
+    std::vector<uint64_t> chain = {segments[i].edges[0], segments[i].edges[1]};
+    // A closed loop already ends with the edge it started with
+    if (!follow(i, 1, chain)) {
+      std::vector<uint64_t> head;
+      follow(i, 0, head);
+      chain.insert(chain.begin(), head.rbegin(), head.rend());
+    }
+    chains.push_back(std::move(chain));
+  }
+
+  return chains;
+}
+
+/**
+ * Douglas-Peucker simplification of a polyline in pixels
+ */
+void Simplify(std::vector<std::array<double, 2>> &points, double tolerance) {
+  if (points.size() < 3 || tolerance <= 0.0) {
+    return;
+  }
+
+  std::vector<bool> isKept(points.size(), false);
+  isKept.front() = true;
+  isKept.back() = true;
+
+  std::vector<std::pair<size_t, size_t>> ranges = {{0, points.size() - 1}};
+  while (!ranges.empty()) {
+    auto [first, last] = ranges.back();
+    ranges.pop_back();
+
+    auto const &a = points[first];
+    auto const &b = points[last];
+    double dx = b[0] - a[0];
+    double dy = b[1] - a[1];
+    double length = std::sqrt(dx * dx + dy * dy);
+
+    // The distance to the line through a and b, or to a if both are equal
+    double maxDistance = 0.0;
+    size_t farthest = first;
+    for (size_t i = first + 1; i < last; ++i) {
+      double px = points[i][0] - a[0];
+      double py = points[i][1] - a[1];
+      double distance = length > 0.0 ? std::abs(px * dy - py * dx) / length
+                                     : std::sqrt(px * px + py * py);
+      if (distance > maxDistance) {
+        maxDistance = distance;
+        farthest = i;
+      }
+    }
+
+    if (maxDistance > tolerance) {
+      isKept[farthest] = true;
+      ranges.emplace_back(first, farthest);
+      ranges.emplace_back(farthest, last);
+    }
+  }
+
+  size_t count = 0;
+  for (size_t i = 0; i < points.size(); ++i) {
+    if (isKept[i]) {
+      points[count++] = points[i];
+    }
+  }
+  points.resize(count);
+}
+
+} // namespace
+
+const double ContourExtractor::DEFAULT_TOLERANCE = 0.25;
+
+// Isolines are small compared to textures
+LRUCache<std::shared_ptr<const std::vector<ContourExtractor::Polyline>>>
+    ContourExtractor::ContourCache(64ul * 1024ul * 1024ul);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<ContourExtractor::Polyline>
+ContourExtractor::Extract(GDALReader::GreyScaleTexture const &texture,
+                          float isovalue, double tolerance) {
+  if (!texture.buffer || texture.buffer.Width() < 2 ||
+      texture.buffer.Height() < 2 || IsNoData(isovalue)) {
+    return {};
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  // Cells need random access to two rows, so the pixels are decoded once
+  RasterView view = texture.buffer.Decoded();
+  const auto *values = static_cast<const float *>(view.Data());
+  int width = view.Width();
+  int height = view.Height();
+
+  // Each tile collects its own segments, so the result does not depend on the
+  // order in which the tiles are processed
+  int tilesX = (width - 1 + TILE_SIZE - 1) / TILE_SIZE;
+  int tilesY = (height - 1 + TILE_SIZE - 1) / TILE_SIZE;
+  std::vector<std::vector<Segment>> tileSegments(
+      static_cast<size_t>(tilesX) * tilesY);
+
+#pragma omp parallel for schedule(dynamic)
+  for (int tile = 0; tile < tilesX * tilesY; ++tile) {
+    int x0 = (tile % tilesX) * TILE_SIZE;
+    int y0 = (tile / tilesX) * TILE_SIZE;
+    MarchCells(values, width, isovalue, x0, y0,
+               std::min(x0 + TILE_SIZE, width - 1),
+               std::min(y0 + TILE_SIZE, height - 1), tileSegments[tile]);
+  }
+
+  std::vector<Segment> segments;
+  for (auto &tile : tileSegments) {
+    segments.insert(segments.end(), tile.begin(), tile.end());
+  }
+
+  auto chains = StitchSegments(segments);
+
+  // The warped grid is a regular lng/lat grid with the pixel centers at half
+  // pixels
+  auto const &bounds = texture.lnglatBounds;
+  double lngPerPixel = (bounds[2] - bounds[0]) / width;
+  double latPerPixel = (bounds[3] - bounds[1]) / height;
+
+  std::vector<Polyline> polylines(chains.size());
+
+#pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < static_cast<int>(chains.size()); ++i) {
+    Polyline points;
+    points.reserve(chains[i].size());
+    for (uint64_t edge : chains[i]) {
+      points.push_back(GetCrossing(values, width, isovalue, edge));
+    }
+    Simplify(points, tolerance);
+
+    for (auto &point : points) {
+      point = {bounds[0] + (point[0] + 0.5) * lngPerPixel,
+               bounds[1] + (point[1] + 0.5) * latPerPixel};
+    }
+    polylines[i] = std::move(points);
+  }
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  csp::vestec::logger().debug("[ContourExtractor] Extracted {} isolines of {} "
+                              "from {}x{} pixels in {:.1f} ms",
+                              polylines.size(), isovalue, width, height,
+                              elapsed.count());
+
+  return polylines;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const std::vector<ContourExtractor::Polyline>>
+ContourExtractor::Get(const std::string &filename, int layer,
+                      float isovalue) {
+  std::stringstream key;
+  key << GDALReader::GetCacheKey(filename, layer) << "~"
+      << std::setprecision(9) << isovalue;
+  if (auto cached = ContourCache.Get(key.str())) {
+    return cached.value();
+  }
+
+  GDALReader::GreyScaleTexture texture;
+  GDALReader::ReadGrayScaleTexture(texture, filename, layer);
+  if (!texture.buffer) {
+    csp::vestec::logger().error("[ContourExtractor] Failed to read {}",
+                                filename);
+    return nullptr;
+  }
+
+  auto polylines =
+      std::make_shared<const std::vector<Polyline>>(Extract(texture, isovalue));
+
+  size_t bytes = 0;
+  for (auto const &polyline : *polylines) {
+    bytes += sizeof(Polyline) + polyline.size() * sizeof(polyline[0]);
+  }
+
+  // Another thread may have extracted the same isolines in the meantime
+  if (auto existing = ContourCache.Insert(key.str(), polylines, bytes)) {
+    return existing.value();
+  }
+  return polylines;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ContourExtractor::ClearCache() { ContourCache.Clear(); }
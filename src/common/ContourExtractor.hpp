@@ -0,0 +1,58 @@
+#ifndef VESTEC_CONTOUR_EXTRACTOR
+#define VESTEC_CONTOUR_EXTRACTOR
+
+#include "GDALReader.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Extracts isolines from textures with marching squares, e.g. the fire front
+ * at a given time from a wildfire arrival time raster. The cells of the
+ * texture are processed in tiles which run in parallel. The segments of all
+ * cells are stitched into polylines by the cell edges they share, and the
+ * polylines are simplified with the Douglas-Peucker algorithm.
+ *
+ * The cells span the pixel centers. Cells with a corner without data have no
+ * segments, so isolines end at no data regions. Saddle cells are resolved
+ * with the mean of their corners. Polylines are given as longitude and
+ * latitude in radians, closed polylines end with their first vertex.
+ */
+class ContourExtractor {
+public:
+  using Polyline = std::vector<std::array<double, 2>>;
+
+  /**
+   * Default simplification tolerance in pixels
+   */
+  static const double DEFAULT_TOLERANCE;
+
+  /**
+   * Extracts the isolines of a value. The simplified polylines deviate at most
+   * tolerance pixels from the marching squares segments, 0 keeps all vertices
+   */
+  static std::vector<Polyline>
+  Extract(GDALReader::GreyScaleTexture const &texture, float isovalue,
+          double tolerance = DEFAULT_TOLERANCE);
+
+  /**
+   * Returns the isolines of a value in a layer of a file. The layer is read
+   * with GDALReader::ReadGrayScaleTexture. Isolines are cached per layer and
+   * value, so they can be shown again without extracting them again. Returns
+   * nullptr if the file cannot be read
+   */
+  static std::shared_ptr<const std::vector<Polyline>>
+  Get(const std::string &filename, int layer, float isovalue);
+
+  /**
+   * Removes all isolines from the cache
+   */
+  static void ClearCache();
+
+private:
+  static LRUCache<std::shared_ptr<const std::vector<Polyline>>> ContourCache;
+};
+
+#endif // VESTEC_CONTOUR_EXTRACTOR
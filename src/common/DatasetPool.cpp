@@ -0,0 +1,202 @@
+#include "DatasetPool.hpp"
+#include "RasterDiskCache.hpp"
+
+// GDAL c++ includes
+#include "gdal_priv.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+/**
+ * Maximum number of idle handles of all files. Every warp region and every
+ * statistics thread uses its own handle, so this allows two parallel loads
+ * to reuse all of their handles
+ */
+size_t GetMaxIdleHandles() {
+  return std::max<size_t>(8, 2 * std::thread::hardware_concurrency());
+}
+
+bool IsThreadSafeDriver(GDALDriverH driver) {
+  // The netCDF library has a global state, separate handles do not help
+  const char *name = driver ? GDALGetDriverShortName(driver) : nullptr;
+  return name == nullptr || std::strcmp(name, "netCDF") != 0;
+}
+
+} // namespace
+
+std::map<std::string, DatasetPool::File> DatasetPool::mFiles;
+std::mutex DatasetPool::mMutex;
+std::mutex DatasetPool::mDriverMutex;
+uint64_t DatasetPool::mUseCounter = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DatasetPool::Handle DatasetPool::Acquire(const std::string &filename) {
+  SourceStamp stamp = GetStamp(filename);
+
+  GDALDataset *dataset = nullptr;
+  std::vector<GDALDataset *> stale;
+  {
+    // Files are only added when a handle is released, so files which cannot
+    // be opened leave nothing behind
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mFiles.find(filename);
+    if (it != mFiles.end() && it->second.stamp != stamp) {
+      for (auto const &handle : it->second.idle) {
+        stale.push_back(handle.dataset);
+      }
+      mFiles.erase(it);
+    } else if (it != mFiles.end() && !it->second.idle.empty()) {
+      dataset = it->second.idle.back().dataset;
+      it->second.idle.pop_back();
+      if (it->second.idle.empty()) {
+        mFiles.erase(it);
+      }
+    }
+  }
+
+  for (auto *handle : stale) {
+    Close(handle);
+  }
+
+  if (dataset == nullptr) {
+    if (IsThreadSafeDriver(GDALIdentifyDriver(filename.c_str(), nullptr))) {
+      dataset =
+          static_cast<GDALDataset *>(GDALOpen(filename.c_str(), GA_ReadOnly));
+    } else {
+      std::lock_guard<std::mutex> lock(mDriverMutex);
+      dataset =
+          static_cast<GDALDataset *>(GDALOpen(filename.c_str(), GA_ReadOnly));
+    }
+  }
+
+  if (dataset == nullptr) {
+    return nullptr;
+  }
+
+  return Handle(dataset, [filename, stamp](GDALDataset *dataset) {
+    Release(filename, stamp, dataset);
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DatasetPool::SourceStamp DatasetPool::GetStamp(const std::string &filename) {
+  RasterDiskCache::SourceStamp stamp;
+  if (!RasterDiskCache::GetSourceStamp(filename, stamp)) {
+    return SourceStamp();
+  }
+  return {stamp.size, stamp.modificationTime};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool DatasetPool::IsThreadSafe(GDALDataset *dataset) {
+  return IsThreadSafeDriver(GDALGetDatasetDriver(dataset));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DatasetPool::Clear() {
+  std::vector<GDALDataset *> idle;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto const &file : mFiles) {
+      for (auto const &handle : file.second.idle) {
+        idle.push_back(handle.dataset);
+      }
+    }
+    mFiles.clear();
+  }
+
+  for (auto *dataset : idle) {
+    Close(dataset);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t DatasetPool::GetIdleCount() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  size_t count = 0;
+  for (auto const &file : mFiles) {
+    count += file.second.idle.size();
+  }
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DatasetPool::Release(const std::string &filename,
+                          SourceStamp const &stamp, GDALDataset *dataset) {
+  std::vector<GDALDataset *> closing;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mFiles.find(filename);
+    if (it == mFiles.end()) {
+      it = mFiles.emplace(filename, File{stamp, {}}).first;
+    }
+
+    // The file was modified while the handle was in use
+    if (it->second.stamp != stamp) {
+      closing.push_back(dataset);
+    } else {
+      it->second.idle.push_back({dataset, ++mUseCounter});
+      closing = TrimIdle();
+    }
+  }
+
+  for (auto *handle : closing) {
+    Close(handle);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void DatasetPool::Close(GDALDataset *dataset) {
+  if (IsThreadSafe(dataset)) {
+    GDALClose(dataset);
+  } else {
+    std::lock_guard<std::mutex> lock(mDriverMutex);
+    GDALClose(dataset);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<GDALDataset *> DatasetPool::TrimIdle() {
+  size_t count = 0;
+  for (auto const &file : mFiles) {
+    count += file.second.idle.size();
+  }
+
+  std::vector<GDALDataset *> closing;
+  size_t maxIdle = GetMaxIdleHandles();
+  while (count > maxIdle) {
+    auto oldestFile = mFiles.end();
+    size_t oldestIndex = 0;
+    for (auto it = mFiles.begin(); it != mFiles.end(); ++it) {
+      auto const &idle = it->second.idle;
+      for (size_t i = 0; i < idle.size(); ++i) {
+        if (oldestFile == mFiles.end() ||
+            idle[i].lastUsed < oldestFile->second.idle[oldestIndex].lastUsed) {
+          oldestFile = it;
+          oldestIndex = i;
+        }
+      }
+    }
+
+    auto &idle = oldestFile->second.idle;
+    closing.push_back(idle[oldestIndex].dataset);
+    idle.erase(idle.begin() + static_cast<std::ptrdiff_t>(oldestIndex));
+    if (idle.empty()) {
+      mFiles.erase(oldestFile);
+    }
+    --count;
+  }
+
+  return closing;
+}
@@ -0,0 +1,106 @@
+#ifndef VESTEC_DATASET_POOL
+#define VESTEC_DATASET_POOL
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class GDALDataset;
+
+/**
+ * Pool of read-only GDAL dataset handles. A GDAL dataset must not be used by
+ * two threads at the same time, so every acquired handle is used exclusively
+ * by the thread which acquired it. When the handle is released it is kept
+ * open for the next reader of the same file instead of being closed, which
+ * avoids parsing the headers of a file again for every layer, region and
+ * statistics pass.
+ *
+ * Opening files of different paths does not block each other. Only drivers
+ * which are not thread safe (netCDF) are opened and closed under a lock.
+ * Idle handles of a file are dropped when the file is modified, members of an
+ * archive when the archive is modified.
+ */
+class DatasetPool {
+public:
+  /**
+   * Dataset handle which returns to the pool when the last copy is dropped.
+   * It must not be closed with GDALClose
+   */
+  using Handle = std::shared_ptr<GDALDataset>;
+
+  /**
+   * Returns an idle handle of the file or opens a new one. Returns an empty
+   * handle if the file cannot be opened
+   */
+  static Handle Acquire(const std::string &filename);
+
+  /**
+   * Returns false for datasets of drivers which must not be read by two
+   * threads at the same time, not even through separate handles
+   */
+  static bool IsThreadSafe(GDALDataset *dataset);
+
+  /**
+   * Closes all idle handles
+   */
+  static void Clear();
+
+  /**
+   * Number of idle handles of all files
+   */
+  static size_t GetIdleCount();
+
+private:
+  struct IdleHandle {
+    GDALDataset *dataset;
+    uint64_t lastUsed; //! Value of mUseCounter when it was released
+  };
+
+  /**
+   * Size and modification time of a file, or of its archive
+   */
+  struct SourceStamp {
+    int64_t size{};
+    int64_t modificationTime{};
+
+    bool operator!=(SourceStamp const &other) const {
+      return size != other.size || modificationTime != other.modificationTime;
+    }
+  };
+
+  struct File {
+    SourceStamp stamp;
+    std::vector<IdleHandle> idle;
+  };
+
+  /**
+   * Returns the stamp of RasterDiskCache. Files which are not on the file
+   * system have an empty stamp
+   */
+  static SourceStamp GetStamp(const std::string &filename);
+
+  static void Release(const std::string &filename, SourceStamp const &stamp,
+                      GDALDataset *dataset);
+
+  /**
+   * Closes a dataset, with the driver lock if the driver needs it
+   */
+  static void Close(GDALDataset *dataset);
+
+  /**
+   * Closes the least recently released handles until the limit is met. Needs
+   * to be called with a locked mutex, the handles to close are returned
+   */
+  static std::vector<GDALDataset *> TrimIdle();
+
+  static std::map<std::string, File> mFiles;
+  static std::mutex mMutex;       //! Guards mFiles, never held while opening
+  static std::mutex mDriverMutex; //! Serializes drivers which are not safe
+  static uint64_t mUseCounter;
+};
+
+#endif // VESTEC_DATASET_POOL
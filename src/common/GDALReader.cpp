@@ -1,32 +1,431 @@
 #include "GDALReader.hpp"
+#include "CompressedRasterCache.hpp"
+#include "DatasetPool.hpp"
+#include "RasterDiskCache.hpp"
+#include "RasterStatistics.hpp"
+#include "TextureStatistics.hpp"
 
 // GDAL c++ includes
 #include "cpl_conv.h" // for CPLMalloc()
+#include "cpl_string.h"
+#include "cpl_vsi.h"
 #include "gdal_priv.h"
 #include "gdalwarper.h"
 #include "ogr_spatialref.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <thread>
 
-std::map<std::string, GDALReader::GreyScaleTexture> GDALReader::TextureCache;
-std::mutex GDALReader::mMutex;
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+// Fraction of the window extent which is added on each side of a window
+const double WINDOW_PADDING = 0.1;
+
+// Maximum width and height of preview textures
+const int PREVIEW_SIZE = 512;
+
+// Separates the dataset path and the layer in layer paths
+const std::string LAYER_PATH_MARKER = "#layer=";
+
+// Borders are only cropped if at least this fraction of the pixels is saved,
+// smaller savings do not pay off the copy
+const double MIN_CROP_SAVING = 0.05;
+
+// Memory of the cached suggested grids, including their signatures. A grid
+// with the WKT of its source takes a few kilobytes
+const size_t WARP_GRID_CACHE_SIZE = 1024ul * 1024ul;
+
+// Number of source grids with idle transformers
+const size_t MAX_TRANSFORMER_GRIDS = 8;
+
+// Largest finite half float
+const double HALF_FLOAT_MAX = 65504.0;
+
+/**
+ * Type in which the warped layers are stored and how each layer is encoded
+ */
+struct StorageLayout {
+  PixelType type = PixelType::Float32;
+  bool isEncoded = false; //! Warped to float and encoded afterwards
+  std::vector<PixelEncoding> encodings; //! Per layer
+  std::vector<double> fill; //! Per layer, stored value of uncovered pixels
+  std::vector<int> hasSourceNoData;
+  std::vector<double> sourceNoData;
+};
+
+GDALDataType ToGDALType(PixelType type) {
+  switch (type) {
+  case PixelType::Byte:
+    return GDT_Byte;
+  case PixelType::UInt16:
+    return GDT_UInt16;
+  case PixelType::Int16:
+    return GDT_Int16;
+  default:
+    return GDT_Float32;
+  }
+}
+
+/**
+ * Replaces NaN and the no data value of the source in warped floats with
+ * RASTER_NO_DATA, which is what all users of the textures test for
+ */
+void NormalizeNoData(float *values, size_t count, int hasSourceNoData,
+                     double sourceNoData) {
+  auto noData = static_cast<float>(sourceNoData);
+  for (size_t i = 0; i < count; ++i) {
+    if (std::isnan(values[i]) || (hasSourceNoData && values[i] == noData)) {
+      values[i] = RASTER_NO_DATA;
+    }
+  }
+}
+
+bool IsIntegerIn(double value, double lowest, double highest) {
+  return value >= lowest && value <= highest && std::floor(value) == value;
+}
+
+/**
+ * Selects the storage of the given layers. Integer source types are only kept
+ * if every layer defines a no data value, which is then used for pixels which
+ * are not covered by the source. Bytes without no data value are widened to
+ * 16 bit to reserve a no data value. Everything else falls back to float
+ */
+StorageLayout ChooseLayout(GDALReader::Storage storage, GDALDataset *dataset,
+                           const std::string &filename,
+                           std::vector<int> const &layers) {
+  size_t count = layers.size();
+  StorageLayout layout;
+  layout.encodings.resize(count);
+  layout.fill.assign(count, RASTER_NO_DATA);
+  layout.hasSourceNoData.resize(count);
+  layout.sourceNoData.resize(count);
+
+  bool isSameType = true;
+  bool hasNoData = true;
+  GDALDataType sourceType = GDT_Unknown;
+  for (size_t i = 0; i < count; ++i) {
+    auto *band = dataset->GetRasterBand(layers[i]);
+    layout.sourceNoData[i] = band->GetNoDataValue(&layout.hasSourceNoData[i]);
+    hasNoData = hasNoData && layout.hasSourceNoData[i];
+
+    GDALDataType type = band->GetRasterDataType();
+    isSameType = isSameType && (i == 0 || type == sourceType);
+    sourceType = type;
+  }
+
+  auto useNoData = [&](PixelType type, double lowest, double highest) {
+    for (size_t i = 0; i < count; ++i) {
+      if (!IsIntegerIn(layout.sourceNoData[i], lowest, highest)) {
+        return;
+      }
+    }
+
+    layout.type = type;
+    for (size_t i = 0; i < count; ++i) {
+      layout.encodings[i].hasNoData = true;
+      layout.encodings[i].noData = layout.sourceNoData[i];
+      layout.fill[i] = layout.sourceNoData[i];
+    }
+  };
+
+  auto useEncoding = [&](PixelType type, PixelEncoding const &encoding) {
+    layout.type = type;
+    layout.isEncoded = true;
+    layout.encodings.assign(count, encoding);
+  };
+
+  switch (storage) {
+  case GDALReader::Storage::Float32:
+    break;
+
+  case GDALReader::Storage::Native:
+    if (!isSameType) {
+      break;
+    }
+
+    if (sourceType == GDT_Byte && hasNoData) {
+      useNoData(PixelType::Byte, 0, 255);
+    } else if (sourceType == GDT_Byte) {
+      layout.type = PixelType::UInt16;
+      for (size_t i = 0; i < count; ++i) {
+        layout.encodings[i].hasNoData = true;
+        layout.encodings[i].noData = 65535;
+        layout.fill[i] = 65535;
+      }
+    } else if (sourceType == GDT_UInt16 && hasNoData) {
+      useNoData(PixelType::UInt16, 0, 65535);
+    } else if (sourceType == GDT_Int16 && hasNoData) {
+      useNoData(PixelType::Int16, -32768, 32767);
+    }
+    break;
+
+  case GDALReader::Storage::Float16: {
+    // Values beyond the half float range would become infinite, e.g. the
+    // population or the GDP of a region
+    auto statistics = RasterStatistics::Get(filename);
+    bool isInRange = statistics != nullptr;
+    for (size_t i = 0; isInRange && i < count; ++i) {
+      auto const &band = statistics->bands[layers[i] - 1];
+      isInRange = band.min >= -HALF_FLOAT_MAX && band.max <= HALF_FLOAT_MAX;
+    }
+    if (!isInRange) {
+      csp::vestec::logger().info(
+          "[GDALReader] Values of {} exceed half floats, storing float32",
+          filename);
+      break;
+    }
+
+    // NaN is no valid value, so every finite half float remains usable
+    PixelEncoding encoding;
+    encoding.hasNoData = true;
+    encoding.noData = std::numeric_limits<double>::quiet_NaN();
+    useEncoding(PixelType::Float16, encoding);
+    break;
+  }
+
+  case GDALReader::Storage::Normalized8:
+  case GDALReader::Storage::Normalized16: {
+    // The value range of each band is mapped to the integers below the no
+    // data value
+    auto statistics = RasterStatistics::Get(filename);
+    if (!statistics) {
+      break;
+    }
+
+    bool is8Bit = storage == GDALReader::Storage::Normalized8;
+    double noData = is8Bit ? 255.0 : 65535.0;
+    useEncoding(is8Bit ? PixelType::Byte : PixelType::UInt16, PixelEncoding());
+    for (size_t i = 0; i < count; ++i) {
+      auto const &band = statistics->bands[layers[i] - 1];
+      layout.encodings[i].offset = static_cast<float>(band.min);
+      layout.encodings[i].scale =
+          static_cast<float>((band.max - band.min) / (noData - 1.0));
+      layout.encodings[i].hasNoData = true;
+      layout.encodings[i].noData = noData;
+    }
+    break;
+  }
+  }
+
+  return layout;
+}
+
+/**
+ * Textual representation of a window, precise to a few centimeters
+ */
+std::string GetWindowName(GDALReader::Window const &window) {
+  std::stringstream str;
+  str << std::fixed << std::setprecision(8) << window[0] << "," << window[1]
+      << "," << window[2] << "," << window[3];
+  return str.str();
+}
+
+/**
+ * Textual representation of a pixel rectangle of a warp grid
+ */
+std::string GetPixelsName(std::array<int, 4> const &pixels) {
+  std::stringstream str;
+  str << "px" << pixels[0] << "," << pixels[1] << "," << pixels[2] << ","
+      << pixels[3];
+  return str.str();
+}
+
+} // namespace
+
+// Default budget of the texture cache, can be overwritten in the plugin
+// settings with "vestec-texture-cache-size"
+LRUCache<GDALReader::GreyScaleTexture>
+    GDALReader::TextureCache(1024ul * 1024ul * 1024ul);
+LRUCache<GDALReader::WarpGrid>
+    GDALReader::WarpGridCache(WARP_GRID_CACHE_SIZE);
+std::mutex GDALReader::mTransformerMutex;
+std::list<std::pair<std::string, std::vector<void *>>>
+    GDALReader::mIdleTransformers;
 bool GDALReader::mIsInitialized = false;
+std::atomic<int> GDALReader::mWarpThreads{0};
+std::atomic<GDALReader::Storage> GDALReader::mStorage{
+    GDALReader::Storage::Native};
+std::atomic<bool> GDALReader::mIsCropping{true};
+std::atomic<uint64_t> GDALReader::mCroppedBytes{0};
 
 void GDALReader::InitGDAL() {
   GDALAllRegister();
+
+  // The pixel memory is freed once the last node or renderer drops the texture.
+  // Evicted textures move to the compressed tier
+  TextureCache.SetEvictionCallback(
+      [](const std::string &key, GreyScaleTexture &texture, bool isCleared) {
+        csp::vestec::logger().debug("[GDALReader] Evicting {} from cache.",
+                                    key);
+        if (!isCleared) {
+          CompressedRasterCache::Store(key, texture);
+        }
+      });
+
   GDALReader::mIsInitialized = true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+std::string GDALReader::GetCacheKey(std::string filename, int layer,
+                                    std::optional<Window> const &window) {
+  // A layer path and its dataset path with the same layer share the entry
+  ResolveLayerPath(filename, layer);
+
+  std::stringstream str;
+  str << filename << "#" << layer;
+  if (window) {
+    str << "@" << GetWindowKey(filename, *window);
+  }
+  return str.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string GDALReader::GetWindowKey(const std::string &filename,
+                                     Window const &window) {
+  // Files which cannot be opened are keyed by the window itself, nothing is
+  // loaded for them anyway
+  WarpGrid grid;
+  if (!GetFileGrid(filename, grid)) {
+    return GetWindowName(window);
+  }
+
+  std::array<int, 4> pixels{};
+  if (!GetWindowPixels(grid, window, pixels)) {
+    return "outside";
+  }
+  return GetPixelsName(pixels);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GDALReader::GetFileGrid(const std::string &filename, WarpGrid &grid) {
+  // Files which are not on the file system keep an empty stamp
+  RasterDiskCache::SourceStamp stamp;
+  RasterDiskCache::GetSourceStamp(filename, stamp);
+  std::stringstream key;
+  key << "file:" << filename << "|" << stamp.size << "|"
+      << stamp.modificationTime;
+
+  auto cached = WarpGridCache.Get(key.str());
+  if (cached) {
+    grid = cached.value();
+    return true;
+  }
+
+  DatasetPool::Handle dataset = OpenDataset(filename);
+  if (dataset == nullptr) {
+    return false;
+  }
+
+  ComputeWarpGrid(dataset.get(), grid);
+  WarpGridCache.Insert(key.str(), grid,
+                       sizeof(WarpGrid) + grid.wkt.size() + key.str().size());
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string
+GDALReader::GetDiskCacheVariant(const std::string &filename,
+                                std::optional<Window> const &window) {
+  std::string variant = GetStorageName(GetStorage());
+  if (!IsCropping()) {
+    variant += "-uncropped";
+  }
+  if (window) {
+    variant += "@" + GetWindowKey(filename, *window);
+  }
+  return variant;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string GDALReader::GetLayerPath(const std::string &filename, int layer) {
+  return filename + LAYER_PATH_MARKER + std::to_string(layer);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GDALReader::ResolveLayerPath(std::string &filename, int &layer) {
+  size_t position = filename.rfind(LAYER_PATH_MARKER);
+  if (position == std::string::npos) {
+    return false;
+  }
+
+  std::string number = filename.substr(position + LAYER_PATH_MARKER.size());
+  if (number.empty() || number.size() > 9 ||
+      !std::all_of(number.begin(), number.end(),
+                   [](char c) { return std::isdigit(c) != 0; })) {
+    return false;
+  }
+
+  layer = std::stoi(number);
+  filename.erase(position);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void GDALReader::AddTextureToCache(const std::string &path,
                                    GreyScaleTexture &texture) {
-  GDALReader::mMutex.lock();
-  // Cache the texture
-  TextureCache.insert(std::make_pair(path, texture));
-  GDALReader::mMutex.unlock();
+  // The entry keeps the whole buffer alive, not only the pixels of its view
+  size_t bytes = texture.buffer ? texture.buffer.Buffer()->Bytes() : 0;
+  auto cached = TextureCache.Insert(path, texture, bytes);
+
+  // Another thread was faster, share its texture and drop ours
+  if (cached) {
+    texture = cached.value();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::SetCacheBudget(size_t bytes) {
+  csp::vestec::logger().info("[GDALReader] Texture cache budget set to {} MB",
+                             bytes / (1024 * 1024));
+  TextureCache.SetBudget(bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+LRUCache<GDALReader::GreyScaleTexture>::Statistics
+GDALReader::GetCacheStatistics() {
+  return TextureCache.GetStatistics();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::PinTexture(const std::string &filename, int layer,
+                            std::optional<Window> const &window) {
+  TextureCache.Pin(GetCacheKey(filename, layer, window));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::UnpinTexture(const std::string &filename, int layer,
+                              std::optional<Window> const &window) {
+  TextureCache.Unpin(GetCacheKey(filename, layer, window));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GDALReader::IsTextureCached(const std::string &filename, int layer,
+                                 std::optional<Window> const &window) {
+  return TextureCache.Contains(GetCacheKey(filename, layer, window));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -38,18 +437,19 @@ int GDALReader::ReadNumberOfLayers(std::string filename) {
     return -1;
   }
 
-  GDALReader::mMutex.lock();
-  GDALDataset *poDatasetSrc =
-      static_cast<GDALDataset *>(GDALOpen(filename.data(), GA_ReadOnly));
-  GDALReader::mMutex.unlock();
+  // A layer path addresses a single layer
+  int layer = 1;
+  if (ResolveLayerPath(filename, layer)) {
+    return 1;
+  }
 
+  DatasetPool::Handle poDatasetSrc = DatasetPool::Acquire(filename);
   if (poDatasetSrc == nullptr) {
     csp::vestec::logger().error(
         "[GDALReader::ReadNumberOfLayers] Failed to load {}", filename);
     return -1;
   }
   int bands = poDatasetSrc->GetRasterCount();
-  GDALClose(poDatasetSrc);
 
   csp::vestec::logger().info("Reading number of layers from {} : {}", filename,
                              bands);
@@ -58,170 +458,942 @@ int GDALReader::ReadNumberOfLayers(std::string filename) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void GDALReader::ReadGrayScaleTexture(GreyScaleTexture &texture,
-                                      std::string filename, int layer) {
-  if (!GDALReader::mIsInitialized) {
-    csp::vestec::logger().error(
-        "[GDALReader] GDAL not initialized! Call GDALReader::InitGDAL() first");
-    return;
+bool GDALReader::WriteGeoTiff(GreyScaleTexture const &texture,
+                              const std::string &path) {
+  RasterView pixels = texture.buffer.Decoded();
+  auto *driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+  if (!pixels || driver == nullptr) {
+    return false;
   }
 
-  csp::vestec::logger().info("Reading filename {} and layer {}", filename,
-                             layer);
-  std::stringstream str;
-  str << filename << layer;
+  int width = pixels.Width();
+  int height = pixels.Height();
+  char **options = nullptr;
+  options = CSLSetNameValue(options, "COMPRESS", "DEFLATE");
+  options = CSLSetNameValue(options, "TILED", "YES");
 
-  // Check for texture in cache
-  GDALReader::mMutex.lock();
-  auto it = TextureCache.find(str.str());
-  if (it != TextureCache.end()) {
-    texture = it->second;
+  // Readers must never see a partially written file
+  std::string temporary = path + ".tmp";
+  GDALDataset *dataset = driver->Create(temporary.c_str(), width, height, 1,
+                                        GDT_Float32, options);
+  CSLDestroy(options);
+  if (dataset == nullptr) {
+    csp::vestec::logger().error("[GDALReader] Failed to create {}", path);
+    return false;
+  }
 
-    GDALReader::mMutex.unlock();
-    csp::vestec::logger().debug("Found {} in gdal cache.", str.str());
+  // The texture is a regular lng/lat grid, the geo transform is in degrees
+  auto const &bounds = texture.lnglatBounds;
+  std::array<double, 6> gt = {bounds[0] * 180 / M_PI,
+                              (bounds[2] - bounds[0]) * 180 / M_PI / width,
+                              0.0,
+                              bounds[1] * 180 / M_PI,
+                              0.0,
+                              (bounds[3] - bounds[1]) * 180 / M_PI / height};
+  dataset->SetGeoTransform(gt.data());
 
-    return;
-  }
-  GDALReader::mMutex.unlock();
+  char *wkt = nullptr;
+  OGRSpatialReference srs;
+  srs.SetWellKnownGeogCS("WGS84");
+  srs.exportToWkt(&wkt);
+  dataset->SetProjection(wkt);
+  CPLFree(wkt);
 
-  // Read the source image into a GDAL dataset
-  GDALDataset *poDatasetSrc = nullptr;
-
-  // Meta data storage
-  float noDataValue = -100000;
-  double adfSrcGeoTransform[6];
-  double adfDstGeoTransform[6];
-  std::array<double, 4> bounds{};
-  std::array<double, 2> d_dataRange{};
-
-  int resX = 0;
-  int resY = 0;
-  // Open the file. Needs to be supported by GDAL
-  // TODO: There seems a multithreading issue in netCDF so we need to lock data
-  // reading
-  GDALReader::mMutex.lock();
-  poDatasetSrc =
-      static_cast<GDALDataset *>(GDALOpen(filename.data(), GA_ReadOnly));
-  GDALReader::mMutex.unlock();
+  auto *band = dataset->GetRasterBand(1);
+  band->SetNoDataValue(RASTER_NO_DATA);
+  bool isWritten =
+      band->RasterIO(GF_Write, 0, 0, width, height,
+                     const_cast<void *>(pixels.Data()), width, height,
+                     GDT_Float32, 0, 0) == CE_None;
+  GDALClose(dataset);
 
-  if (poDatasetSrc == nullptr) {
-    csp::vestec::logger().error(
-        "[GDALReader::ReadGrayScaleTexture] Failed to load {}", filename);
-    return;
+  if (!isWritten || VSIRename(temporary.c_str(), path.c_str()) != 0) {
+    csp::vestec::logger().error("[GDALReader] Failed to write {}", path);
+    VSIUnlink(temporary.c_str());
+    return false;
   }
 
-  if (poDatasetSrc->GetRasterCount() < layer) {
-    layer = 1;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+DatasetPool::Handle GDALReader::OpenDataset(const std::string &filename) {
+  // Open the file. Needs to be supported by GDAL. Handles are reused, only
+  // drivers which are not thread safe are opened under a lock
+  DatasetPool::Handle dataset = DatasetPool::Acquire(filename);
+
+  if (dataset == nullptr) {
+    csp::vestec::logger().error("[GDALReader] Failed to load {}", filename);
+    return nullptr;
   }
 
-  if (poDatasetSrc->GetProjectionRef() == nullptr) {
-    csp::vestec::logger().error(
-        "[GDALReader::ReadGrayScaleTexture] No projection defined for {}",
-        filename);
-    return;
+  if (dataset->GetProjectionRef() == nullptr) {
+    csp::vestec::logger().error("[GDALReader] No projection defined for {}",
+                                filename);
+    return nullptr;
   }
 
-  // Read geotransform from src image
-  poDatasetSrc->GetGeoTransform(adfSrcGeoTransform);
+  return dataset;
+}
 
-  int bGotMin = 0;
-  int bGotMax = 0; // like bool if it was successful
-  auto *poBand = poDatasetSrc->GetRasterBand(layer);
-  d_dataRange[0] = poBand->GetMinimum(&bGotMin);
-  d_dataRange[1] = poBand->GetMaximum(&bGotMax);
-  if (!(bGotMin && bGotMax)) {
-    GDALComputeRasterMinMax(static_cast<GDALRasterBandH>(poBand), TRUE,
-                            d_dataRange.data());
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::ComputeWarpGrid(GDALDataset *dataset, WarpGrid &grid) {
+  std::string signature = GetGridSignature(dataset);
+  if (!signature.empty()) {
+    auto cached = WarpGridCache.Get(signature);
+    if (cached) {
+      grid = cached.value();
+      return;
+    }
   }
 
-  /////////////////////// Reprojection /////////////////////
   char *pszDstWKT = nullptr;
 
   // Setup output coordinate system to WGS84 (latitude/longitude).
   OGRSpatialReference oSRS;
   oSRS.SetWellKnownGeogCS("WGS84");
   oSRS.exportToWkt(&pszDstWKT);
+  grid.wkt = pszDstWKT;
+  CPLFree(pszDstWKT);
 
   // Create the transformation object handle
   auto *hTransformArg = GDALCreateGenImgProjTransformer(
-      poDatasetSrc, poDatasetSrc->GetProjectionRef(), nullptr, pszDstWKT, FALSE,
+      dataset, dataset->GetProjectionRef(), nullptr, grid.wkt.c_str(), FALSE,
       0.0, 1);
 
   // Create output coordinate system and store transformation
-  GDALSuggestedWarpOutput(poDatasetSrc, GDALGenImgProjTransform, hTransformArg,
-                          adfDstGeoTransform, &resX, &resY);
+  GDALSuggestedWarpOutput(dataset, GDALGenImgProjTransform, hTransformArg,
+                          grid.geoTransform.data(), &grid.width, &grid.height);
+  GDALDestroyGenImgProjTransformer(hTransformArg);
+
+  UpdateBounds(grid);
+
+  if (!signature.empty()) {
+    // The signature contains the WKT of the source and is stored as key
+    WarpGridCache.Insert(signature, grid,
+                         sizeof(WarpGrid) + grid.wkt.size() + signature.size());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string GDALReader::GetGridSignature(GDALDataset *dataset) {
+  std::array<double, 6> gt{};
+  if (dataset->GetGeoTransform(gt.data()) != CE_None) {
+    return "";
+  }
+
+  // Hexadecimal floats are exact, nearly identical grids are different grids
+  std::stringstream str;
+  str << std::hexfloat;
+  for (double value : gt) {
+    str << value << ";";
+  }
+  str << dataset->GetRasterXSize() << "x" << dataset->GetRasterYSize() << ";"
+      << dataset->GetProjectionRef();
+  return str.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void *GDALReader::AcquireTransformer(GDALDataset *dataset,
+                                     WarpGrid const &grid,
+                                     const std::string &signature) {
+  if (!signature.empty()) {
+    std::lock_guard<std::mutex> lock(mTransformerMutex);
+    for (auto &entry : mIdleTransformers) {
+      if (entry.first != signature || entry.second.empty()) {
+        continue;
+      }
+
+      // Only the target geo transform differs between windows and previews
+      void *transformer = entry.second.back();
+      entry.second.pop_back();
+      GDALSetGenImgProjTransformerDstGeoTransform(transformer,
+                                                  grid.geoTransform.data());
+      return transformer;
+    }
+  }
+
+  std::array<double, 6> gt{};
+  dataset->GetGeoTransform(gt.data());
+  return GDALCreateGenImgProjTransformer3(GDALGetProjectionRef(dataset),
+                                          gt.data(), grid.wkt.c_str(),
+                                          grid.geoTransform.data());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::ReleaseTransformer(const std::string &signature,
+                                    void *transformer) {
+  // Transformers of grids without a signature cannot be matched again
+  if (signature.empty()) {
+    GDALDestroyGenImgProjTransformer(transformer);
+    return;
+  }
+
+  std::vector<void *> destroy;
+  {
+    std::lock_guard<std::mutex> lock(mTransformerMutex);
+    auto it = std::find_if(
+        mIdleTransformers.begin(), mIdleTransformers.end(),
+        [&signature](auto const &entry) { return entry.first == signature; });
+
+    if (it == mIdleTransformers.end()) {
+      mIdleTransformers.emplace_front(signature,
+                                      std::vector<void *>{transformer});
+    } else {
+      it->second.push_back(transformer);
+      mIdleTransformers.splice(mIdleTransformers.begin(), mIdleTransformers,
+                               it);
+    }
+
+    // Keep at most one transformer per warp region of the recent grids
+    auto &idle = mIdleTransformers.front().second;
+    while (idle.size() > static_cast<size_t>(GetWarpThreads())) {
+      destroy.push_back(idle.back());
+      idle.pop_back();
+    }
+    while (mIdleTransformers.size() > MAX_TRANSFORMER_GRIDS) {
+      auto &oldest = mIdleTransformers.back().second;
+      destroy.insert(destroy.end(), oldest.begin(), oldest.end());
+      mIdleTransformers.pop_back();
+    }
+  }
+
+  for (void *unused : destroy) {
+    GDALDestroyGenImgProjTransformer(unused);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GDALReader::GetWindowPixels(WarpGrid const &grid, Window const &window,
+                                 std::array<int, 4> &pixels) {
+  double paddingLng = (window[1] - window[0]) * WINDOW_PADDING;
+  double paddingLat = (window[3] - window[2]) * WINDOW_PADDING;
+  double minLng = (window[0] - paddingLng) * 180 / M_PI;
+  double maxLng = (window[1] + paddingLng) * 180 / M_PI;
+  double minLat = (window[2] - paddingLat) * 180 / M_PI;
+  double maxLat = (window[3] + paddingLat) * 180 / M_PI;
+
+  // The suggested grid is north up, so rows go from north to south
+  auto const &gt = grid.geoTransform;
+  int x0 = static_cast<int>(std::clamp(std::floor((minLng - gt[0]) / gt[1]),
+                                       0.0, 1.0 * grid.width));
+  int x1 = static_cast<int>(std::clamp(std::ceil((maxLng - gt[0]) / gt[1]),
+                                       0.0, 1.0 * grid.width));
+  int y0 = static_cast<int>(std::clamp(std::floor((maxLat - gt[3]) / gt[5]),
+                                       0.0, 1.0 * grid.height));
+  int y1 = static_cast<int>(std::clamp(std::ceil((minLat - gt[3]) / gt[5]),
+                                       0.0, 1.0 * grid.height));
+
+  if (x1 <= x0 || y1 <= y0) {
+    return false;
+  }
+
+  pixels = {x0, y0, x1 - x0, y1 - y0};
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GDALReader::ClipWarpGrid(WarpGrid &grid, Window const &window) {
+  std::array<int, 4> pixels{};
+  if (!GetWindowPixels(grid, window, pixels)) {
+    csp::vestec::logger().warn(
+        "[GDALReader] Window does not intersect the raster, nothing is read");
+    return false;
+  }
+
+  // GDAL only reads the source pixels which are needed for the clipped grid
+  auto &gt = grid.geoTransform;
+  gt[0] += pixels[0] * gt[1];
+  gt[3] += pixels[1] * gt[5];
+  grid.width = pixels[2];
+  grid.height = pixels[3];
+  UpdateBounds(grid);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::CoarsenWarpGrid(WarpGrid &grid, int factor) {
+  auto &gt = grid.geoTransform;
+  gt[1] *= factor;
+  gt[2] *= factor;
+  gt[4] *= factor;
+  gt[5] *= factor;
+  grid.width = (grid.width + factor - 1) / factor;
+  grid.height = (grid.height + factor - 1) / factor;
+  UpdateBounds(grid);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GDALDataset *GDALReader::CreatePreviewDataset(GDALDataset *dataset, int layer,
+                                              int factor) {
+  int sourceWidth = dataset->GetRasterXSize();
+  int sourceHeight = dataset->GetRasterYSize();
+  int width = (sourceWidth + factor - 1) / factor;
+  int height = (sourceHeight + factor - 1) / factor;
+
+  // A decimated read uses the best matching overview of the source, otherwise
+  // GDAL samples the full resolution pixels
+  std::vector<float> pixels(static_cast<size_t>(width) * height);
+  auto *band = dataset->GetRasterBand(layer);
+  if (band->RasterIO(GF_Read, 0, 0, sourceWidth, sourceHeight, pixels.data(),
+                     width, height, GDT_Float32, 0, 0) != CE_None) {
+    return nullptr;
+  }
+
+  int hasNoData = 0;
+  double noData = band->GetNoDataValue(&hasNoData);
+  NormalizeNoData(pixels.data(), pixels.size(), hasNoData, noData);
+
+  auto *driver = GetGDALDriverManager()->GetDriverByName("MEM");
+  GDALDataset *preview =
+      driver->Create("", width, height, 1, GDT_Float32, nullptr);
+  if (preview == nullptr) {
+    return nullptr;
+  }
+
+  // Pixels of the preview cover a larger area than those of the source
+  std::array<double, 6> gt{};
+  dataset->GetGeoTransform(gt.data());
+  double scaleX = static_cast<double>(sourceWidth) / width;
+  double scaleY = static_cast<double>(sourceHeight) / height;
+  gt[1] *= scaleX;
+  gt[2] *= scaleY;
+  gt[4] *= scaleX;
+  gt[5] *= scaleY;
+  preview->SetGeoTransform(gt.data());
+  preview->SetProjection(dataset->GetProjectionRef());
+  preview->GetRasterBand(1)->RasterIO(GF_Write, 0, 0, width, height,
+                                      pixels.data(), width, height,
+                                      GDT_Float32, 0, 0);
+  return preview;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void GDALReader::UpdateBounds(WarpGrid &grid) {
   // Calculate extents of the image
-  bounds[0] = (adfDstGeoTransform[0] + 0 * adfDstGeoTransform[1] +
-               0 * adfDstGeoTransform[2]) *
-              M_PI / 180;
-  bounds[1] = (adfDstGeoTransform[3] + 0 * adfDstGeoTransform[4] +
-               0 * adfDstGeoTransform[5]) *
-              M_PI / 180;
-  bounds[2] = (adfDstGeoTransform[0] + resX * adfDstGeoTransform[1] +
-               resY * adfDstGeoTransform[2]) *
-              M_PI / 180;
-  bounds[3] = (adfDstGeoTransform[3] + resX * adfDstGeoTransform[4] +
-               resY * adfDstGeoTransform[5]) *
-              M_PI / 180;
-
-  // Store the data type of the raster band
-  auto eDT = GDALGetRasterDataType(GDALGetRasterBand(poDatasetSrc, layer));
+  auto const &gt = grid.geoTransform;
+  grid.lnglatBounds[0] = (gt[0] + 0 * gt[1] + 0 * gt[2]) * M_PI / 180;
+  grid.lnglatBounds[1] = (gt[3] + 0 * gt[4] + 0 * gt[5]) * M_PI / 180;
+  grid.lnglatBounds[2] =
+      (gt[0] + grid.width * gt[1] + grid.height * gt[2]) * M_PI / 180;
+  grid.lnglatBounds[3] =
+      (gt[3] + grid.width * gt[4] + grid.height * gt[5]) * M_PI / 180;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::array<double, 2> GDALReader::ReadDataRange(GDALDataset *dataset,
+                                                int layer,
+                                                RasterView const &warped) {
+  // The pixels are in memory already, which is much cheaper than computing
+  // the range of the band if the file does not store it
+  std::array<double, 2> dataRange{};
+  if (TextureStatistics::ComputeRange(warped, dataRange)) {
+    return dataRange;
+  }
+
+  int bGotMin = 0;
+  int bGotMax = 0; // like bool if it was successful
+  auto *poBand = dataset->GetRasterBand(layer);
+  dataRange[0] = poBand->GetMinimum(&bGotMin);
+  dataRange[1] = poBand->GetMaximum(&bGotMax);
+  if (!(bGotMin && bGotMax)) {
+    GDALComputeRasterMinMax(static_cast<GDALRasterBandH>(poBand), TRUE,
+                            dataRange.data());
+  }
+
+  return dataRange;
+}
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::WarpRegion(GDALDataset *dataset, WarpGrid const &grid,
+                            std::vector<int> const &layers, int firstRow,
+                            int rows, void *target, int bufferType,
+                            int kernelThreads) {
   // Setup the warping parameters
   GDALWarpOptions *psWarpOptions = GDALCreateWarpOptions();
-  psWarpOptions->hSrcDS = poDatasetSrc;
+  psWarpOptions->hSrcDS = dataset;
   psWarpOptions->hDstDS = nullptr;
-  psWarpOptions->nBandCount = 1;
+  psWarpOptions->nBandCount = static_cast<int>(layers.size());
   psWarpOptions->panSrcBands =
       static_cast<int *>(CPLMalloc(sizeof(int) * psWarpOptions->nBandCount));
-  psWarpOptions->panSrcBands[0] = layer;
   psWarpOptions->panDstBands =
       static_cast<int *>(CPLMalloc(sizeof(int) * psWarpOptions->nBandCount));
-  psWarpOptions->panDstBands[0] = 1;
-  psWarpOptions->pfnProgress = GDALTermProgress;
+  for (int i = 0; i < psWarpOptions->nBandCount; ++i) {
+    psWarpOptions->panSrcBands[i] = layers[i];
+    psWarpOptions->panDstBands[i] = i + 1;
+  }
 
-  psWarpOptions->pTransformerArg = GDALCreateGenImgProjTransformer3(
-      GDALGetProjectionRef(poDatasetSrc), adfSrcGeoTransform, pszDstWKT,
-      adfDstGeoTransform);
-  psWarpOptions->pfnTransformer = GDALGenImgProjTransform;
+  // Progress output of concurrent regions would be interleaved
+  bool isWholeImage = firstRow == 0 && rows == grid.height;
+  psWarpOptions->pfnProgress =
+      isWholeImage ? GDALTermProgress : GDALDummyProgress;
 
-  // Allocate memory for the image pixels
-  int bufferSize = sizeof(int) * psWarpOptions->nBandCount * resX * resY *
-                   sizeof(GDT_Float32);
-  std::vector<float> bufferData(bufferSize, noDataValue);
+  // Let GDAL parallelize the warp kernel if the region is not split by us
+  psWarpOptions->papszWarpOptions =
+      CSLSetNameValue(psWarpOptions->papszWarpOptions, "NUM_THREADS",
+                      std::to_string(kernelThreads).c_str());
 
-  // execute warping from src to dst
+  // Transformers are not thread safe, each region gets its own. They are
+  // reused by later regions, layers and files of the same source grid
+  std::string signature = GetGridSignature(dataset);
+  psWarpOptions->pTransformerArg =
+      AcquireTransformer(dataset, grid, signature);
+  psWarpOptions->pfnTransformer = GDALGenImgProjTransform;
+
+  // execute warping from src to dst, GDAL converts the source data type to
+  // the buffer type
   GDALWarpOperation oOperation;
   oOperation.Initialize(psWarpOptions);
-  oOperation.WarpRegionToBuffer(0, 0, resX, resY, &bufferData[0], eDT);
-  GDALDestroyGenImgProjTransformer(psWarpOptions->pTransformerArg);
+  oOperation.WarpRegionToBuffer(0, firstRow, grid.width, rows, target,
+                                static_cast<GDALDataType>(bufferType));
+  ReleaseTransformer(signature, psWarpOptions->pTransformerArg);
   GDALDestroyWarpOptions(psWarpOptions);
-  GDALClose(poDatasetSrc);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<RasterView>
+GDALReader::WarpLayers(const std::string &filename, GDALDataset *dataset,
+                       WarpGrid const &grid, std::vector<int> const &layers) {
+  StorageLayout layout = ChooseLayout(mStorage, dataset, filename, layers);
+  int bandCount = static_cast<int>(layers.size());
+  size_t bandSize = static_cast<size_t>(grid.width) * grid.height;
+  size_t pixelSize = GetPixelSize(layout.type);
+
+  // Encoded layers are warped to float first
+  PixelType warpType = layout.isEncoded ? PixelType::Float32 : layout.type;
+  size_t warpPixelSize = GetPixelSize(warpType);
+
+  // The warped bands are stored one after another in a single buffer. Pixels
+  // which are not covered by the source keep the no data value
+  auto pixels = RasterBuffer::Allocate(bandCount * bandSize, layout.type, 0.0);
+  auto *data = static_cast<unsigned char *>(pixels->Data());
+
+  // Split the image into horizontal regions which are warped in parallel.
+  // GDAL datasets must not be shared between threads, so every region reads
+  // from its own handle. Files of drivers which are not thread safe are warped
+  // as a single region
+  int threads = GetWarpThreads();
+  int regions = std::clamp(GetReadThreads(dataset), 1,
+                           std::max(grid.height, 1));
+  std::atomic<int> failedRegions{0};
 
-  /////////////////////// Reprojection End /////////////////
-  texture.buffersize = bufferSize;
-  texture.buffer = static_cast<float *>(CPLMalloc(bufferSize));
-  texture.x = resX;
-  texture.y = resY;
-  texture.dataRange = d_dataRange;
-  texture.lnglatBounds = bounds;
-  std::memcpy(texture.buffer, &bufferData[0], bufferSize);
+#pragma omp parallel for num_threads(regions) schedule(static, 1)
+  for (int region = 0; region < regions; ++region) {
+    int64_t height = grid.height;
+    int firstRow = static_cast<int>(height * region / regions);
+    int rows = static_cast<int>(height * (region + 1) / regions) - firstRow;
+    int kernelThreads = regions == 1 ? threads : 1;
 
-  GDALReader::AddTextureToCache(str.str(), texture);
+    DatasetPool::Handle regionHandle =
+        region == 0 ? nullptr : OpenDataset(filename);
+    GDALDataset *regionDataset = region == 0 ? dataset : regionHandle.get();
+    if (regionDataset == nullptr) {
+      ++failedRegions;
+      continue;
+    }
+
+    size_t regionSize = static_cast<size_t>(grid.width) * rows;
+    size_t regionOffset = static_cast<size_t>(grid.width) * firstRow;
+    if (bandCount == 1 && !layout.isEncoded) {
+      // A single band can be written to its final location directly
+      void *target = data + regionOffset * pixelSize;
+      FillPixels(target, regionSize, layout.type, layout.fill[0]);
+      WarpRegion(regionDataset, grid, layers, firstRow, rows, target,
+                 ToGDALType(layout.type), kernelThreads);
+      if (layout.type == PixelType::Float32) {
+        NormalizeNoData(static_cast<float *>(target), regionSize,
+                        layout.hasSourceNoData[0], layout.sourceNoData[0]);
+      }
+    } else {
+      // GDAL writes the bands of a region one after another, they are copied
+      // (or encoded) to the rows of the region within each band afterwards
+      std::vector<unsigned char> regionData(bandCount * regionSize *
+                                            warpPixelSize);
+      for (int band = 0; band < bandCount; ++band) {
+        FillPixels(regionData.data() + band * regionSize * warpPixelSize,
+                   regionSize, warpType, layout.fill[band]);
+      }
+
+      WarpRegion(regionDataset, grid, layers, firstRow, rows,
+                 regionData.data(), ToGDALType(warpType), kernelThreads);
+
+      for (int band = 0; band < bandCount; ++band) {
+        unsigned char *source =
+            regionData.data() + band * regionSize * warpPixelSize;
+        unsigned char *target = data + (band * bandSize + regionOffset) *
+                                           pixelSize;
+
+        // No data pixels of the source must not be scaled like values.
+        // Integer types keep the no data value of the source instead
+        if (warpType == PixelType::Float32) {
+          NormalizeNoData(reinterpret_cast<float *>(source), regionSize,
+                          layout.hasSourceNoData[band],
+                          layout.sourceNoData[band]);
+        }
+
+        if (!layout.isEncoded) {
+          std::memcpy(target, source, regionSize * pixelSize);
+          continue;
+        }
+
+        auto *values = reinterpret_cast<float *>(source);
+        EncodePixels(values, regionSize, layout.type, layout.encodings[band],
+                     target);
+      }
+    }
+  }
+
+  // The rows of a failed region hold no values, which must neither be shown
+  // nor cached
+  if (failedRegions > 0) {
+    csp::vestec::logger().error(
+        "[GDALReader] Failed to open {} for {} of {} warp regions", filename,
+        failedRegions.load(), regions);
+    return std::vector<RasterView>(bandCount);
+  }
+
+  csp::vestec::logger().debug(
+      "[GDALReader] Stored {} layers of {} with {} bytes per pixel", bandCount,
+      filename, pixelSize);
+
+  RasterView view(std::move(pixels), grid.width, grid.height, bandCount);
+  std::vector<RasterView> views;
+  for (int band = 0; band < bandCount; ++band) {
+    views.push_back(view.Band(band).WithEncoding(layout.encodings[band]));
+  }
+  return views;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void GDALReader::ClearCache() {
-  std::map<std::string, GreyScaleTexture>::iterator it;
+void GDALReader::SetStorage(Storage storage) {
+  csp::vestec::logger().info("[GDALReader] Storing rasters as {}",
+                             GetStorageName(storage));
+  mStorage = storage;
+  ClearCache();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GDALReader::Storage GDALReader::GetStorage() { return mStorage; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::SetCropping(bool enable) {
+  csp::vestec::logger().info("[GDALReader] Cropping no data borders {}",
+                             enable ? "enabled" : "disabled");
+  mIsCropping = enable;
+  ClearCache();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GDALReader::IsCropping() { return mIsCropping; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t GDALReader::CropToValidData(GreyScaleTexture &texture) {
+  std::array<int, 4> extent{};
+  if (!IsCropping() || !texture.buffer ||
+      !TextureStatistics::ComputeValidExtent(texture.buffer, extent)) {
+    return 0;
+  }
+
+  size_t pixels = static_cast<size_t>(texture.x) * texture.y;
+  size_t validPixels = static_cast<size_t>(extent[2]) * extent[3];
+  if (pixels - validPixels < pixels * MIN_CROP_SAVING) {
+    return 0;
+  }
+
+  // The warped grid is a regular lng/lat grid, so the bounds are
+  // interpolated linearly
+  auto const &bounds = texture.lnglatBounds;
+  double lngPerPixel = (bounds[2] - bounds[0]) / texture.x;
+  double latPerPixel = (bounds[3] - bounds[1]) / texture.y;
+  texture.lnglatBounds = {bounds[0] + extent[0] * lngPerPixel,
+                          bounds[1] + extent[1] * latPerPixel,
+                          bounds[0] + (extent[0] + extent[2]) * lngPerPixel,
+                          bounds[1] + (extent[1] + extent[3]) * latPerPixel};
+
+  // A copy, so that the buffer with the borders is released
+  texture.buffer =
+      texture.buffer.SubRect(extent[0], extent[1], extent[2], extent[3])
+          .Copy();
+  texture.x = extent[2];
+  texture.y = extent[3];
+
+  size_t savedBytes = (pixels - validPixels) * texture.buffer.BytesPerPixel();
+  mCroppedBytes += savedBytes;
+  return savedBytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string GDALReader::GetStorageName(Storage storage) {
+  switch (storage) {
+  case Storage::Float32:
+    return "float32";
+  case Storage::Native:
+    return "native";
+  case Storage::Float16:
+    return "float16";
+  case Storage::Normalized8:
+    return "normalized8";
+  case Storage::Normalized16:
+    return "normalized16";
+  }
+  return "";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GDALReader::ParseStorage(const std::string &name, Storage &storage) {
+  for (auto candidate :
+       {Storage::Float32, Storage::Native, Storage::Float16,
+        Storage::Normalized8, Storage::Normalized16}) {
+    if (name == GetStorageName(candidate)) {
+      storage = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int GDALReader::GetReadThreads(GDALDataset *dataset) {
+  // The netCDF driver is not thread safe, not even with separate handles
+  if (!DatasetPool::IsThreadSafe(dataset)) {
+    return 1;
+  }
+
+  return GetWarpThreads();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::SetWarpThreads(int threads) {
+  csp::vestec::logger().info("[GDALReader] Warping with {} threads",
+                             threads > 0 ? std::to_string(threads) : "all");
+  mWarpThreads = std::max(threads, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int GDALReader::GetWarpThreads() {
+  int threads = mWarpThreads;
+  if (threads > 0) {
+    return threads;
+  }
+
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::LogCacheStatistics() {
+  auto statistics = TextureCache.GetStatistics();
+  csp::vestec::logger().debug(
+      "[GDALReader] Cache: {} textures, {} / {} MB, {} hits, {} misses, {} "
+      "evictions",
+      statistics.entries, statistics.bytes / (1024 * 1024),
+      statistics.budget / (1024 * 1024), statistics.hits, statistics.misses,
+      statistics.evictions);
+
+  auto compressed = CompressedRasterCache::GetStatistics();
+  csp::vestec::logger().debug(
+      "[GDALReader] Compressed cache: {} textures, {} / {} MB, {} hits, {} "
+      "misses",
+      compressed.entries, compressed.bytes / (1024 * 1024),
+      compressed.budget / (1024 * 1024), compressed.hits, compressed.misses);
+  csp::vestec::logger().debug("[GDALReader] Cropped {} MB of no data borders",
+                              mCroppedBytes / (1024 * 1024));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::ReadGrayScaleTexture(GreyScaleTexture &texture,
+                                      std::string filename, int layer,
+                                      std::optional<Window> const &window) {
+  if (!GDALReader::mIsInitialized) {
+    csp::vestec::logger().error(
+        "[GDALReader] GDAL not initialized! Call GDALReader::InitGDAL() first");
+    return;
+  }
 
-  GDALReader::mMutex.lock();
-  // Loop over textures and delete buffer
-  for (it = TextureCache.begin(); it != TextureCache.end(); it++) {
-    auto texture = it->second;
-    delete texture.buffer;
+  ResolveLayerPath(filename, layer);
+  csp::vestec::logger().info("Reading filename {} and layer {}", filename,
+                             layer);
+  std::string cacheKey = GetCacheKey(filename, layer, window);
+
+  // Check for texture in cache
+  auto cached = TextureCache.Get(cacheKey);
+  if (cached) {
+    texture = cached.value();
+    csp::vestec::logger().debug("Found {} in gdal cache.", cacheKey);
+
+    return;
+  }
+
+  // Decompressing is much cheaper than reading the file again
+  if (CompressedRasterCache::Restore(cacheKey, texture)) {
+    csp::vestec::logger().debug("Found {} in compressed cache.", cacheKey);
+    GDALReader::AddTextureToCache(cacheKey, texture);
+    return;
+  }
+
+  // Check the persistent cache before warping the source again
+  if (RasterDiskCache::Load(filename, layer, texture,
+                            GetDiskCacheVariant(filename, window))) {
+    GDALReader::AddTextureToCache(cacheKey, texture);
+    return;
+  }
+  const int requestedLayer = layer;
+
+  // Read the source image into a GDAL dataset
+  DatasetPool::Handle poDatasetSrc = OpenDataset(filename);
+  if (poDatasetSrc == nullptr) {
+    return;
+  }
+
+  if (poDatasetSrc->GetRasterCount() < layer) {
+    layer = 1;
+  }
+
+  WarpGrid grid;
+  ComputeWarpGrid(poDatasetSrc.get(), grid);
+  if (window && !ClipWarpGrid(grid, *window)) {
+    texture = GreyScaleTexture();
+    return;
+  }
+
+  texture.buffer = WarpLayers(filename, poDatasetSrc.get(), grid, {layer})[0];
+  if (!texture.buffer) {
+    texture = GreyScaleTexture();
+    return;
+  }
+  texture.x = grid.width;
+  texture.y = grid.height;
+  texture.dataRange =
+      ReadDataRange(poDatasetSrc.get(), layer, texture.buffer);
+  texture.lnglatBounds = grid.lnglatBounds;
+  size_t savedBytes = CropToValidData(texture);
+  if (savedBytes > 0) {
+    csp::vestec::logger().debug(
+        "[GDALReader] Cropped no data borders of {}, saved {} KB", filename,
+        savedBytes / 1024);
+  }
+
+  GDALReader::AddTextureToCache(cacheKey, texture);
+  RasterDiskCache::Store(filename, requestedLayer, texture,
+                         GetDiskCacheVariant(filename, window));
+  LogCacheStatistics();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GDALReader::ReadPreviewTexture(GreyScaleTexture &texture,
+                                    std::string filename, int layer,
+                                    std::optional<Window> const &window) {
+  if (!GDALReader::mIsInitialized) {
+    csp::vestec::logger().error(
+        "[GDALReader] GDAL not initialized! Call GDALReader::InitGDAL() first");
+    return false;
+  }
+
+  ResolveLayerPath(filename, layer);
+
+  // Cached textures are available right away. A layer found in the persistent
+  // cache is moved to the memory cache for the following full read
+  std::string cacheKey = GetCacheKey(filename, layer, window);
+  if (TextureCache.Contains(cacheKey)) {
+    return false;
+  }
+
+  GreyScaleTexture cached;
+  if (CompressedRasterCache::Restore(cacheKey, cached)) {
+    AddTextureToCache(cacheKey, cached);
+    return false;
+  }
+
+  if (RasterDiskCache::Load(filename, layer, cached,
+                            GetDiskCacheVariant(filename, window))) {
+    AddTextureToCache(cacheKey, cached);
+    return false;
+  }
+
+  DatasetPool::Handle poDatasetSrc = OpenDataset(filename);
+  if (poDatasetSrc == nullptr) {
+    return false;
+  }
+
+  if (poDatasetSrc->GetRasterCount() < layer) {
+    layer = 1;
   }
-  TextureCache.clear();
-  GDALReader::mMutex.unlock();
+
+  WarpGrid grid;
+  ComputeWarpGrid(poDatasetSrc.get(), grid);
+  if (window && !ClipWarpGrid(grid, *window)) {
+    return false;
+  }
+
+  int factor = (std::max(grid.width, grid.height) + PREVIEW_SIZE - 1) /
+               PREVIEW_SIZE;
+  GDALDataset *preview =
+      factor > 1 ? CreatePreviewDataset(poDatasetSrc.get(), layer, factor)
+                 : nullptr;
+  if (preview == nullptr) {
+    return false;
+  }
+
+  CoarsenWarpGrid(grid, factor);
+  auto pixels = RasterBuffer::Allocate(
+      static_cast<size_t>(grid.width) * grid.height, RASTER_NO_DATA);
+  WarpRegion(preview, grid, {1}, 0, grid.height, pixels->Data(), GDT_Float32,
+             GetWarpThreads());
+
+  texture.buffer = RasterView(std::move(pixels), grid.width, grid.height);
+  texture.x = grid.width;
+  texture.y = grid.height;
+  texture.dataRange =
+      ReadDataRange(poDatasetSrc.get(), layer, texture.buffer);
+  texture.lnglatBounds = grid.lnglatBounds;
+  CropToValidData(texture);
+  GDALClose(preview);
+
+  csp::vestec::logger().debug(
+      "[GDALReader] Read a {}x{} preview of layer {} of {}", grid.width,
+      grid.height, layer, filename);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::ReadAllLayers(std::vector<GreyScaleTexture> &textures,
+                               std::string filename,
+                               std::optional<Window> const &window) {
+  textures.clear();
+
+  if (!GDALReader::mIsInitialized) {
+    csp::vestec::logger().error(
+        "[GDALReader] GDAL not initialized! Call GDALReader::InitGDAL() first");
+    return;
+  }
+
+  // A layer path addresses a single layer
+  int layer = 1;
+  if (ResolveLayerPath(filename, layer)) {
+    textures.resize(1);
+    ReadGrayScaleTexture(textures[0], filename, layer, window);
+    return;
+  }
+
+  DatasetPool::Handle poDatasetSrc = OpenDataset(filename);
+  if (poDatasetSrc == nullptr) {
+    return;
+  }
+
+  int bands = poDatasetSrc->GetRasterCount();
+  csp::vestec::logger().info("Reading all {} layers of {}", bands, filename);
+
+  // Collect the layers which are already cached, only the others are warped
+  std::string variant = GetDiskCacheVariant(filename, window);
+  textures.resize(bands);
+  std::vector<int> missing;
+  for (int layer = 1; layer <= bands; ++layer) {
+    std::string cacheKey = GetCacheKey(filename, layer, window);
+    auto cached = TextureCache.Get(cacheKey);
+    if (cached) {
+      textures[layer - 1] = cached.value();
+    } else if (CompressedRasterCache::Restore(cacheKey, textures[layer - 1])) {
+      AddTextureToCache(cacheKey, textures[layer - 1]);
+    } else if (RasterDiskCache::Load(filename, layer, textures[layer - 1],
+                                     variant)) {
+      AddTextureToCache(cacheKey, textures[layer - 1]);
+    } else {
+      missing.push_back(layer);
+    }
+  }
+
+  if (missing.empty()) {
+    return;
+  }
+
+  // Warp all missing bands in a single pass over the source. The layers share
+  // one band major buffer and are handed out as views on their band
+  WarpGrid grid;
+  ComputeWarpGrid(poDatasetSrc.get(), grid);
+  if (window && !ClipWarpGrid(grid, *window)) {
+    textures.clear();
+    return;
+  }
+  std::vector<RasterView> views =
+      WarpLayers(filename, poDatasetSrc.get(), grid, missing);
+  if (!views[0]) {
+    textures.clear();
+    return;
+  }
+
+  size_t savedBytes = 0;
+  for (size_t i = 0; i < missing.size(); ++i) {
+    int layer = missing[i];
+    GreyScaleTexture &texture = textures[layer - 1];
+    texture.buffer = views[i];
+    texture.x = grid.width;
+    texture.y = grid.height;
+    texture.dataRange =
+        ReadDataRange(poDatasetSrc.get(), layer, texture.buffer);
+    texture.lnglatBounds = grid.lnglatBounds;
+    savedBytes += CropToValidData(texture);
+  }
+
+  if (savedBytes > 0) {
+    csp::vestec::logger().debug(
+        "[GDALReader] Cropped no data borders of {}, saved {} KB", filename,
+        savedBytes / 1024);
+  }
+
+  // Each cached layer owns its pixels, so that evicting it releases them. A
+  // layer which was not cropped would keep the buffer of all layers alive
+  for (int layer : missing) {
+    GreyScaleTexture &texture = textures[layer - 1];
+    if (texture.buffer.Buffer() == views[0].Buffer()) {
+      texture.buffer = texture.buffer.Copy();
+    }
+  }
+  views.clear();
+
+  for (int layer : missing) {
+    GreyScaleTexture &texture = textures[layer - 1];
+    AddTextureToCache(GetCacheKey(filename, layer, window), texture);
+    RasterDiskCache::Store(filename, layer, texture, variant);
+  }
+
+  LogCacheStatistics();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GDALReader::ClearCache() {
+  // Buffers still used by a node or renderer stay alive until they are dropped
+  TextureCache.Clear();
+  CompressedRasterCache::Clear();
+  DatasetPool::Clear();
 }
@@ -2,25 +2,51 @@
 #define VESTEC_GDAL_READER
 
 #include <array>
-#include <map>
+#include <atomic>
+#include <list>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "../logger.hpp"
+#include "DatasetPool.hpp"
+#include "LRUCache.hpp"
+#include "RasterBuffer.hpp"
+
+class GDALDataset;
 
 class GDALReader {
 public:
+  /**
+   * How warped pixels are stored in memory and uploaded to the GPU
+   */
+  enum class Storage {
+    Float32,     //! 32 bit float for all sources
+    Native,      //! Integer source types are kept, others are stored as float
+    Float16,     //! 16 bit float, 32 bit if the values exceed its range
+    Normalized8, //! 8 bit, scaled to the value range of each band
+    Normalized16 //! 16 bit, scaled to the value range of each band
+  };
+
+  /**
+   * Geographic window in radians: minimum longitude, maximum longitude,
+   * minimum latitude and maximum latitude (the order of the bounding box of
+   * the IncidentsBoundsTool)
+   */
+  using Window = std::array<double, 4>;
+
   /**
    * Struct to store all required information for a float texture
-   * e.g. sizes, data ranges, the buffer itself, and geo-referenced bounds
+   * e.g. sizes, data ranges, the buffer itself, and geo-referenced bounds.
+   * Copies are cheap, all copies share the same immutable pixel buffer
    */
   struct GreyScaleTexture {
     int x{};
     int y{};
     std::array<double, 4> lnglatBounds{};
     std::array<double, 2> dataRange{};
-    int buffersize{};
-    float *buffer{};
+    RasterView buffer{}; //! Shared pixels, freed when the last copy is gone
     int timeIndex = 0;
   };
 
@@ -31,10 +57,33 @@ public:
 
   /**
    * Reads a GDAL supported gray scale image into the texture passed as
-   * reference
+   * reference. If a window is given, only the part of the image within the
+   * padded window is warped and only the intersecting source region is read
    */
   static void ReadGrayScaleTexture(GreyScaleTexture &texture,
-                                   std::string filename, int layer = 1);
+                                   std::string filename, int layer = 1,
+                                   std::optional<Window> const &window = {});
+
+  /**
+   * Reads a low resolution preview of a layer which can be shown until the
+   * full resolution texture is read. The source is read decimated, GDAL uses
+   * its overviews if there are any. The preview is not cached. Returns false
+   * if no preview is needed because the layer is small or already cached
+   */
+  static bool ReadPreviewTexture(GreyScaleTexture &texture,
+                                 std::string filename, int layer = 1,
+                                 std::optional<Window> const &window = {});
+
+  /**
+   * Reads all layers of a GDAL supported image. The dataset is opened once and
+   * all bands which are not cached yet are warped in a single pass. Each
+   * layer is copied into a buffer of its own and stored in the cache. The
+   * window restricts the warped region like in ReadGrayScaleTexture. No
+   * textures are returned if the layers cannot be read
+   */
+  static void ReadAllLayers(std::vector<GreyScaleTexture> &textures,
+                            std::string filename,
+                            std::optional<Window> const &window = {});
 
   /**
    * Get the number of layers in the texture
@@ -42,20 +91,271 @@ public:
   static int ReadNumberOfLayers(std::string filename);
 
   /**
-   * Adds a texture with unique path to the cache
+   * Writes a texture as single band float GeoTIFF in WGS84, e.g. a derived
+   * raster which should be read like any other file. The file is written
+   * next to the path first and moved there once it is complete. Returns false
+   * if it cannot be written
+   */
+  static bool WriteGeoTiff(GreyScaleTexture const &texture,
+                           const std::string &path);
+
+  /**
+   * Sets the number of threads used to warp a single file. The image is split
+   * into horizontal regions which are warped in parallel. 0 uses all cores
+   */
+  static void SetWarpThreads(int threads);
+
+  /**
+   * Returns the number of threads used to warp a single file
+   */
+  static int GetWarpThreads();
+
+  /**
+   * Sets how warped pixels are stored. The lossless default is Native, the
+   * other compact types trade precision for memory. Clears the cache
+   */
+  static void SetStorage(Storage storage);
+  static Storage GetStorage();
+
+  /**
+   * Sets whether warped textures are cropped to the rectangle of their valid
+   * pixels. The bounds of cropped textures are adjusted accordingly. Enabled
+   * by default, clears the cache
+   */
+  static void SetCropping(bool enable);
+  static bool IsCropping();
+
+  /**
+   * Parses "float32", "native", "float16", "normalized8" or "normalized16".
+   * Returns false for unknown names
+   */
+  static bool ParseStorage(const std::string &name, Storage &storage);
+
+  /**
+   * Name of the storage as accepted by ParseStorage. It is also part of the
+   * persistent cache key
+   */
+  static std::string GetStorageName(Storage storage);
+
+  /**
+   * Returns the number of threads which may read from a dataset concurrently,
+   * each through its own handle. Drivers which are not thread safe return 1
+   */
+  static int GetReadThreads(GDALDataset *dataset);
+
+  /**
+   * Acquires a dataset handle for reading from the DatasetPool. Returns an
+   * empty handle and logs an error if the file cannot be opened or has no
+   * projection. The handle must only be used by the calling thread
+   */
+  static DatasetPool::Handle OpenDataset(const std::string &filename);
+
+  /**
+   * Adds a texture with unique path to the cache. The entry is charged with
+   * the size of the whole buffer of the texture. If the path is already
+   * cached, the passed texture is replaced by the cached one
    */
   static void AddTextureToCache(const std::string &path,
                                 GreyScaleTexture &texture);
 
   /**
-   * Clear cache
+   * Sets the maximum number of bytes held by the texture cache. Least recently
+   * used textures are evicted when the budget is exceeded
+   */
+  static void SetCacheBudget(size_t bytes);
+
+  /**
+   * Returns hit, miss and eviction counters as well as the memory usage of
+   * the texture cache
+   */
+  static LRUCache<GreyScaleTexture>::Statistics GetCacheStatistics();
+
+  /**
+   * Pins the texture layer of a file, pinned textures are never evicted.
+   * Needs to be called before the texture is read by a node which displays it,
+   * with the same window
+   */
+  static void PinTexture(const std::string &filename, int layer = 1,
+                         std::optional<Window> const &window = {});
+
+  /**
+   * Releases a pin set with PinTexture
+   */
+  static void UnpinTexture(const std::string &filename, int layer = 1,
+                           std::optional<Window> const &window = {});
+
+  /**
+   * Returns true if the texture layer is in the memory cache. Does not change
+   * the eviction order
+   */
+  static bool IsTextureCached(const std::string &filename, int layer = 1,
+                              std::optional<Window> const &window = {});
+
+  /**
+   * Unique key of a texture layer (and window) within the cache. Windows are
+   * keyed by the source pixels they select, so windows which only differ
+   * within a pixel share their entries
+   */
+  static std::string GetCacheKey(std::string filename, int layer,
+                                 std::optional<Window> const &window = {});
+
+  /**
+   * Returns a path which addresses a single layer of a dataset, e.g. one time
+   * step of a netCDF variable. Layer paths can be passed around like file
+   * names, all reading functions use the layer of the path instead of the
+   * layer argument
+   */
+  static std::string GetLayerPath(const std::string &filename, int layer);
+
+  /**
+   * Splits a layer path into the dataset path and the layer. Returns false
+   * and leaves both unchanged if the path is not a layer path
+   */
+  static bool ResolveLayerPath(std::string &filename, int &layer);
+
+  /**
+   * Clear all textures from the cache which are not pinned and the compressed
+   * tier, and close all idle dataset handles. Caches derived from the
+   * textures are not cleared
    */
   static void ClearCache();
 
 private:
-  static std::map<std::string, GreyScaleTexture> TextureCache;
-  static std::mutex mMutex;
+  /**
+   * Target grid of the reprojection to WGS84
+   */
+  struct WarpGrid {
+    std::string wkt;                      //! Target coordinate system
+    std::array<double, 6> geoTransform{}; //! Pixel to lng/lat in degrees
+    int width{};
+    int height{};
+    std::array<double, 4> lnglatBounds{}; //! Extents in radians
+  };
+
+  /**
+   * Computes the grid which is suggested by GDAL for the reprojection. Grids
+   * are cached by the signature of the source grid, so layers and files which
+   * share a grid only compute it once
+   */
+  static void ComputeWarpGrid(GDALDataset *dataset, WarpGrid &grid);
+
+  /**
+   * Identifies the grid of a source dataset by its projection, geo transform
+   * and size. Returns an empty string for datasets without a geo transform
+   */
+  static std::string GetGridSignature(GDALDataset *dataset);
+
+  /**
+   * Returns a transformer from the target grid to the source grid. Idle
+   * transformers of the same source grid are reused, the target geo
+   * transform is updated. A transformer must only be used by one thread
+   */
+  static void *AcquireTransformer(GDALDataset *dataset, WarpGrid const &grid,
+                                  const std::string &signature);
+
+  /**
+   * Returns a transformer to the idle transformers of its source grid
+   */
+  static void ReleaseTransformer(const std::string &signature,
+                                 void *transformer);
+
+  /**
+   * Computes the first column, first row, columns and rows of the pixels of
+   * the grid within the padded window. Returns false if the window does not
+   * intersect the grid
+   */
+  static bool GetWindowPixels(WarpGrid const &grid, Window const &window,
+                              std::array<int, 4> &pixels);
+
+  /**
+   * Restricts the grid to the pixels within the padded window. Returns false
+   * and leaves the grid unchanged if the window does not intersect it
+   */
+  static bool ClipWarpGrid(WarpGrid &grid, Window const &window);
+
+  /**
+   * Computes the suggested grid of the whole file. The grids are cached by the
+   * file name and the source stamp of the file. Returns false if the file
+   * cannot be opened
+   */
+  static bool GetFileGrid(const std::string &filename, WarpGrid &grid);
+
+  /**
+   * Identifies a window by the pixels it selects from the grid of the file.
+   * Falls back to the window itself if the file cannot be opened
+   */
+  static std::string GetWindowKey(const std::string &filename,
+                                  Window const &window);
+
+  /**
+   * Reduces the resolution of the grid by the given factor
+   */
+  static void CoarsenWarpGrid(WarpGrid &grid, int factor);
+
+  /**
+   * Creates an in-memory dataset with the given layer of the dataset, reduced
+   * by the given factor in both directions
+   */
+  static GDALDataset *CreatePreviewDataset(GDALDataset *dataset, int layer,
+                                           int factor);
+
+  /**
+   * Computes the geographic extents of the grid from its geo transform
+   */
+  static void UpdateBounds(WarpGrid &grid);
+
+  /**
+   * Returns the minimum and maximum value of the warped pixels of a band.
+   * Falls back to the range of the whole band if no pixel is valid
+   */
+  static std::array<double, 2> ReadDataRange(GDALDataset *dataset, int layer,
+                                             RasterView const &warped);
+
+  /**
+   * Warps the given layers in a single pass into a band major buffer in the
+   * configured storage type and returns a view per layer. The rows are split
+   * into regions which are warped in parallel. If a region cannot be read,
+   * all returned views are empty
+   */
+  static std::vector<RasterView> WarpLayers(const std::string &filename,
+                                            GDALDataset *dataset,
+                                            WarpGrid const &grid,
+                                            std::vector<int> const &layers);
+
+  /**
+   * Warps rows [firstRow, firstRow + rows) of the given layers into target,
+   * which holds the rows of all layers one after another in the given type
+   */
+  static void WarpRegion(GDALDataset *dataset, WarpGrid const &grid,
+                         std::vector<int> const &layers, int firstRow, int rows,
+                         void *target, int bufferType, int kernelThreads);
+
+  /**
+   * Crops a warped texture to the rectangle of its valid pixels if that saves
+   * enough memory. Returns the number of saved bytes
+   */
+  static size_t CropToValidData(GreyScaleTexture &texture);
+
+  static void LogCacheStatistics();
+
+  /**
+   * Distinguishes the persistent cache entries of different storage types and
+   * windows
+   */
+  static std::string
+  GetDiskCacheVariant(const std::string &filename,
+                      std::optional<Window> const &window);
+
+  static LRUCache<GreyScaleTexture> TextureCache;
+  static LRUCache<WarpGrid> WarpGridCache; //! By signature or by file
+  static std::mutex mTransformerMutex;
+  static std::list<std::pair<std::string, std::vector<void *>>>
+      mIdleTransformers; //! By source grid, most recently used first
   static bool mIsInitialized;
+  static std::atomic<int> mWarpThreads; //! 0 uses all cores
+  static std::atomic<Storage> mStorage;
+  static std::atomic<bool> mIsCropping;
+  static std::atomic<uint64_t> mCroppedBytes; //! Saved by cropping so far
 };
 
 #endif // VESTEC_GDAL_READER
@@ -0,0 +1,447 @@
+#include "GridResampler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+// Textures whose pixel edges are closer to the grid lines than this fraction
+// of a pixel lie on the grid
+const double GRID_TOLERANCE = 0.01;
+
+// Chosen grids with more pixels are coarsened, a float texture of this size
+// takes 256 MB
+const double MAX_GRID_PIXELS = 64.0 * 1024.0 * 1024.0;
+
+bool IsNoData(float value) {
+  return std::isnan(value) || value == RASTER_NO_DATA;
+}
+
+/**
+ * Source pixels which contribute to a target column or row
+ */
+struct AxisSample {
+  int nearest = -1;    //! Source pixel which contains the center, -1 outside
+  int first = 0;       //! Lower bilinear neighbour
+  int second = 0;      //! Upper bilinear neighbour
+  double weight = 0.0; //! Weight of the upper bilinear neighbour
+  double begin = 0.0;  //! Covered source range of the average kernel
+  double end = 0.0;
+};
+
+/**
+ * Maps the target pixels of one axis to source pixels. Origin is the position
+ * of the first target pixel edge in source pixels and scale the size of a
+ * target pixel in source pixels. Both may be negative
+ */
+std::vector<AxisSample> ComputeAxis(double origin, double scale,
+                                    int targetSize, int sourceSize) {
+  std::vector<AxisSample> samples(targetSize);
+  for (int i = 0; i < targetSize; ++i) {
+    auto &sample = samples[i];
+    double center = origin + (i + 0.5) * scale;
+    if (center >= 0.0 && center < sourceSize) {
+      sample.nearest = static_cast<int>(center);
+    }
+
+    // Relative to the pixel centers, the neighbours are clamped to the edges
+    double position = center - 0.5;
+    int lower = static_cast<int>(std::floor(position));
+    sample.first = std::clamp(lower, 0, sourceSize - 1);
+    sample.second = std::clamp(lower + 1, 0, sourceSize - 1);
+    sample.weight = position - lower;
+
+    double edge0 = origin + i * scale;
+    double edge1 = origin + (i + 1) * scale;
+    sample.begin = std::clamp(std::min(edge0, edge1), 0.0, 1.0 * sourceSize);
+    sample.end = std::clamp(std::max(edge0, edge1), 0.0, 1.0 * sourceSize);
+  }
+  return samples;
+}
+
+/**
+ * Returns true and the position of the texture in pixels of the grid if its
+ * pixels are pixels of the grid
+ */
+bool GetGridOffset(GDALReader::GreyScaleTexture const &texture,
+                   GridResampler::Grid const &grid,
+                   std::array<int, 2> &offset) {
+  auto const &bounds = grid.lnglatBounds;
+  double lngPerPixel = (bounds[2] - bounds[0]) / grid.width;
+  double latPerPixel = (bounds[3] - bounds[1]) / grid.height;
+
+  double x = (texture.lnglatBounds[0] - bounds[0]) / lngPerPixel;
+  double y = (texture.lnglatBounds[1] - bounds[1]) / latPerPixel;
+  double width =
+      (texture.lnglatBounds[2] - texture.lnglatBounds[0]) / lngPerPixel;
+  double height =
+      (texture.lnglatBounds[3] - texture.lnglatBounds[1]) / latPerPixel;
+
+  if (std::abs(width - texture.x) > GRID_TOLERANCE ||
+      std::abs(height - texture.y) > GRID_TOLERANCE ||
+      std::abs(x - std::round(x)) > GRID_TOLERANCE ||
+      std::abs(y - std::round(y)) > GRID_TOLERANCE) {
+    return false;
+  }
+
+  offset = {static_cast<int>(std::lround(x)),
+            static_cast<int>(std::lround(y))};
+  return true;
+}
+
+/**
+ * Copies a texture which lies on the grid into a buffer of the grid size,
+ * the remaining pixels have no data
+ */
+RasterView Pad(GDALReader::GreyScaleTexture const &texture,
+               GridResampler::Grid const &grid,
+               std::array<int, 2> const &offset) {
+  if (offset[0] == 0 && offset[1] == 0 && texture.x == grid.width &&
+      texture.y == grid.height) {
+    return texture.buffer;
+  }
+
+  auto pixels = RasterBuffer::Allocate(
+      static_cast<size_t>(grid.width) * grid.height, RASTER_NO_DATA);
+  auto *data = static_cast<float *>(pixels->Data());
+
+  // The part of the texture within the grid
+  int firstColumn = std::max(0, -offset[0]);
+  int lastColumn = std::min(texture.x, grid.width - offset[0]);
+  int firstRow = std::max(0, -offset[1]);
+  int lastRow = std::min(texture.y, grid.height - offset[1]);
+
+  if (firstColumn < lastColumn) {
+#pragma omp parallel
+    {
+      std::vector<float> row(texture.x);
+
+#pragma omp for
+      for (int y = firstRow; y < lastRow; ++y) {
+        texture.buffer.DecodeRow(y, row.data());
+        std::copy(row.begin() + firstColumn, row.begin() + lastColumn,
+                  data + static_cast<size_t>(y + offset[1]) * grid.width +
+                      firstColumn + offset[0]);
+      }
+    }
+  }
+
+  return RasterView(std::move(pixels), grid.width, grid.height);
+}
+
+/**
+ * Resamples the decoded source pixels onto the grid with the kernel
+ */
+RasterView Interpolate(GDALReader::GreyScaleTexture const &source,
+                       GridResampler::Grid const &grid,
+                       GridResampler::Kernel kernel) {
+  // Sampling needs random access to the rows, so they are decoded once
+  RasterView view = source.buffer.Decoded();
+  const auto *values = static_cast<const float *>(view.Data());
+  int sourceWidth = view.Width();
+  int sourceHeight = view.Height();
+
+  // The warped grids are regular lng/lat grids, so both axes are independent
+  auto const &from = source.lnglatBounds;
+  auto const &to = grid.lnglatBounds;
+  double lngPerPixel = (from[2] - from[0]) / sourceWidth;
+  double latPerPixel = (from[3] - from[1]) / sourceHeight;
+  auto columns = ComputeAxis(
+      (to[0] - from[0]) / lngPerPixel,
+      (to[2] - to[0]) / grid.width / lngPerPixel, grid.width, sourceWidth);
+  auto rows = ComputeAxis(
+      (to[1] - from[1]) / latPerPixel,
+      (to[3] - to[1]) / grid.height / latPerPixel, grid.height, sourceHeight);
+
+  auto pixels = RasterBuffer::Allocate(
+      static_cast<size_t>(grid.width) * grid.height, RASTER_NO_DATA);
+  auto *data = static_cast<float *>(pixels->Data());
+
+  auto sourceAt = [&](int x, int y) {
+    return values[static_cast<size_t>(y) * sourceWidth + x];
+  };
+
+#pragma omp parallel for schedule(dynamic)
+  for (int y = 0; y < grid.height; ++y) {
+    auto const &row = rows[y];
+    float *target = data + static_cast<size_t>(y) * grid.width;
+
+    for (int x = 0; x < grid.width; ++x) {
+      auto const &column = columns[x];
+
+      if (kernel == GridResampler::Kernel::Average) {
+        double sum = 0.0;
+        double weights = 0.0;
+        int lastRow = static_cast<int>(std::ceil(row.end));
+        int lastColumn = static_cast<int>(std::ceil(column.end));
+        for (int j = static_cast<int>(row.begin); j < lastRow; ++j) {
+          double weightY =
+              std::min(j + 1.0, row.end) - std::max(1.0 * j, row.begin);
+          for (int i = static_cast<int>(column.begin); i < lastColumn; ++i) {
+            float value = sourceAt(i, j);
+            if (IsNoData(value)) {
+              continue;
+            }
+            double weight = weightY * (std::min(i + 1.0, column.end) -
+                                       std::max(1.0 * i, column.begin));
+            sum += weight * value;
+            weights += weight;
+          }
+        }
+        if (weights > 0.0) {
+          target[x] = static_cast<float>(sum / weights);
+        }
+        continue;
+      }
+
+      if (row.nearest < 0 || column.nearest < 0) {
+        continue;
+      }
+
+      float nearest = sourceAt(column.nearest, row.nearest);
+      if (IsNoData(nearest)) {
+        continue;
+      }
+
+      if (kernel == GridResampler::Kernel::Nearest) {
+        target[x] = nearest;
+        continue;
+      }
+
+      // The nearest pixel is one of the neighbours with a weight of at least
+      // a quarter, so the weights never sum up to zero
+      int xs[2] = {column.first, column.second};
+      int ys[2] = {row.first, row.second};
+      double sum = 0.0;
+      double weights = 0.0;
+      for (int j = 0; j < 2; ++j) {
+        for (int i = 0; i < 2; ++i) {
+          float value = sourceAt(xs[i], ys[j]);
+          if (IsNoData(value)) {
+            continue;
+          }
+          double weight = (i == 0 ? 1.0 - column.weight : column.weight) *
+                          (j == 0 ? 1.0 - row.weight : row.weight);
+          sum += weight * value;
+          weights += weight;
+        }
+      }
+      target[x] = static_cast<float>(sum / weights);
+    }
+  }
+
+  return RasterView(std::move(pixels), grid.width, grid.height);
+}
+
+} // namespace
+
+// Default budget of the aligned sets, can be overwritten in the plugin
+// settings with "vestec-aligned-cache-size"
+LRUCache<std::vector<GDALReader::GreyScaleTexture>>
+    GridResampler::AlignedCache(512ul * 1024ul * 1024ul);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GridResampler::Grid
+GridResampler::GetGrid(GDALReader::GreyScaleTexture const &texture) {
+  return {texture.x, texture.y, texture.lnglatBounds};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GridResampler::Grid GridResampler::ChooseGrid(
+    std::vector<GDALReader::GreyScaleTexture> const &textures,
+    Resolution resolution) {
+  if (textures.empty()) {
+    return {};
+  }
+
+  // The texture whose pixels are used, by their angular area
+  auto pixelArea = [](GDALReader::GreyScaleTexture const &texture) {
+    auto const &bounds = texture.lnglatBounds;
+    return std::abs((bounds[2] - bounds[0]) * (bounds[3] - bounds[1]) /
+                    (static_cast<double>(texture.x) * texture.y));
+  };
+  size_t index = 0;
+  for (size_t i = 1; i < textures.size(); ++i) {
+    if ((resolution == Resolution::Finest &&
+         pixelArea(textures[i]) < pixelArea(textures[index])) ||
+        (resolution == Resolution::Coarsest &&
+         pixelArea(textures[i]) > pixelArea(textures[index]))) {
+      index = i;
+    }
+  }
+
+  // The extents of all textures in pixels of the reference, rounded outwards
+  auto const &reference = textures[index].lnglatBounds;
+  double lngPerPixel = (reference[2] - reference[0]) / textures[index].x;
+  double latPerPixel = (reference[3] - reference[1]) / textures[index].y;
+  double minX = 0.0;
+  double minY = 0.0;
+  double maxX = textures[index].x;
+  double maxY = textures[index].y;
+  for (auto const &texture : textures) {
+    auto const &bounds = texture.lnglatBounds;
+    for (int corner : {0, 2}) {
+      double x = (bounds[corner] - reference[0]) / lngPerPixel;
+      double y = (bounds[corner + 1] - reference[1]) / latPerPixel;
+      minX = std::min(minX, std::floor(x + GRID_TOLERANCE));
+      minY = std::min(minY, std::floor(y + GRID_TOLERANCE));
+      maxX = std::max(maxX, std::ceil(x - GRID_TOLERANCE));
+      maxY = std::max(maxY, std::ceil(y - GRID_TOLERANCE));
+    }
+  }
+
+  // The union of far apart extents at the finest resolution may exceed the
+  // memory and the int range. Such grids use multiples of the reference pixels
+  auto pixelCount = [&](double factor) {
+    return (std::ceil(maxX / factor) - std::floor(minX / factor)) *
+           (std::ceil(maxY / factor) - std::floor(minY / factor));
+  };
+  double factor = 1.0;
+  if (pixelCount(factor) > MAX_GRID_PIXELS) {
+    factor = std::ceil(std::sqrt(pixelCount(factor) / MAX_GRID_PIXELS));
+    while (pixelCount(factor) > MAX_GRID_PIXELS) {
+      factor += 1.0;
+    }
+    csp::vestec::logger().warn(
+        "[GridResampler] The union of the extents is too large for the chosen "
+        "resolution, using pixels which are {} times larger",
+        factor);
+    minX = std::floor(minX / factor) * factor;
+    minY = std::floor(minY / factor) * factor;
+    maxX = std::ceil(maxX / factor) * factor;
+    maxY = std::ceil(maxY / factor) * factor;
+  }
+
+  Grid grid;
+  grid.width = static_cast<int>((maxX - minX) / factor);
+  grid.height = static_cast<int>((maxY - minY) / factor);
+  grid.lnglatBounds = {reference[0] + minX * lngPerPixel,
+                       reference[1] + minY * latPerPixel,
+                       reference[0] + maxX * lngPerPixel,
+                       reference[1] + maxY * latPerPixel};
+  return grid;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GridResampler::Resample(GDALReader::GreyScaleTexture const &source,
+                             Grid const &grid, Kernel kernel,
+                             GDALReader::GreyScaleTexture &target) {
+  if (!source.buffer || source.x <= 0 || source.y <= 0 || grid.width <= 0 ||
+      grid.height <= 0) {
+    return false;
+  }
+
+  // Resampling does not change what the values mean, so the range is kept
+  GDALReader::GreyScaleTexture result = source;
+  std::array<int, 2> offset{};
+  if (GetGridOffset(source, grid, offset)) {
+    result.buffer = Pad(source, grid, offset);
+  } else {
+    result.buffer = Interpolate(source, grid, kernel);
+  }
+  result.x = grid.width;
+  result.y = grid.height;
+  result.lnglatBounds = grid.lnglatBounds;
+
+  target = std::move(result);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GridResampler::Align(std::vector<GDALReader::GreyScaleTexture> &textures,
+                          Kernel kernel, Resolution resolution) {
+  for (auto const &texture : textures) {
+    if (!texture.buffer || texture.x <= 0 || texture.y <= 0) {
+      return false;
+    }
+  }
+
+  if (textures.size() < 2) {
+    return true;
+  }
+
+  return Align(textures, ChooseGrid(textures, resolution), kernel);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GridResampler::Align(std::vector<GDALReader::GreyScaleTexture> &textures,
+                          Grid const &grid, Kernel kernel) {
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<GDALReader::GreyScaleTexture> aligned(textures.size());
+  for (size_t i = 0; i < textures.size(); ++i) {
+    if (!Resample(textures[i], grid, kernel, aligned[i])) {
+      return false;
+    }
+  }
+  textures = std::move(aligned);
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  csp::vestec::logger().debug(
+      "[GridResampler] Aligned {} textures to {}x{} pixels in {:.1f} ms",
+      textures.size(), grid.width, grid.height, elapsed.count());
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool GridResampler::Get(std::vector<GDALReader::GreyScaleTexture> &textures,
+                        std::vector<std::string> const &files, Kernel kernel,
+                        Resolution resolution, int layer,
+                        std::optional<GDALReader::Window> const &window) {
+  std::stringstream key;
+  key << static_cast<int>(kernel) << static_cast<int>(resolution);
+  for (auto const &file : files) {
+    key << "|" << GDALReader::GetCacheKey(file, layer, window);
+  }
+
+  if (auto cached = AlignedCache.Get(key.str())) {
+    textures = std::move(cached.value());
+    return true;
+  }
+
+  std::vector<GDALReader::GreyScaleTexture> aligned(files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    GDALReader::ReadGrayScaleTexture(aligned[i], files[i], layer, window);
+    if (!aligned[i].buffer) {
+      csp::vestec::logger().error("[GridResampler] Failed to read {}",
+                                  files[i]);
+      return false;
+    }
+  }
+
+  if (!Align(aligned, kernel, resolution)) {
+    return false;
+  }
+
+  size_t bytes = 0;
+  for (auto const &texture : aligned) {
+    bytes += texture.buffer.Buffer()->Bytes();
+  }
+
+  // Another thread may have aligned the same set in the meantime
+  if (auto existing = AlignedCache.Insert(key.str(), aligned, bytes)) {
+    aligned = std::move(existing.value());
+  }
+  textures = std::move(aligned);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GridResampler::SetCacheBudget(size_t bytes) {
+  AlignedCache.SetBudget(bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GridResampler::ClearCache() { AlignedCache.Clear(); }
@@ -0,0 +1,112 @@
+#ifndef VESTEC_GRID_RESAMPLER
+#define VESTEC_GRID_RESAMPLER
+
+#include "GDALReader.hpp"
+
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Resamples textures onto a common grid, so that rasters of different
+ * resolution, e.g. the temperature, rain, GDP and population layers of Rome,
+ * can be combined and compared pixel by pixel. Every file is warped onto the
+ * grid suggested by GDAL for it, so two files rarely share one.
+ *
+ * The target grid is either given or chosen from the textures: it covers the
+ * union of their extents with the pixels of one of them. Textures which
+ * already lie on the target grid are only padded, the others are resampled
+ * with one of the kernels. Target rows are resampled in parallel. Pixels
+ * which decode to RASTER_NO_DATA or NaN are never interpolated.
+ */
+class GridResampler {
+public:
+  /**
+   * How the value of a target pixel is computed from the source pixels
+   */
+  enum class Kernel {
+    Nearest,  //! Value of the source pixel which contains the center
+    Bilinear, //! Weighted value of the four closest source pixel centers
+    Average   //! Area weighted mean of the covered source pixels
+  };
+
+  /**
+   * Which texture provides the pixel size of a chosen grid
+   */
+  enum class Resolution {
+    First,   //! The first texture
+    Finest,  //! The texture with the smallest pixels
+    Coarsest //! The texture with the largest pixels
+  };
+
+  /**
+   * A regular lng/lat grid with the bounds of a GreyScaleTexture
+   */
+  struct Grid {
+    int width{};
+    int height{};
+    std::array<double, 4> lnglatBounds{};
+  };
+
+  /**
+   * Returns the grid of the texture
+   */
+  static Grid GetGrid(GDALReader::GreyScaleTexture const &texture);
+
+  /**
+   * Chooses a grid which covers all textures. Its pixels are the pixels of
+   * the texture selected by resolution, extended to the union of all extents.
+   * Grids with too many pixels use a multiple of the pixel size instead
+   */
+  static Grid
+  ChooseGrid(std::vector<GDALReader::GreyScaleTexture> const &textures,
+             Resolution resolution = Resolution::Finest);
+
+  /**
+   * Resamples a texture onto a grid. Target pixels outside of the source have
+   * no data. Returns false if the texture or the grid is empty
+   */
+  static bool Resample(GDALReader::GreyScaleTexture const &source,
+                       Grid const &grid, Kernel kernel,
+                       GDALReader::GreyScaleTexture &target);
+
+  /**
+   * Resamples textures onto a grid chosen from them. Returns false and
+   * leaves the textures unchanged if one of them is empty
+   */
+  static bool Align(std::vector<GDALReader::GreyScaleTexture> &textures,
+                    Kernel kernel, Resolution resolution = Resolution::Finest);
+
+  /**
+   * Resamples textures onto the given grid. Returns false and leaves the
+   * textures unchanged if one of them or the grid is empty
+   */
+  static bool Align(std::vector<GDALReader::GreyScaleTexture> &textures,
+                    Grid const &grid, Kernel kernel);
+
+  /**
+   * Reads a layer of each file and aligns them like Align. Aligned sets are
+   * cached, so later requests for the same files get identical layouts
+   * without resampling again. Returns false if one of the files cannot be read
+   */
+  static bool Get(std::vector<GDALReader::GreyScaleTexture> &textures,
+                  std::vector<std::string> const &files, Kernel kernel,
+                  Resolution resolution = Resolution::Finest, int layer = 1,
+                  std::optional<GDALReader::Window> const &window = {});
+
+  /**
+   * Sets the maximum number of bytes held by cached sets
+   */
+  static void SetCacheBudget(size_t bytes);
+
+  /**
+   * Removes all sets from the cache
+   */
+  static void ClearCache();
+
+private:
+  static LRUCache<std::vector<GDALReader::GreyScaleTexture>> AlignedCache;
+};
+
+#endif // VESTEC_GRID_RESAMPLER
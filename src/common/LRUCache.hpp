@@ -0,0 +1,249 @@
+#ifndef VESTEC_LRU_CACHE
+#define VESTEC_LRU_CACHE
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Thread safe key value cache which is bounded by a byte budget. Every entry
+ * is inserted together with its size in bytes. As soon as the summed size of
+ * all entries exceeds the budget, entries are evicted in least recently used
+ * order. Entries can be pinned (e.g. while they are displayed), pinned entries
+ * are never evicted.
+ */
+template <typename Value> class LRUCache {
+public:
+  /**
+   * Counters describing the current state and the history of the cache
+   */
+  struct Statistics {
+    size_t hits{};        //! Number of successful lookups
+    size_t misses{};      //! Number of failed lookups
+    size_t evictions{};   //! Number of entries removed to meet the budget
+    size_t entries{};     //! Number of entries currently stored
+    size_t bytes{};       //! Summed size of all stored entries
+    size_t pinnedBytes{}; //! Summed size of all pinned entries
+    size_t budget{};      //! Maximum size before entries get evicted
+  };
+
+  /**
+   * Called for every entry which is evicted or cleared, isCleared tells both
+   * apart. The callback is executed after the internal lock has been released
+   */
+  using EvictionCallback = std::function<void(const std::string &key,
+                                              Value &value, bool isCleared)>;
+
+  explicit LRUCache(size_t budget) : mBudget(budget) {}
+
+  /**
+   * Sets the byte budget and evicts entries if the new budget is exceeded
+   */
+  void SetBudget(size_t budget) {
+    std::vector<std::pair<std::string, Value>> evicted;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mBudget = budget;
+      EvictToBudget(nullptr, evicted);
+    }
+    NotifyEvicted(evicted);
+  }
+
+  /**
+   * Sets the callback which is called for evicted and cleared entries
+   */
+  void SetEvictionCallback(EvictionCallback callback) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOnEvict = std::move(callback);
+  }
+
+  /**
+   * Returns a copy of the cached value and marks it as most recently used
+   */
+  std::optional<Value> Get(const std::string &key) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(key);
+    if (it == mEntries.end()) {
+      ++mStatistics.misses;
+      return std::nullopt;
+    }
+
+    ++mStatistics.hits;
+    mRecentlyUsed.splice(mRecentlyUsed.begin(), mRecentlyUsed,
+                         it->second.position);
+    return it->second.value;
+  }
+
+  /**
+   * Returns true if the key is cached. Does not count as hit or miss and does
+   * not change the eviction order
+   */
+  bool Contains(const std::string &key) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.find(key) != mEntries.end();
+  }
+
+  /**
+   * Inserts a value if the key is not cached yet. If another thread inserted
+   * the key in the meantime, the existing value is kept, marked as most
+   * recently used and returned. The inserted entry itself is never evicted by
+   * its own insertion, even if it is larger than the budget
+   */
+  std::optional<Value> Insert(const std::string &key, Value value,
+                              size_t bytes) {
+    std::vector<std::pair<std::string, Value>> evicted;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto it = mEntries.find(key);
+      if (it != mEntries.end()) {
+        mRecentlyUsed.splice(mRecentlyUsed.begin(), mRecentlyUsed,
+                             it->second.position);
+        return it->second.value;
+      }
+
+      mRecentlyUsed.push_front(key);
+      mEntries.emplace(key,
+                       Entry{std::move(value), bytes, mRecentlyUsed.begin()});
+      mStatistics.bytes += bytes;
+
+      EvictToBudget(&key, evicted);
+    }
+    NotifyEvicted(evicted);
+    return std::nullopt;
+  }
+
+  /**
+   * Pins a key. Pinning is reference counted and may happen before the key is
+   * inserted
+   */
+  void Pin(const std::string &key) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mPins[key];
+  }
+
+  /**
+   * Releases one pin of a key. Evicts entries if the budget is exceeded after
+   * the last pin was released
+   */
+  void Unpin(const std::string &key) {
+    std::vector<std::pair<std::string, Value>> evicted;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto it = mPins.find(key);
+      if (it == mPins.end()) {
+        return;
+      }
+
+      if (--it->second <= 0) {
+        mPins.erase(it);
+        EvictToBudget(nullptr, evicted);
+      }
+    }
+    NotifyEvicted(evicted);
+  }
+
+  /**
+   * Removes all entries which are not pinned
+   */
+  void Clear() {
+    std::vector<std::pair<std::string, Value>> removed;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (auto it = mEntries.begin(); it != mEntries.end();) {
+        if (IsPinned(it->first)) {
+          ++it;
+          continue;
+        }
+
+        mStatistics.bytes -= it->second.bytes;
+        mRecentlyUsed.erase(it->second.position);
+        removed.emplace_back(it->first, std::move(it->second.value));
+        it = mEntries.erase(it);
+      }
+    }
+    NotifyEvicted(removed, true);
+  }
+
+  /**
+   * Returns a snapshot of the cache counters
+   */
+  Statistics GetStatistics() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Statistics statistics = mStatistics;
+    statistics.entries = mEntries.size();
+    statistics.budget = mBudget;
+    for (auto const &pin : mPins) {
+      auto it = mEntries.find(pin.first);
+      if (it != mEntries.end()) {
+        statistics.pinnedBytes += it->second.bytes;
+      }
+    }
+    return statistics;
+  }
+
+private:
+  struct Entry {
+    Value value;
+    size_t bytes;
+    std::list<std::string>::iterator position;
+  };
+
+  bool IsPinned(const std::string &key) const {
+    return mPins.find(key) != mPins.end();
+  }
+
+  /**
+   * Evicts least recently used entries until the budget is met. Needs to be
+   * called with a locked mutex. The entry with the key keep is skipped
+   */
+  void EvictToBudget(const std::string *keep,
+                     std::vector<std::pair<std::string, Value>> &evicted) {
+    auto it = mRecentlyUsed.end();
+    while (mStatistics.bytes > mBudget && it != mRecentlyUsed.begin()) {
+      --it;
+      if ((keep && *it == *keep) || IsPinned(*it)) {
+        continue;
+      }
+
+      auto entry = mEntries.find(*it);
+      mStatistics.bytes -= entry->second.bytes;
+      ++mStatistics.evictions;
+      evicted.emplace_back(*it, std::move(entry->second.value));
+      mEntries.erase(entry);
+      it = mRecentlyUsed.erase(it);
+    }
+  }
+
+  void NotifyEvicted(std::vector<std::pair<std::string, Value>> &evicted,
+                     bool isCleared = false) {
+    EvictionCallback callback;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      callback = mOnEvict;
+    }
+
+    if (!callback) {
+      return;
+    }
+
+    for (auto &entry : evicted) {
+      callback(entry.first, entry.second, isCleared);
+    }
+  }
+
+  mutable std::mutex mMutex;
+  size_t mBudget;
+  Statistics mStatistics;
+  EvictionCallback mOnEvict;
+  std::list<std::string> mRecentlyUsed; //! Front is the most recently used
+  std::map<std::string, Entry> mEntries;
+  std::map<std::string, int> mPins; //! Pin count per key
+};
+
+#endif // VESTEC_LRU_CACHE
@@ -0,0 +1,169 @@
+#include "NetCDFReader.hpp"
+#include "DatasetPool.hpp"
+#include "GDALReader.hpp"
+
+// GDAL c++ includes
+#include "cpl_string.h"
+#include "gdal_priv.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+int64_t GetModificationTime(const std::string &filename) {
+  boost::system::error_code error;
+  auto time = boost::filesystem::last_write_time(filename, error);
+  return error ? 0 : static_cast<int64_t>(time);
+}
+
+/**
+ * Returns the first dimension of the NETCDF_DIM_EXTRA list, e.g. "{time,z}".
+ * This is the outermost dimension which GDAL maps to bands
+ */
+std::string GetBandDimension(GDALDataset *dataset) {
+  const char *extra = dataset->GetMetadataItem("NETCDF_DIM_EXTRA");
+  if (extra == nullptr) {
+    return "";
+  }
+
+  std::string dimensions(extra);
+  dimensions.erase(std::remove(dimensions.begin(), dimensions.end(), '{'),
+                   dimensions.end());
+  dimensions.erase(std::remove(dimensions.begin(), dimensions.end(), '}'),
+                   dimensions.end());
+  return dimensions.substr(0, dimensions.find(','));
+}
+
+} // namespace
+
+std::map<std::string, NetCDFReader::Entry> NetCDFReader::mEntries;
+std::mutex NetCDFReader::mMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool NetCDFReader::IsNetCDF(const std::string &filename) {
+  GDALDriverH driver = GDALIdentifyDriver(filename.c_str(), nullptr);
+  const char *name = driver ? GDALGetDriverShortName(driver) : nullptr;
+  return name != nullptr && std::strcmp(name, "netCDF") == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<NetCDFReader::Variable>
+NetCDFReader::GetVariables(const std::string &filename) {
+  int64_t modificationTime = GetModificationTime(filename);
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(filename);
+    if (it != mEntries.end() &&
+        it->second.modificationTime == modificationTime) {
+      return it->second.variables;
+    }
+  }
+
+  std::vector<std::string> paths;
+  {
+    DatasetPool::Handle dataset = DatasetPool::Acquire(filename);
+    if (dataset == nullptr) {
+      csp::vestec::logger().error(
+          "[NetCDFReader::GetVariables] Failed to load {}", filename);
+      return {};
+    }
+
+    // Files with more than one variable are split into subdatasets
+    char **subdatasets = dataset->GetMetadata("SUBDATASETS");
+    for (int i = 1; i <= CSLCount(subdatasets); ++i) {
+      std::string key = "SUBDATASET_" + std::to_string(i) + "_NAME";
+      const char *path = CSLFetchNameValue(subdatasets, key.c_str());
+      if (path != nullptr) {
+        paths.emplace_back(path);
+      }
+    }
+
+    if (paths.empty() && dataset->GetRasterCount() > 0) {
+      paths.push_back(filename);
+    }
+  }
+
+  std::vector<Variable> variables;
+  for (auto const &path : paths) {
+    Variable variable;
+    if (ReadVariable(path, variable)) {
+      variables.push_back(std::move(variable));
+    }
+  }
+
+  csp::vestec::logger().debug("[NetCDFReader] Found {} variables in {}",
+                              variables.size(), filename);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mEntries[filename] = {modificationTime, variables};
+  return variables;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string NetCDFReader::GetSlicePath(Variable const &variable,
+                                       int timeIndex) {
+  if (timeIndex < 0 || timeIndex >= variable.timeSteps) {
+    return "";
+  }
+  return GDALReader::GetLayerPath(variable.path, timeIndex + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string NetCDFReader::GetSlicePath(const std::string &filename,
+                                       int timeIndex) {
+  for (auto const &variable : GetVariables(filename)) {
+    std::string path = GetSlicePath(variable, timeIndex);
+    if (!path.empty()) {
+      return path;
+    }
+  }
+  return "";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int NetCDFReader::GetNumberOfTimeSteps(const std::string &filename) {
+  int timeSteps = 0;
+  for (auto const &variable : GetVariables(filename)) {
+    timeSteps = std::max(timeSteps, variable.timeSteps);
+  }
+  return timeSteps;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool NetCDFReader::ReadVariable(const std::string &path, Variable &variable) {
+  DatasetPool::Handle dataset = DatasetPool::Acquire(path);
+  if (dataset == nullptr || dataset->GetRasterCount() == 0) {
+    return false;
+  }
+
+  const char *name = dataset->GetMetadataItem("NETCDF_VARNAME");
+  variable.name = name ? name : path.substr(path.rfind(':') + 1);
+  variable.path = path;
+  variable.timeSteps = dataset->GetRasterCount();
+
+  GDALRasterBand *band = dataset->GetRasterBand(1);
+  band->GetBlockSize(&variable.chunkSize[0], &variable.chunkSize[1]);
+
+  // Bands without a value of the time dimension are numbered
+  std::string dimension = GetBandDimension(dataset.get());
+  std::string key = "NETCDF_DIM_" + dimension;
+  for (int i = 1; i <= variable.timeSteps; ++i) {
+    const char *time = dimension.empty() ? nullptr
+                                         : dataset->GetRasterBand(i)
+                                               ->GetMetadataItem(key.c_str());
+    variable.times.push_back(time ? std::atof(time) : i - 1);
+  }
+
+  return true;
+}
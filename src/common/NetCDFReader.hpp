@@ -0,0 +1,78 @@
+#ifndef VESTEC_NETCDF_READER
+#define VESTEC_NETCDF_READER
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Reads the structure of netCDF files with a time dimension, e.g. the outputs
+ * of the disease simulation. GDAL exposes every variable of such a file as a
+ * subdataset and every time step of a variable as a band. This reader lists
+ * the variables and their time steps, and returns layer paths (see
+ * GDALReader::GetLayerPath) of single time slices. The slices are read by the
+ * GDALReader like any other layer: the dataset stays open in the DatasetPool
+ * between time steps, only the chunks of the requested slice are read and
+ * every slice is cached on its own.
+ */
+class NetCDFReader {
+public:
+  /**
+   * A data variable of a netCDF file
+   */
+  struct Variable {
+    std::string name;
+    std::string path;               //! Subdataset path for the GDALReader
+    int timeSteps{};                //! Number of bands
+    std::vector<double> times;      //! Value of the time dimension per band
+    std::array<int, 2> chunkSize{}; //! Chunk size of a slice in pixels
+  };
+
+  /**
+   * Returns true if GDAL reads the file with its netCDF driver
+   */
+  static bool IsNetCDF(const std::string &filename);
+
+  /**
+   * Lists the data variables of a file. The file is opened once, the result is
+   * kept until the file changes. Returns an empty list if the file cannot be
+   * read
+   */
+  static std::vector<Variable> GetVariables(const std::string &filename);
+
+  /**
+   * Returns the layer path of a time slice (starting at 0) of a variable, or
+   * an empty string if the variable has no such time step
+   */
+  static std::string GetSlicePath(Variable const &variable, int timeIndex);
+
+  /**
+   * Returns the layer path of a time slice (starting at 0) of the first
+   * variable of the file which has the time step, or an empty string
+   */
+  static std::string GetSlicePath(const std::string &filename, int timeIndex);
+
+  /**
+   * Returns the number of time steps of the longest variable of a file
+   */
+  static int GetNumberOfTimeSteps(const std::string &filename);
+
+private:
+  struct Entry {
+    int64_t modificationTime{};
+    std::vector<Variable> variables;
+  };
+
+  /**
+   * Reads a single variable, path is either a subdataset or the file itself
+   */
+  static bool ReadVariable(const std::string &path, Variable &variable);
+
+  static std::map<std::string, Entry> mEntries;
+  static std::mutex mMutex;
+};
+
+#endif // VESTEC_NETCDF_READER
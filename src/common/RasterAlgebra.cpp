@@ -0,0 +1,591 @@
+#include "RasterAlgebra.hpp"
+#include "GridResampler.hpp"
+#include "RasterDiskCache.hpp"
+#include "TextureStatistics.hpp"
+
+// GDAL c++ includes
+#include "cpl_vsi.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+using OpCode = RasterAlgebra::Program::OpCode;
+
+// Pixels per block, the operands of a block stay in the L1 cache
+const int BLOCK_SIZE = 256;
+
+/**
+ * Number of operands an instruction takes from the stack. Every instruction
+ * pushes one result
+ */
+int GetConsumedOperands(OpCode opCode) {
+  switch (opCode) {
+  case OpCode::Load:
+  case OpCode::Constant:
+    return 0;
+  case OpCode::Negate:
+  case OpCode::Abs:
+    return 1;
+  case OpCode::Clamp:
+  case OpCode::Where:
+    return 3;
+  default:
+    return 2;
+  }
+}
+
+/**
+ * Recursive descent parser which emits the instructions in postfix order
+ */
+class Parser {
+public:
+  Parser(const std::string &text, int inputs, RasterAlgebra::Program &program)
+      : mText(text), mInputs(inputs), mProgram(program) {}
+
+  bool Parse(std::string &error) {
+    bool isValid = ParseComparison() && Expect('\0');
+    error = mError;
+    return isValid;
+  }
+
+private:
+  struct Function {
+    const char *name;
+    int arguments;
+    OpCode opCode;
+  };
+
+  // comparison := sum [("<" | "<=" | ">" | ">=" | "==" | "!=") sum]
+  bool ParseComparison() {
+    if (!ParseSum()) {
+      return false;
+    }
+
+    const std::pair<const char *, OpCode> operators[] = {
+        {"<=", OpCode::LessEqual}, {">=", OpCode::GreaterEqual},
+        {"==", OpCode::Equal},     {"!=", OpCode::NotEqual},
+        {"<", OpCode::Less},       {">", OpCode::Greater}};
+    for (auto const &op : operators) {
+      if (Accept(op.first)) {
+        if (!ParseSum()) {
+          return false;
+        }
+        Emit(op.second);
+        return true;
+      }
+    }
+    return true;
+  }
+
+  // sum := product {("+" | "-") product}
+  bool ParseSum() {
+    if (!ParseProduct()) {
+      return false;
+    }
+    while (true) {
+      OpCode opCode;
+      if (Accept("+")) {
+        opCode = OpCode::Add;
+      } else if (Accept("-")) {
+        opCode = OpCode::Subtract;
+      } else {
+        return true;
+      }
+      if (!ParseProduct()) {
+        return false;
+      }
+      Emit(opCode);
+    }
+  }
+
+  // product := unary {("*" | "/") unary}
+  bool ParseProduct() {
+    if (!ParseUnary()) {
+      return false;
+    }
+    while (true) {
+      OpCode opCode;
+      if (Accept("*")) {
+        opCode = OpCode::Multiply;
+      } else if (Accept("/")) {
+        opCode = OpCode::Divide;
+      } else {
+        return true;
+      }
+      if (!ParseUnary()) {
+        return false;
+      }
+      Emit(opCode);
+    }
+  }
+
+  // unary := "-" unary | primary
+  bool ParseUnary() {
+    if (Accept("-")) {
+      if (!ParseUnary()) {
+        return false;
+      }
+      Emit(OpCode::Negate);
+      return true;
+    }
+    return ParsePrimary();
+  }
+
+  // primary := number | variable | function "(" arguments ")"
+  //          | "(" comparison ")"
+  bool ParsePrimary() {
+    SkipSpaces();
+    char c = Peek();
+
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      const char *start = mText.c_str() + mPosition;
+      char *end = nullptr;
+      double value = std::strtod(start, &end);
+      if (end == start) {
+        return Fail("Invalid number");
+      }
+      mPosition += end - start;
+      Emit(OpCode::Constant, 0, static_cast<float>(value));
+      return true;
+    }
+
+    if (Accept("(")) {
+      return ParseComparison() && Expect(')');
+    }
+
+    std::string name;
+    while (std::isalpha(static_cast<unsigned char>(Peek()))) {
+      name += mText[mPosition++];
+    }
+    if (name.empty()) {
+      return Fail(c == '\0' ? "Unexpected end of the expression"
+                            : std::string("Unexpected '") + c + "'");
+    }
+
+    const Function functions[] = {{"min", 2, OpCode::Min},
+                                  {"max", 2, OpCode::Max},
+                                  {"clamp", 3, OpCode::Clamp},
+                                  {"where", 3, OpCode::Where},
+                                  {"abs", 1, OpCode::Abs}};
+    for (auto const &function : functions) {
+      if (name == function.name) {
+        return ParseCall(function);
+      }
+    }
+
+    int input = name[0] - 'a';
+    if (name.size() != 1 || input < 0 || input >= mInputs) {
+      return Fail("Unknown variable or function '" + name + "'");
+    }
+    mProgram.inputs |= 1U << input;
+    Emit(OpCode::Load, input);
+    return true;
+  }
+
+  bool ParseCall(Function const &function) {
+    if (!Expect('(')) {
+      return false;
+    }
+    for (int i = 0; i < function.arguments; ++i) {
+      if ((i > 0 && !Expect(',')) || !ParseComparison()) {
+        return false;
+      }
+    }
+    if (!Expect(')')) {
+      return false;
+    }
+    Emit(function.opCode);
+    return true;
+  }
+
+  void Emit(OpCode opCode, int input = 0, float constant = 0.F) {
+    mProgram.instructions.push_back({opCode, input, constant});
+
+    // Track the number of operands on the stack
+    mDepth += 1 - GetConsumedOperands(opCode);
+    mProgram.stackSize = std::max(mProgram.stackSize, mDepth);
+  }
+
+  void SkipSpaces() {
+    while (std::isspace(static_cast<unsigned char>(Peek()))) {
+      ++mPosition;
+    }
+  }
+
+  char Peek() const {
+    return mPosition < mText.size() ? mText[mPosition] : '\0';
+  }
+
+  bool Accept(const char *token) {
+    SkipSpaces();
+    size_t length = std::char_traits<char>::length(token);
+    if (mText.compare(mPosition, length, token) != 0) {
+      return false;
+    }
+    mPosition += length;
+    return true;
+  }
+
+  bool Expect(char c) {
+    SkipSpaces();
+    if (Peek() != c) {
+      return Fail(c == '\0' ? "Unexpected '" + std::string(1, Peek()) + "'"
+                            : std::string("Expected '") + c + "'");
+    }
+    ++mPosition;
+    return true;
+  }
+
+  bool Fail(const std::string &message) {
+    if (mError.empty()) {
+      mError = message + " at position " + std::to_string(mPosition + 1);
+    }
+    return false;
+  }
+
+  const std::string &mText;
+  int mInputs;
+  RasterAlgebra::Program &mProgram;
+  size_t mPosition = 0;
+  int mDepth = 0;
+  std::string mError;
+};
+
+bool IsNoData(float value) {
+  return std::isnan(value) || value == RASTER_NO_DATA;
+}
+
+template <typename Operation>
+void Unary(float *operand, int count, Operation operation) {
+#pragma omp simd
+  for (int i = 0; i < count; ++i) {
+    operand[i] = operation(operand[i]);
+  }
+}
+
+template <typename Operation>
+void Binary(float *lhs, const float *rhs, int count, Operation operation) {
+#pragma omp simd
+  for (int i = 0; i < count; ++i) {
+    lhs[i] = operation(lhs[i], rhs[i]);
+  }
+}
+
+template <typename Operation>
+void Ternary(float *first, const float *second, const float *third, int count,
+             Operation operation) {
+#pragma omp simd
+  for (int i = 0; i < count; ++i) {
+    first[i] = operation(first[i], second[i], third[i]);
+  }
+}
+
+/**
+ * Runs the program on count pixels of the given input rows. The stack holds
+ * stackSize blocks, the result is the first one
+ */
+void Run(RasterAlgebra::Program const &program,
+         std::vector<const float *> const &rows, int count, float *stack) {
+  int depth = 0;
+
+  for (auto const &instruction : program.instructions) {
+    // The operands of the instruction, the result replaces the first one
+    int operands = GetConsumedOperands(instruction.opCode);
+    float *first =
+        stack + static_cast<std::ptrdiff_t>(depth - operands) * BLOCK_SIZE;
+    float *second = first + BLOCK_SIZE;
+    float *third = second + BLOCK_SIZE;
+    depth += 1 - operands;
+
+    switch (instruction.opCode) {
+    case OpCode::Load:
+      std::copy_n(rows[instruction.input], count, first);
+      break;
+    case OpCode::Constant:
+      std::fill_n(first, count, instruction.constant);
+      break;
+    case OpCode::Negate:
+      Unary(first, count, [](float x) { return -x; });
+      break;
+    case OpCode::Abs:
+      Unary(first, count, [](float x) { return std::abs(x); });
+      break;
+    case OpCode::Add:
+      Binary(first, second, count, [](float x, float y) { return x + y; });
+      break;
+    case OpCode::Subtract:
+      Binary(first, second, count, [](float x, float y) { return x - y; });
+      break;
+    case OpCode::Multiply:
+      Binary(first, second, count, [](float x, float y) { return x * y; });
+      break;
+    case OpCode::Divide:
+      Binary(first, second, count, [](float x, float y) { return x / y; });
+      break;
+    case OpCode::Less:
+      Binary(first, second, count,
+             [](float x, float y) { return x < y ? 1.F : 0.F; });
+      break;
+    case OpCode::LessEqual:
+      Binary(first, second, count,
+             [](float x, float y) { return x <= y ? 1.F : 0.F; });
+      break;
+    case OpCode::Greater:
+      Binary(first, second, count,
+             [](float x, float y) { return x > y ? 1.F : 0.F; });
+      break;
+    case OpCode::GreaterEqual:
+      Binary(first, second, count,
+             [](float x, float y) { return x >= y ? 1.F : 0.F; });
+      break;
+    case OpCode::Equal:
+      Binary(first, second, count,
+             [](float x, float y) { return x == y ? 1.F : 0.F; });
+      break;
+    case OpCode::NotEqual:
+      Binary(first, second, count,
+             [](float x, float y) { return x != y ? 1.F : 0.F; });
+      break;
+    case OpCode::Min:
+      Binary(first, second, count,
+             [](float x, float y) { return y < x ? y : x; });
+      break;
+    case OpCode::Max:
+      Binary(first, second, count,
+             [](float x, float y) { return y > x ? y : x; });
+      break;
+    case OpCode::Clamp:
+      Ternary(first, second, third, count,
+              [](float x, float low, float high) {
+                x = x < low ? low : x;
+                return x > high ? high : x;
+              });
+      break;
+    case OpCode::Where:
+      Ternary(first, second, third, count,
+              [](float condition, float x, float y) {
+                return condition != 0.F ? x : y;
+              });
+      break;
+    }
+  }
+}
+
+} // namespace
+
+std::mutex RasterAlgebra::mMemoryResultsMutex;
+std::map<std::string, std::string> RasterAlgebra::mMemoryResults;
+std::atomic<uint64_t> RasterAlgebra::mUnstampedResults{0};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterAlgebra::Compile(const std::string &expression, int inputs,
+                            Program &program, std::string &error) {
+  program = Program();
+  program.expression = expression;
+
+  Parser parser(expression, std::min(inputs, MAX_INPUTS), program);
+  if (!parser.Parse(error)) {
+    program = Program();
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView RasterAlgebra::Evaluate(Program const &program,
+                                   std::vector<RasterView> const &inputs) {
+  if (program.instructions.empty() || inputs.empty()) {
+    return RasterView();
+  }
+
+  // Only the inputs used by the program are read
+  std::vector<int> used;
+  for (int input = 0; input < MAX_INPUTS; ++input) {
+    if ((program.inputs & (1U << input)) == 0) {
+      continue;
+    }
+    if (input >= static_cast<int>(inputs.size()) || !inputs[input]) {
+      return RasterView();
+    }
+    used.push_back(input);
+  }
+
+  // An expression without inputs, e.g. a constant, takes the size of the
+  // first raster
+  RasterView const &reference = used.empty() ? inputs.front() : inputs[used[0]];
+  int width = reference.Width();
+  int height = reference.Height();
+  for (int input : used) {
+    if (inputs[input].Width() != width || inputs[input].Height() != height) {
+      return RasterView();
+    }
+  }
+
+  auto pixels = RasterBuffer::Allocate(static_cast<size_t>(width) * height);
+  auto *data = static_cast<float *>(pixels->Data());
+
+#pragma omp parallel
+  {
+    // Decoded rows of the used inputs and the operand stack of this thread
+    std::vector<std::vector<float>> decoded(MAX_INPUTS);
+    std::vector<const float *> rows(MAX_INPUTS);
+    std::vector<float> stack(static_cast<size_t>(program.stackSize) *
+                             BLOCK_SIZE);
+
+#pragma omp for schedule(dynamic)
+    for (int y = 0; y < height; ++y) {
+      for (int input : used) {
+        decoded[input].resize(width);
+        inputs[input].DecodeRow(y, decoded[input].data());
+      }
+
+      float *target = data + static_cast<size_t>(y) * width;
+      for (int x = 0; x < width; x += BLOCK_SIZE) {
+        int count = std::min(BLOCK_SIZE, width - x);
+        for (int input : used) {
+          rows[input] = decoded[input].data() + x;
+        }
+        Run(program, rows, count, stack.data());
+        std::copy_n(stack.data(), count, target + x);
+      }
+
+      // No data of any used input and invalid results, like divisions by
+      // zero, have no data
+      for (int input : used) {
+        const float *row = decoded[input].data();
+        for (int x = 0; x < width; ++x) {
+          target[x] = IsNoData(row[x]) ? RASTER_NO_DATA : target[x];
+        }
+      }
+      for (int x = 0; x < width; ++x) {
+        target[x] = std::isfinite(target[x]) ? target[x] : RASTER_NO_DATA;
+      }
+    }
+  }
+
+  return RasterView(std::move(pixels), width, height);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string RasterAlgebra::Compute(const std::string &expression,
+                                   std::vector<std::string> const &files,
+                                   std::string &error) {
+  if (files.empty()) {
+    error = "No input rasters";
+    return "";
+  }
+
+  Program program;
+  if (!Compile(expression, static_cast<int>(files.size()), program, error)) {
+    return "";
+  }
+
+  // The result is identified by the expression and the layers of the inputs,
+  // its version by the stamps of the input files
+  std::stringstream identity;
+  identity << expression;
+  std::stringstream version;
+  bool isStamped = true;
+  for (auto const &file : files) {
+    identity << "|" << GDALReader::GetCacheKey(file, 1);
+
+    RasterDiskCache::SourceStamp stamp;
+    isStamped = isStamped && RasterDiskCache::GetSourceStamp(file, stamp);
+    version << "|" << stamp.size << "|" << stamp.modificationTime;
+  }
+
+  std::stringstream suffix;
+  suffix << ".algebra-" << std::hex << std::setw(16) << std::setfill('0')
+         << RasterDiskCache::HashString(identity.str()) << ".tif";
+
+  // Older versions of the result share the name in the cache directory, they
+  // are removed when the cache is trimmed
+  std::string path;
+  if (isStamped) {
+    path = RasterDiskCache::GetDerivedPath(files, suffix.str());
+  }
+
+  // Without a raster cache directory the result is kept in memory. Results
+  // of inputs which cannot be stamped are never reused, each one gets a new
+  // path, so that textures cached for an older result are not shown
+  bool isInMemory = path.empty();
+  if (isInMemory) {
+    std::stringstream name;
+    name << "/vsimem/vestec" << std::hex << std::setfill('0');
+    if (isStamped) {
+      name << std::setw(16) << RasterDiskCache::HashString(version.str());
+    } else {
+      name << "-" << ++mUnstampedResults;
+    }
+    path = name.str() + suffix.str();
+  }
+
+  VSIStatBufL stat{};
+  if (isStamped && VSIStatL(path.c_str(), &stat) == 0) {
+    return path;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  // Inputs of different grids are resampled onto the finest one
+  std::vector<GDALReader::GreyScaleTexture> textures;
+  if (!GridResampler::Get(textures, files, GridResampler::Kernel::Bilinear)) {
+    error = "Cannot read the inputs";
+    return "";
+  }
+
+  std::vector<RasterView> inputs;
+  for (auto const &texture : textures) {
+    inputs.push_back(texture.buffer);
+  }
+
+  GDALReader::GreyScaleTexture result;
+  result.buffer = Evaluate(program, inputs);
+  result.x = result.buffer.Width();
+  result.y = result.buffer.Height();
+  result.lnglatBounds = textures[0].lnglatBounds;
+  TextureStatistics::ComputeRange(result.buffer, result.dataRange);
+
+  if (!GDALReader::WriteGeoTiff(result, path)) {
+    error = "Cannot write the result";
+    return "";
+  }
+
+  if (isInMemory) {
+    // Only the latest result of an expression and its inputs is kept in
+    // memory, the files of the previous ones are released
+    std::string superseded;
+    {
+      std::lock_guard<std::mutex> lock(mMemoryResultsMutex);
+      std::string &latest = mMemoryResults[identity.str()];
+      superseded = latest;
+      latest = path;
+    }
+    if (!superseded.empty() && superseded != path) {
+      VSIUnlink(superseded.c_str());
+    }
+  } else {
+    RasterDiskCache::Trim();
+  }
+
+  // Nodes which show the result do not need to read it again
+  GDALReader::AddTextureToCache(GDALReader::GetCacheKey(path, 1), result);
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  csp::vestec::logger().info(
+      "[RasterAlgebra] Computed '{}' on {}x{} pixels in {:.1f} ms", expression,
+      result.x, result.y, elapsed.count());
+
+  return path;
+}
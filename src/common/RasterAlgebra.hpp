@@ -0,0 +1,114 @@
+#ifndef VESTEC_RASTER_ALGEBRA
+#define VESTEC_RASTER_ALGEBRA
+
+#include "GDALReader.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Derives a raster from other rasters with an expression, e.g. a risk index
+ * "where(b > 50, a * c / 1000, 0)". The variables a, b, c, ... are the input
+ * rasters in the order in which they are passed. Expressions support
+ * + - * / with the usual precedence, unary minus, parentheses, the
+ * comparisons < <= > >= == != (1 if true, 0 otherwise) and the functions
+ * min(x, y), max(x, y), clamp(x, low, high), where(condition, x, y) and
+ * abs(x).
+ *
+ * An expression is compiled once into a program for a stack machine. The
+ * program is run on blocks of pixels, every instruction processes a whole
+ * block in a loop without branches which is vectorized. Rows are spread over
+ * all cores with OpenMP. A pixel has no data if one of the inputs used by the
+ * expression has no data there, or if the result is not finite.
+ */
+class RasterAlgebra {
+public:
+  /**
+   * Maximum number of input rasters, i.e. variables a to d
+   */
+  static const int MAX_INPUTS = 4;
+
+  /**
+   * A compiled expression
+   */
+  struct Program {
+    /**
+     * Unary operations replace the topmost operand with their result, binary
+     * operations the two and Clamp and Where the three topmost operands
+     */
+    enum class OpCode {
+      Load,     //! Pushes the pixels of an input
+      Constant, //! Pushes a constant
+      Negate,
+      Abs,
+      Add,
+      Subtract,
+      Multiply,
+      Divide,
+      Less,
+      LessEqual,
+      Greater,
+      GreaterEqual,
+      Equal,
+      NotEqual,
+      Min,
+      Max,
+      Clamp, //! Operands x, low and high
+      Where  //! Operands condition, x and y
+    };
+
+    struct Instruction {
+      OpCode opCode;
+      int input = 0;        //! Of Load
+      float constant = 0.F; //! Of Constant
+    };
+
+    std::string expression;
+    std::vector<Instruction> instructions;
+    int stackSize = 0;    //! Maximum number of operands at the same time
+    uint32_t inputs = 0U; //! Bit mask of the inputs used by the expression
+  };
+
+  /**
+   * Compiles an expression with the given number of inputs. Returns false
+   * and a description of the problem in error if the expression is invalid
+   */
+  static bool Compile(const std::string &expression, int inputs,
+                      Program &program, std::string &error);
+
+  /**
+   * Evaluates a program on inputs of the same size and returns the float
+   * result. Returns an empty view if the sizes differ or an input used by
+   * the program is missing
+   */
+  static RasterView Evaluate(Program const &program,
+                             std::vector<RasterView> const &inputs);
+
+  /**
+   * Evaluates an expression on the first layer of the given files and
+   * returns the path of a GeoTIFF with the result, which can be passed on
+   * like any other file. Results are kept in the raster cache directory, or
+   * in memory without one, by the expression and the identity of the inputs,
+   * so they are only computed again when an input changes. Results of inputs
+   * whose identity is unknown are computed every time. Inputs of different
+   * grids are resampled bilinearly onto the finest of them. Returns an empty
+   * string and a description of the problem in error if the result cannot be
+   * computed
+   */
+  static std::string Compute(const std::string &expression,
+                             std::vector<std::string> const &files,
+                             std::string &error);
+
+private:
+  static std::mutex mMemoryResultsMutex;
+  static std::map<std::string, std::string>
+      mMemoryResults; //! Latest in-memory result per expression and inputs
+  static std::atomic<uint64_t>
+      mUnstampedResults; //! Number of results of inputs without identity
+};
+
+#endif // VESTEC_RASTER_ALGEBRA
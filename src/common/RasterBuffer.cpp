@@ -0,0 +1,500 @@
+#include "RasterBuffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace {
+
+/**
+ * Rounds and clamps a value to the range of an integer type. The no data
+ * value is excluded if it is at one end of the range
+ */
+template <typename T>
+T ToInteger(double value, PixelEncoding const &encoding) {
+  double lowest = std::numeric_limits<T>::lowest();
+  double highest = std::numeric_limits<T>::max();
+  if (encoding.hasNoData && encoding.noData == highest) {
+    highest -= 1.0;
+  } else if (encoding.hasNoData && encoding.noData == lowest) {
+    lowest += 1.0;
+  }
+  return static_cast<T>(std::clamp(std::round(value), lowest, highest));
+}
+
+template <typename T>
+void Store(unsigned char *target, size_t index, T value) {
+  std::memcpy(target + index * sizeof(T), &value, sizeof(T));
+}
+
+} // namespace
+
+size_t GetPixelSize(PixelType type) {
+  switch (type) {
+  case PixelType::Float32:
+    return sizeof(float);
+  case PixelType::Float16:
+  case PixelType::UInt16:
+  case PixelType::Int16:
+    return sizeof(uint16_t);
+  case PixelType::Byte:
+    return sizeof(uint8_t);
+  }
+  return sizeof(float);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t FloatToHalf(float value) {
+  uint32_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  uint32_t sign = (bits >> 16U) & 0x8000U;
+  uint32_t exponent = (bits >> 23U) & 0xFFU;
+  uint32_t mantissa = bits & 0x7FFFFFU;
+
+  // Infinity and NaN
+  if (exponent == 0xFFU) {
+    return static_cast<uint16_t>(sign | 0x7C00U | (mantissa ? 0x200U : 0U));
+  }
+
+  int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+  // Too large for a half float
+  if (halfExponent >= 31) {
+    return static_cast<uint16_t>(sign | 0x7C00U);
+  }
+
+  // Subnormal half floats or zero, rounded to nearest even
+  if (halfExponent <= 0) {
+    if (halfExponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+
+    mantissa |= 0x800000U;
+    uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1U << shift) - 1U);
+    uint32_t halfway = 1U << (shift - 1U);
+    if (rest > halfway || (rest == halfway && (half & 1U))) {
+      ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+  }
+
+  // Normal half floats, rounded to nearest even. A carry into the exponent is
+  // the correctly rounded result
+  uint32_t half =
+      (static_cast<uint32_t>(halfExponent) << 10U) | (mantissa >> 13U);
+  uint32_t rest = mantissa & 0x1FFFU;
+  if (rest > 0x1000U || (rest == 0x1000U && (half & 1U))) {
+    ++half;
+  }
+  return static_cast<uint16_t>(sign | half);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float HalfToFloat(uint16_t value) {
+  uint32_t sign = (value & 0x8000U) << 16U;
+  uint32_t exponent = (value >> 10U) & 0x1FU;
+  uint32_t mantissa = value & 0x3FFU;
+  uint32_t bits = 0;
+
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      bits = sign;
+    } else {
+      // Normalize the subnormal half float
+      exponent = 113;
+      while (!(mantissa & 0x400U)) {
+        mantissa <<= 1U;
+        --exponent;
+      }
+      mantissa &= 0x3FFU;
+      bits = sign | (exponent << 23U) | (mantissa << 13U);
+    }
+  } else if (exponent == 31) {
+    bits = sign | 0x7F800000U | (mantissa << 13U);
+  } else {
+    bits = sign | ((exponent + 112U) << 23U) | (mantissa << 13U);
+  }
+
+  float result = 0.F;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FillPixels(void *target, size_t count, PixelType type, double value) {
+  // Encode the value once and repeat it
+  size_t pixelSize = GetPixelSize(type);
+  unsigned char pixel[sizeof(float)] = {};
+  switch (type) {
+  case PixelType::Float32:
+    Store(pixel, 0, static_cast<float>(value));
+    break;
+  case PixelType::Float16:
+    Store(pixel, 0, FloatToHalf(static_cast<float>(value)));
+    break;
+  case PixelType::Byte:
+    Store(pixel, 0, static_cast<uint8_t>(value));
+    break;
+  case PixelType::UInt16:
+    Store(pixel, 0, static_cast<uint16_t>(value));
+    break;
+  case PixelType::Int16:
+    Store(pixel, 0, static_cast<int16_t>(value));
+    break;
+  }
+
+  auto *data = static_cast<unsigned char *>(target);
+  for (size_t i = 0; i < count; ++i) {
+    std::memcpy(data + i * pixelSize, pixel, pixelSize);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void EncodePixels(const float *values, size_t count, PixelType type,
+                  PixelEncoding const &encoding, void *target) {
+  auto *data = static_cast<unsigned char *>(target);
+  double scale = encoding.scale != 0.F ? encoding.scale : 1.0;
+
+  for (size_t i = 0; i < count; ++i) {
+    float value = values[i];
+    bool isNoData = std::isnan(value) || value == RASTER_NO_DATA;
+    double stored = isNoData && encoding.hasNoData
+                        ? encoding.noData
+                        : (value - encoding.offset) / scale;
+
+    switch (type) {
+    case PixelType::Float32:
+      Store(data, i, static_cast<float>(stored));
+      break;
+    case PixelType::Float16:
+      Store(data, i, FloatToHalf(static_cast<float>(stored)));
+      break;
+    case PixelType::Byte:
+      Store(data, i,
+            isNoData ? static_cast<uint8_t>(stored)
+                     : ToInteger<uint8_t>(stored, encoding));
+      break;
+    case PixelType::UInt16:
+      Store(data, i,
+            isNoData ? static_cast<uint16_t>(stored)
+                     : ToInteger<uint16_t>(stored, encoding));
+      break;
+    case PixelType::Int16:
+      Store(data, i,
+            isNoData ? static_cast<int16_t>(stored)
+                     : ToInteger<int16_t>(stored, encoding));
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<RasterBuffer> RasterBuffer::Allocate(size_t count,
+                                                     float value) {
+  return Allocate(count, PixelType::Float32, value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<RasterBuffer> RasterBuffer::Allocate(size_t count,
+                                                     PixelType type,
+                                                     double value) {
+  size_t pixelSize = GetPixelSize(type);
+  std::shared_ptr<unsigned char[]> memory(
+      new unsigned char[count * pixelSize]);
+
+  unsigned char *data = memory.get();
+  FillPixels(data, count, type, value);
+
+  return std::shared_ptr<RasterBuffer>(
+      new RasterBuffer(data, count, type, std::move(memory)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const RasterBuffer>
+RasterBuffer::Wrap(const void *data, size_t count, PixelType type,
+                   std::shared_ptr<void> owner) {
+  // The buffer is only handed out as const, the pixels are never written
+  return std::shared_ptr<const RasterBuffer>(new RasterBuffer(
+      const_cast<void *>(data), count, type, std::move(owner)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterBuffer::RasterBuffer(void *data, size_t count, PixelType type,
+                           std::shared_ptr<void> owner)
+    : mData(data), mSize(count), mType(type), mOwner(std::move(owner)) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const void *RasterBuffer::Data() const { return mData; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void *RasterBuffer::Data() { return mData; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PixelType RasterBuffer::Type() const { return mType; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t RasterBuffer::Size() const { return mSize; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t RasterBuffer::Bytes() const { return mSize * GetPixelSize(mType); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView::RasterView(std::shared_ptr<const RasterBuffer> buffer, int width,
+                       int height, int bands, PixelEncoding const &encoding)
+    : mBuffer(std::move(buffer)), mEncoding(encoding), mWidth(width),
+      mHeight(height), mBands(bands), mRowStride(width),
+      mBandStride(static_cast<std::ptrdiff_t>(width) * height) {
+  if (mBuffer) {
+    mData = static_cast<const unsigned char *>(mBuffer->Data());
+    mType = mBuffer->Type();
+    mPixelSize = GetPixelSize(mType);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RasterView::Width() const { return mWidth; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RasterView::Height() const { return mHeight; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RasterView::Bands() const { return mBands; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PixelType RasterView::Type() const { return mType; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t RasterView::BytesPerPixel() const { return mPixelSize; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PixelEncoding const &RasterView::Encoding() const { return mEncoding; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView RasterView::WithEncoding(PixelEncoding const &encoding) const {
+  RasterView view(*this);
+  view.mEncoding = encoding;
+  return view;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ptrdiff_t RasterView::PixelStride() const { return mPixelStride; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ptrdiff_t RasterView::RowStride() const { return mRowStride; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ptrdiff_t RasterView::BandStride() const { return mBandStride; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const void *RasterView::Data() const { return mData; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const unsigned char *RasterView::PixelAddress(int x, int y, int band) const {
+  return mData +
+         (band * mBandStride + y * mRowStride + x * mPixelStride) * mPixelSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float RasterView::Decode(const unsigned char *pixel) const {
+  double stored = 0.0;
+  switch (mType) {
+  case PixelType::Float32: {
+    float value = 0.F;
+    std::memcpy(&value, pixel, sizeof(value));
+    stored = value;
+    break;
+  }
+  case PixelType::Float16: {
+    uint16_t value = 0;
+    std::memcpy(&value, pixel, sizeof(value));
+    stored = HalfToFloat(value);
+    break;
+  }
+  case PixelType::Byte:
+    stored = *pixel;
+    break;
+  case PixelType::UInt16: {
+    uint16_t value = 0;
+    std::memcpy(&value, pixel, sizeof(value));
+    stored = value;
+    break;
+  }
+  case PixelType::Int16: {
+    int16_t value = 0;
+    std::memcpy(&value, pixel, sizeof(value));
+    stored = value;
+    break;
+  }
+  }
+
+  // A no data value of NaN matches any NaN
+  if (mEncoding.hasNoData &&
+      (stored == mEncoding.noData || std::isnan(stored))) {
+    return RASTER_NO_DATA;
+  }
+  return static_cast<float>(stored * mEncoding.scale + mEncoding.offset);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+float RasterView::At(int x, int y, int band) const {
+  return Decode(PixelAddress(x, y, band));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterView::DecodeRow(int y, float *target, int band) const {
+  const unsigned char *row = PixelAddress(0, y, band);
+  if (IsPlainFloat() && mPixelStride == 1) {
+    std::memcpy(target, row, mWidth * sizeof(float));
+    return;
+  }
+
+  std::ptrdiff_t step = mPixelStride * static_cast<std::ptrdiff_t>(mPixelSize);
+  for (int x = 0; x < mWidth; ++x) {
+    target[x] = Decode(row + x * step);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterView::IsContiguous() const {
+  return mBands == 1 && mPixelStride == 1 && mRowStride == mWidth;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterView::IsPlainFloat() const {
+  return mType == PixelType::Float32 && !mEncoding.hasNoData &&
+         mEncoding.scale == 1.F && mEncoding.offset == 0.F;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView RasterView::Band(int band) const {
+  RasterView view(*this);
+  band = std::clamp(band, 0, std::max(mBands - 1, 0));
+  view.mData = PixelAddress(0, 0, band);
+  view.mBands = 1;
+  return view;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView RasterView::SubRect(int x, int y, int width, int height) const {
+  RasterView view(*this);
+  x = std::clamp(x, 0, mWidth);
+  y = std::clamp(y, 0, mHeight);
+  view.mWidth = std::clamp(width, 0, mWidth - x);
+  view.mHeight = std::clamp(height, 0, mHeight - y);
+  view.mData = PixelAddress(x, y, 0);
+  return view;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView RasterView::Strided(int stepX, int stepY) const {
+  RasterView view(*this);
+  stepX = std::max(stepX, 1);
+  stepY = std::max(stepY, 1);
+  view.mWidth = (mWidth + stepX - 1) / stepX;
+  view.mHeight = (mHeight + stepY - 1) / stepY;
+  view.mPixelStride = mPixelStride * stepX;
+  view.mRowStride = mRowStride * stepY;
+  return view;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView RasterView::Compact() const {
+  if (IsContiguous() || !mBuffer) {
+    return *this;
+  }
+
+  return Copy();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView RasterView::Copy() const {
+  if (!mBuffer) {
+    return *this;
+  }
+
+  auto buffer = RasterBuffer::Allocate(static_cast<size_t>(mWidth) * mHeight,
+                                       mType, 0.0);
+  auto *target = static_cast<unsigned char *>(buffer->Data());
+  size_t rowBytes = static_cast<size_t>(mWidth) * mPixelSize;
+  for (int y = 0; y < mHeight; ++y) {
+    if (mPixelStride == 1) {
+      std::memcpy(target, PixelAddress(0, y, 0), rowBytes);
+      target += rowBytes;
+      continue;
+    }
+
+    for (int x = 0; x < mWidth; ++x) {
+      std::memcpy(target, PixelAddress(x, y, 0), mPixelSize);
+      target += mPixelSize;
+    }
+  }
+
+  return RasterView(std::move(buffer), mWidth, mHeight, 1, mEncoding);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView RasterView::Decoded() const {
+  if ((IsContiguous() && IsPlainFloat()) || !mBuffer) {
+    return *this;
+  }
+
+  auto buffer = RasterBuffer::Allocate(static_cast<size_t>(mWidth) * mHeight);
+  auto *target = static_cast<float *>(buffer->Data());
+  for (int y = 0; y < mHeight; ++y) {
+    DecodeRow(y, target + static_cast<size_t>(y) * mWidth);
+  }
+
+  return RasterView(std::move(buffer), mWidth, mHeight);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const RasterBuffer> const &RasterView::Buffer() const {
+  return mBuffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView::operator bool() const { return mData != nullptr; }
@@ -0,0 +1,266 @@
+#ifndef VESTEC_RASTER_BUFFER
+#define VESTEC_RASTER_BUFFER
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Value of pixels without data in decoded (float) rasters. Negative values
+ * are not rendered by the overlay shaders
+ */
+const float RASTER_NO_DATA = -100000.F;
+
+/**
+ * Type in which the pixels of a RasterBuffer are stored
+ */
+enum class PixelType { Float32, Float16, Byte, UInt16, Int16 };
+
+/**
+ * Size of a single pixel of the given type in bytes
+ */
+size_t GetPixelSize(PixelType type);
+
+/**
+ * Conversion between 32 bit and 16 bit (half) floats
+ */
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+/**
+ * Describes how stored pixels are converted to data values:
+ * value = stored * scale + offset. Stored pixels which equal noData, or are
+ * NaN, decode to RASTER_NO_DATA
+ */
+struct PixelEncoding {
+  float scale = 1.F;
+  float offset = 0.F;
+  bool hasNoData = false;
+  double noData = 0.0; //! Stored (not decoded) value of pixels without data
+};
+
+/**
+ * Sets count stored pixels of the given type to value
+ */
+void FillPixels(void *target, size_t count, PixelType type, double value);
+
+/**
+ * Encodes count data values into stored pixels of the given type. Values equal
+ * to RASTER_NO_DATA or NaN are stored as the no data value of the encoding,
+ * integer pixels are rounded and clamped to the range of the type
+ */
+void EncodePixels(const float *values, size_t count, PixelType type,
+                  PixelEncoding const &encoding, void *target);
+
+/**
+ * Block of pixels which is shared between the GDALReader cache, the nodes and
+ * the renderers. A buffer is only written by the code which created it and is
+ * published as std::shared_ptr<const RasterBuffer> afterwards. The memory is
+ * released exactly once, when the last reference is dropped.
+ */
+class RasterBuffer {
+public:
+  /**
+   * Allocates a float buffer with count pixels which are initialized with
+   * value
+   */
+  static std::shared_ptr<RasterBuffer> Allocate(size_t count,
+                                                float value = 0.F);
+
+  /**
+   * Allocates a buffer with count pixels of the given type which are
+   * initialized with the stored value
+   */
+  static std::shared_ptr<RasterBuffer> Allocate(size_t count, PixelType type,
+                                                double value);
+
+  /**
+   * Wraps count pixels of memory which is owned by someone else, e.g. a
+   * memory mapped file. The owner is kept alive as long as the buffer exists
+   */
+  static std::shared_ptr<const RasterBuffer> Wrap(const void *data,
+                                                  size_t count, PixelType type,
+                                                  std::shared_ptr<void> owner);
+
+  RasterBuffer(RasterBuffer const &other) = delete;
+  RasterBuffer &operator=(RasterBuffer const &other) = delete;
+
+  /**
+   * Read access to the pixels
+   */
+  const void *Data() const;
+
+  /**
+   * Write access to the pixels. Only allowed before the buffer is published
+   */
+  void *Data();
+
+  /**
+   * Type of the stored pixels
+   */
+  PixelType Type() const;
+
+  /**
+   * Number of pixels in the buffer
+   */
+  size_t Size() const;
+
+  /**
+   * Size of the pixel memory in bytes
+   */
+  size_t Bytes() const;
+
+private:
+  RasterBuffer(void *data, size_t count, PixelType type,
+               std::shared_ptr<void> owner);
+
+  void *mData = nullptr;                //! The pixel memory
+  size_t mSize = 0;                     //! Number of pixels
+  PixelType mType = PixelType::Float32; //! Type of the stored pixels
+  std::shared_ptr<void> mOwner;         //! Releases the pixel memory
+};
+
+/**
+ * Zero-copy window into a RasterBuffer. A view addresses width x height
+ * pixels of one or more bands through strides, so band, sub-rectangle and
+ * strided (decimated) views share the memory of the underlying buffer. The
+ * view keeps the buffer alive. It also knows the encoding of the pixels, all
+ * accessors returning float return decoded values.
+ */
+class RasterView {
+public:
+  RasterView() = default;
+
+  /**
+   * Creates a view on a buffer which stores the given number of bands as
+   * consecutive, row major width x height images
+   */
+  RasterView(std::shared_ptr<const RasterBuffer> buffer, int width, int height,
+             int bands = 1, PixelEncoding const &encoding = PixelEncoding());
+
+  int Width() const;
+  int Height() const;
+  int Bands() const;
+
+  /**
+   * Type of the stored pixels and their size in bytes
+   */
+  PixelType Type() const;
+  size_t BytesPerPixel() const;
+
+  /**
+   * Conversion of the stored pixels to data values
+   */
+  PixelEncoding const &Encoding() const;
+
+  /**
+   * The same view with a different encoding
+   */
+  RasterView WithEncoding(PixelEncoding const &encoding) const;
+
+  /**
+   * Distance in pixels between two horizontally neighboured pixels
+   */
+  std::ptrdiff_t PixelStride() const;
+
+  /**
+   * Distance in pixels between two vertically neighboured pixels
+   */
+  std::ptrdiff_t RowStride() const;
+
+  /**
+   * Distance in pixels between two bands
+   */
+  std::ptrdiff_t BandStride() const;
+
+  /**
+   * Pointer to the first stored pixel of the first band
+   */
+  const void *Data() const;
+
+  /**
+   * Returns the decoded value at the given position
+   */
+  float At(int x, int y, int band = 0) const;
+
+  /**
+   * Writes the Width() decoded values of a row into target
+   */
+  void DecodeRow(int y, float *target, int band = 0) const;
+
+  /**
+   * Returns true if the view is a single band without gaps between pixels
+   * and rows
+   */
+  bool IsContiguous() const;
+
+  /**
+   * Returns true if the stored pixels are floats which need no decoding
+   */
+  bool IsPlainFloat() const;
+
+  /**
+   * View on a single band
+   */
+  RasterView Band(int band) const;
+
+  /**
+   * View on a rectangular region. The region is clamped to the view
+   */
+  RasterView SubRect(int x, int y, int width, int height) const;
+
+  /**
+   * View on every stepX-th column and every stepY-th row
+   */
+  RasterView Strided(int stepX, int stepY) const;
+
+  /**
+   * Returns the view itself if it is contiguous, otherwise a contiguous copy
+   * of the first band in the same pixel type
+   */
+  RasterView Compact() const;
+
+  /**
+   * Returns a contiguous copy of the first band in a buffer of its own, so
+   * that the memory of a larger buffer can be released
+   */
+  RasterView Copy() const;
+
+  /**
+   * Returns the view itself if it is contiguous and plain float, otherwise a
+   * contiguous float copy with decoded values of the first band
+   */
+  RasterView Decoded() const;
+
+  /**
+   * The buffer which holds the pixels of this view
+   */
+  std::shared_ptr<const RasterBuffer> const &Buffer() const;
+
+  /**
+   * True if the view references a buffer
+   */
+  explicit operator bool() const;
+
+private:
+  /**
+   * Decodes the stored pixel at the given address
+   */
+  float Decode(const unsigned char *pixel) const;
+
+  const unsigned char *PixelAddress(int x, int y, int band) const;
+
+  std::shared_ptr<const RasterBuffer> mBuffer; //! Keeps the pixels alive
+  const unsigned char *mData = nullptr; //! First pixel of the view in mBuffer
+  PixelType mType = PixelType::Float32;
+  size_t mPixelSize = sizeof(float);
+  PixelEncoding mEncoding;
+  int mWidth = 0;
+  int mHeight = 0;
+  int mBands = 0;
+  std::ptrdiff_t mPixelStride = 1;
+  std::ptrdiff_t mRowStride = 0;
+  std::ptrdiff_t mBandStride = 0;
+};
+
+#endif // VESTEC_RASTER_BUFFER
@@ -0,0 +1,551 @@
+#include "RasterDiskCache.hpp"
+#include "ArchiveReader.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'V', 'E', 'S', 'T', 'R', 'A', 'S', 'T'};
+const uint32_t CACHE_VERSION = 3;
+const uint64_t PAYLOAD_ALIGNMENT = 64;
+
+/**
+ * Keeps a cache file mapped while a RasterBuffer references its pixels
+ */
+struct MappedFile {
+  boost::interprocess::file_mapping mFile;
+  boost::interprocess::mapped_region mRegion;
+};
+
+/**
+ * Returns the file of a subdataset path like NETCDF:"file.nc":variable, or
+ * the path itself if it does not name a subdataset
+ */
+std::string GetSubdatasetFile(const std::string &path) {
+  size_t start = path.find(":\"");
+  if (start == std::string::npos) {
+    return path;
+  }
+
+  size_t end = path.find('"', start + 2);
+  return end == std::string::npos ? path
+                                  : path.substr(start + 2, end - start - 2);
+}
+
+/**
+ * True if the name has count hexadecimal digits at the given position
+ */
+bool IsHex(const std::string &name, size_t position, size_t count) {
+  if (name.size() < position + count) {
+    return false;
+  }
+  return std::all_of(name.begin() + position, name.begin() + position + count,
+                     [](unsigned char c) { return std::isxdigit(c) != 0; });
+}
+
+/**
+ * The modification time of cache files is their last use
+ */
+void MarkUsed(const std::string &path) {
+  boost::system::error_code error;
+  boost::filesystem::last_write_time(path, std::time(nullptr), error);
+}
+
+// Temporary files older than this were left by a crashed process
+const std::time_t ABANDONED_AGE = 24 * 60 * 60;
+
+} // namespace
+
+std::string RasterDiskCache::mDirectory;
+uint64_t RasterDiskCache::mBudget = 8ull * 1024ull * 1024ull * 1024ull;
+std::mutex RasterDiskCache::mMutex;
+std::mutex RasterDiskCache::mTrimMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterDiskCache::SetDirectory(const std::string &directory) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mDirectory = directory;
+
+  if (mDirectory.empty()) {
+    csp::vestec::logger().info("[RasterDiskCache] Disabled");
+    return;
+  }
+
+  boost::system::error_code error;
+  boost::filesystem::create_directories(mDirectory, error);
+  if (error) {
+    csp::vestec::logger().warn(
+        "[RasterDiskCache] Cannot create '{}': {}. Cache is disabled",
+        mDirectory, error.message());
+    mDirectory.clear();
+    return;
+  }
+
+  csp::vestec::logger().info("[RasterDiskCache] Caching warped rasters in {}",
+                             mDirectory);
+
+  // Entries of sources which changed since the last run are removed without
+  // delaying the start
+  std::thread(&RasterDiskCache::Trim).detach();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterDiskCache::SetBudget(uint64_t bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBudget = bytes;
+  }
+
+  std::thread(&RasterDiskCache::Trim).detach();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterDiskCache::Trim() {
+  std::unique_lock<std::mutex> trimLock(mTrimMutex, std::try_to_lock);
+  if (!trimLock.owns_lock()) {
+    return;
+  }
+
+  std::string directory;
+  uint64_t budget = 0;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    directory = mDirectory;
+    budget = mBudget;
+  }
+
+  if (directory.empty()) {
+    return;
+  }
+
+  struct Entry {
+    std::string path;
+    uint64_t size;
+    std::time_t lastUsed;
+  };
+
+  std::vector<Entry> entries;
+  std::vector<Entry> stale;
+  std::map<std::string, std::vector<Entry>> derived;
+  std::time_t now = std::time(nullptr);
+
+  boost::system::error_code error;
+  for (boost::filesystem::directory_iterator it(directory, error), end;
+       !error && it != end; it.increment(error)) {
+    std::string name = it->path().filename().string();
+
+    // Files which are not named like cache files are left alone
+    boost::system::error_code fileError;
+    if (!IsHex(name, 0, 16) ||
+        !boost::filesystem::is_regular_file(it->path(), fileError)) {
+      continue;
+    }
+
+    Entry entry{it->path().string(),
+                static_cast<uint64_t>(
+                    boost::filesystem::file_size(it->path(), fileError)),
+                boost::filesystem::last_write_time(it->path(), fileError)};
+    if (fileError) {
+      continue;
+    }
+
+    std::string extension = it->path().extension().string();
+    if (extension == ".tmp") {
+      if (now - entry.lastUsed > ABANDONED_AGE) {
+        stale.push_back(entry);
+      }
+    } else if (name.size() < 33 || name[16] != '-' || !IsHex(name, 17, 16)) {
+      // Written by an older version which did not separate the stamp
+      stale.push_back(entry);
+    } else if (extension == ".raster") {
+      if (IsCurrent(entry.path)) {
+        entries.push_back(entry);
+      } else {
+        stale.push_back(entry);
+      }
+    } else {
+      derived[name.substr(0, 16)].push_back(entry);
+    }
+  }
+
+  // Derived files have no header, but the files of older versions of a source
+  // share their identity with the current one, which was written last
+  for (auto &group : derived) {
+    auto newest = std::max_element(group.second.begin(), group.second.end(),
+                                   [](Entry const &a, Entry const &b) {
+                                     return a.lastUsed < b.lastUsed;
+                                   });
+    for (auto it = group.second.begin(); it != group.second.end(); ++it) {
+      (it == newest ? entries : stale).push_back(*it);
+    }
+  }
+
+  uint64_t removedBytes = 0;
+  size_t removedFiles = 0;
+  auto remove = [&](Entry const &entry) {
+    boost::system::error_code removeError;
+    if (boost::filesystem::remove(entry.path, removeError)) {
+      removedBytes += entry.size;
+      ++removedFiles;
+    }
+  };
+
+  for (auto const &entry : stale) {
+    remove(entry);
+  }
+  size_t staleFiles = removedFiles;
+
+  // Least recently used files first
+  std::sort(entries.begin(), entries.end(),
+            [](Entry const &a, Entry const &b) {
+              return a.lastUsed < b.lastUsed;
+            });
+
+  uint64_t totalBytes = 0;
+  for (auto const &entry : entries) {
+    totalBytes += entry.size;
+  }
+
+  for (auto const &entry : entries) {
+    if (totalBytes <= budget) {
+      break;
+    }
+    totalBytes -= entry.size;
+    remove(entry);
+  }
+
+  if (removedFiles > 0) {
+    csp::vestec::logger().info(
+        "[RasterDiskCache] Removed {} stale and {} least recently used files "
+        "({:.1f} MB), {:.1f} of {:.1f} MB used",
+        staleFiles, removedFiles - staleFiles,
+        removedBytes / (1024.0 * 1024.0), totalBytes / (1024.0 * 1024.0),
+        budget / (1024.0 * 1024.0));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t RasterDiskCache::HashString(const std::string &value) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : value) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterDiskCache::GetSourceStamp(const std::string &filename,
+                                     SourceStamp &stamp) {
+  // Layers and subdatasets change with their file, members of an archive
+  // with the archive
+  std::string source = filename;
+  int layer = 0;
+  GDALReader::ResolveLayerPath(source, layer);
+  source = ArchiveReader::GetArchiveFile(GetSubdatasetFile(source));
+
+  boost::system::error_code error;
+  if (!boost::filesystem::is_regular_file(source, error)) {
+    return false;
+  }
+
+  stamp.size =
+      static_cast<int64_t>(boost::filesystem::file_size(source, error));
+  stamp.modificationTime =
+      static_cast<int64_t>(boost::filesystem::last_write_time(source, error));
+  return !error;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string RasterDiskCache::GetFileName(const std::string &identity,
+                                         SourceStamp const &stamp) {
+  std::stringstream version;
+  version << stamp.size << "|" << stamp.modificationTime;
+
+  std::stringstream name;
+  name << std::hex << std::setfill('0') << std::setw(16)
+       << HashString(identity) << "-" << std::setw(16)
+       << HashString(version.str());
+  return name.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterDiskCache::IsCurrent(const std::string &path) {
+  std::ifstream in(path, std::ifstream::binary);
+  Header header{};
+  if (!in.read(reinterpret_cast<char *>(&header), sizeof(Header)) ||
+      std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      header.version != CACHE_VERSION || header.pathLength > 64 * 1024) {
+    return false;
+  }
+
+  std::string source(header.pathLength, '\0');
+  SourceStamp stamp;
+  return in.read(&source[0], static_cast<std::streamsize>(source.size())) &&
+         GetSourceStamp(source, stamp) && stamp.size == header.sourceSize &&
+         stamp.modificationTime == header.sourceModificationTime;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string RasterDiskCache::GetCachePath(const std::string &filename,
+                                          int layer, const std::string &variant,
+                                          SourceStamp const &stamp) {
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    directory = mDirectory;
+  }
+
+  if (directory.empty()) {
+    return "";
+  }
+
+  std::stringstream identity;
+  identity << filename << "|" << layer << "|" << variant;
+
+  return directory + "/" + GetFileName(identity.str(), stamp) + ".raster";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string RasterDiskCache::GetDerivedPath(const std::string &filename,
+                                            const std::string &suffix) {
+  return GetDerivedPath(std::vector<std::string>{filename}, suffix);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string
+RasterDiskCache::GetDerivedPath(std::vector<std::string> const &filenames,
+                                const std::string &suffix) {
+  if (filenames.empty()) {
+    return "";
+  }
+
+  std::string identity;
+  SourceStamp stamp;
+  for (size_t i = 0; i < filenames.size(); ++i) {
+    SourceStamp source;
+    if (!GetSourceStamp(filenames[i], source)) {
+      return "";
+    }
+
+    if (i == 0) {
+      identity = filenames[i];
+      stamp = source;
+      continue;
+    }
+
+    // The stamps of further sources are folded into the one of the first, so
+    // that the file changes if any source changes
+    identity += "|" + filenames[i];
+    stamp.size = static_cast<int64_t>(HashString(
+        std::to_string(stamp.size) + "|" + std::to_string(source.size)));
+    stamp.modificationTime = static_cast<int64_t>(
+        HashString(std::to_string(stamp.modificationTime) + "|" +
+                   std::to_string(source.modificationTime)));
+  }
+
+  std::string directory;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    directory = mDirectory;
+  }
+
+  if (directory.empty()) {
+    return "";
+  }
+
+  std::string path =
+      directory + "/" + GetFileName(identity + "|" + suffix, stamp) + suffix;
+
+  boost::system::error_code error;
+  if (boost::filesystem::exists(path, error)) {
+    MarkUsed(path);
+  }
+  return path;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterDiskCache::Load(const std::string &filename, int layer,
+                           GDALReader::GreyScaleTexture &texture,
+                           const std::string &variant) {
+  SourceStamp stamp;
+  if (!GetSourceStamp(filename, stamp)) {
+    return false;
+  }
+
+  std::string path = GetCachePath(filename, layer, variant, stamp);
+  boost::system::error_code error;
+  if (path.empty() || !boost::filesystem::exists(path, error)) {
+    return false;
+  }
+
+  auto mapping = std::make_shared<MappedFile>();
+  try {
+    mapping->mFile = boost::interprocess::file_mapping(
+        path.c_str(), boost::interprocess::read_only);
+    mapping->mRegion = boost::interprocess::mapped_region(
+        mapping->mFile, boost::interprocess::read_only);
+  } catch (boost::interprocess::interprocess_exception const &e) {
+    csp::vestec::logger().warn("[RasterDiskCache] Failed to map '{}': {}",
+                               path, e.what());
+    return false;
+  }
+
+  auto const *bytes = static_cast<const char *>(mapping->mRegion.get_address());
+  size_t fileSize = mapping->mRegion.get_size();
+
+  Header header{};
+  if (fileSize < sizeof(Header)) {
+    return false;
+  }
+  std::memcpy(&header, bytes, sizeof(Header));
+
+  // Validate the header, a hash collision or an old version is a cache miss
+  auto type = static_cast<PixelType>(header.pixelType);
+  size_t pixels = static_cast<size_t>(header.width) * header.height;
+  if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      header.version != CACHE_VERSION || header.layer != layer ||
+      header.pixelType < static_cast<int32_t>(PixelType::Float32) ||
+      header.pixelType > static_cast<int32_t>(PixelType::Int16) ||
+      header.sourceSize != stamp.size ||
+      header.sourceModificationTime != stamp.modificationTime ||
+      header.pathLength != filename.size() ||
+      sizeof(Header) + header.pathLength > fileSize ||
+      filename.compare(0, std::string::npos, bytes + sizeof(Header),
+                       header.pathLength) != 0 ||
+      header.payloadOffset + pixels * GetPixelSize(type) > fileSize) {
+    csp::vestec::logger().debug("[RasterDiskCache] Ignoring stale entry {}",
+                                path);
+    return false;
+  }
+
+  PixelEncoding encoding;
+  encoding.scale = header.scale;
+  encoding.offset = header.offset;
+  encoding.hasNoData = header.hasNoData != 0;
+  encoding.noData = header.noData;
+
+  const void *data = bytes + header.payloadOffset;
+  texture.buffer =
+      RasterView(RasterBuffer::Wrap(data, pixels, type, std::move(mapping)),
+                 header.width, header.height, 1, encoding);
+  texture.x = header.width;
+  texture.y = header.height;
+  std::copy(std::begin(header.lnglatBounds), std::end(header.lnglatBounds),
+            texture.lnglatBounds.begin());
+  std::copy(std::begin(header.dataRange), std::end(header.dataRange),
+            texture.dataRange.begin());
+
+  MarkUsed(path);
+
+  csp::vestec::logger().debug("[RasterDiskCache] Mapped layer {} of {} from {}",
+                              layer, filename, path);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterDiskCache::Store(const std::string &filename, int layer,
+                            GDALReader::GreyScaleTexture const &texture,
+                            const std::string &variant) {
+  SourceStamp stamp;
+  if (!texture.buffer || !GetSourceStamp(filename, stamp)) {
+    return;
+  }
+
+  std::string path = GetCachePath(filename, layer, variant, stamp);
+  if (path.empty()) {
+    return;
+  }
+
+  RasterView pixels = texture.buffer.Compact();
+
+  Header header{};
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = CACHE_VERSION;
+  header.layer = layer;
+  header.width = pixels.Width();
+  header.height = pixels.Height();
+  header.pixelType = static_cast<int32_t>(pixels.Type());
+  header.hasNoData = pixels.Encoding().hasNoData ? 1 : 0;
+  header.scale = pixels.Encoding().scale;
+  header.offset = pixels.Encoding().offset;
+  header.noData = pixels.Encoding().noData;
+  std::copy(texture.lnglatBounds.begin(), texture.lnglatBounds.end(),
+            std::begin(header.lnglatBounds));
+  std::copy(texture.dataRange.begin(), texture.dataRange.end(),
+            std::begin(header.dataRange));
+  header.sourceSize = stamp.size;
+  header.sourceModificationTime = stamp.modificationTime;
+  header.pathLength = filename.size();
+  header.payloadOffset =
+      (sizeof(Header) + header.pathLength + PAYLOAD_ALIGNMENT - 1) /
+      PAYLOAD_ALIGNMENT * PAYLOAD_ALIGNMENT;
+
+  // Write to a temporary file first, so other threads or processes never map
+  // a partially written file
+  std::stringstream temporary;
+  temporary << path << "."
+            << std::hash<std::thread::id>()(std::this_thread::get_id())
+            << ".tmp";
+
+  {
+    std::ofstream out(temporary.str(), std::ofstream::binary);
+    std::vector<char> padding(
+        header.payloadOffset - sizeof(Header) - header.pathLength, 0);
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    out.write(filename.data(), static_cast<std::streamsize>(filename.size()));
+    out.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    out.write(static_cast<const char *>(pixels.Data()),
+              static_cast<std::streamsize>(static_cast<size_t>(pixels.Width()) *
+                                           pixels.Height() *
+                                           pixels.BytesPerPixel()));
+
+    if (!out) {
+      csp::vestec::logger().warn("[RasterDiskCache] Failed to write {}",
+                                 temporary.str());
+      out.close();
+      boost::system::error_code error;
+      boost::filesystem::remove(temporary.str(), error);
+      return;
+    }
+  }
+
+  boost::system::error_code error;
+  boost::filesystem::rename(temporary.str(), path, error);
+  if (error) {
+    csp::vestec::logger().warn("[RasterDiskCache] Failed to move {} to {}: {}",
+                               temporary.str(), path, error.message());
+    boost::filesystem::remove(temporary.str(), error);
+    return;
+  }
+
+  Trim();
+}
@@ -0,0 +1,153 @@
+#ifndef VESTEC_RASTER_DISK_CACHE
+#define VESTEC_RASTER_DISK_CACHE
+
+#include "GDALReader.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Persistent cache of reprojected rasters. Each warped layer is written to a
+ * single file in the cache directory, consisting of a small header (size,
+ * bounds, data range, pixel encoding and the identity of the source file)
+ * followed by the stored pixels. Cached layers are memory mapped when they are
+ * loaded again, so a warm load does not touch GDAL and pages are only read on
+ * access.
+ *
+ * Entries are keyed by the source path, its size, its modification time, the
+ * layer and a variant which distinguishes e.g. different storage types.
+ * Entries of modified source files are never matched again and are removed
+ * when the cache is trimmed. The cache directory is bounded by a byte budget,
+ * the least recently used files are removed first.
+ */
+class RasterDiskCache {
+public:
+  /**
+   * Sets the directory used to store the cache files. An empty string
+   * disables the cache
+   */
+  static void SetDirectory(const std::string &directory);
+
+  /**
+   * Sets the budget of all files in the cache directory in bytes and trims
+   * the cache. Default: 8 GB
+   */
+  static void SetBudget(uint64_t bytes);
+
+  /**
+   * Removes entries of modified source files and the least recently used
+   * files until the cache fits into its budget. Called after every stored
+   * layer, users of GetDerivedPath call it after writing large files. Returns
+   * immediately if another thread is trimming
+   */
+  static void Trim();
+
+  /**
+   * Maps a cached layer into the texture. Returns false if the layer is not
+   * cached or the source file changed since it was cached
+   */
+  static bool Load(const std::string &filename, int layer,
+                   GDALReader::GreyScaleTexture &texture,
+                   const std::string &variant = "");
+
+  /**
+   * Writes a warped layer to the cache. Files which are not on a local file
+   * system (e.g. GDAL virtual file systems) are not cached
+   */
+  static void Store(const std::string &filename, int layer,
+                    GDALReader::GreyScaleTexture const &texture,
+                    const std::string &variant = "");
+
+  /**
+   * Returns the path of a file in the cache directory which stores data
+   * derived from the current version of a source file, e.g. statistics. The
+   * suffix distinguishes the kind of data and is appended to the file name.
+   * An existing file is marked as used. Returns an empty string if the cache
+   * is disabled or the source is not on a local file system
+   */
+  static std::string GetDerivedPath(const std::string &filename,
+                                    const std::string &suffix);
+
+  /**
+   * Like GetDerivedPath for data derived from several source files, the path
+   * changes if any of them changes. Returns an empty string if the cache is
+   * disabled or one of the sources is not on a local file system
+   */
+  static std::string GetDerivedPath(std::vector<std::string> const &filenames,
+                                    const std::string &suffix);
+
+  /**
+   * Identity of a source file which invalidates the cache if it changes
+   */
+  struct SourceStamp {
+    int64_t size{};
+    int64_t modificationTime{};
+  };
+
+  /**
+   * Returns false if the file cannot be accessed through the file system.
+   * Files within an archive are stamped with the archive, layer paths and
+   * subdatasets with their file
+   */
+  static bool GetSourceStamp(const std::string &filename, SourceStamp &stamp);
+
+  /**
+   * 64 bit FNV-1a hash, stable across runs and platforms, e.g. for the names
+   * of cache files
+   */
+  static uint64_t HashString(const std::string &value);
+
+private:
+  /**
+   * Fixed size header at the start of every cache file
+   */
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    int32_t layer;
+    int32_t width;
+    int32_t height;
+    int32_t pixelType;
+    int32_t hasNoData;
+    float scale;
+    float offset;
+    double noData;
+    double lnglatBounds[4];
+    double dataRange[2];
+    int64_t sourceSize;
+    int64_t sourceModificationTime;
+    uint64_t pathLength;
+    uint64_t payloadOffset;
+  };
+
+  /**
+   * Returns the path of the cache file, or an empty string if the cache is
+   * disabled
+   */
+  static std::string GetCachePath(const std::string &filename, int layer,
+                                  const std::string &variant,
+                                  SourceStamp const &stamp);
+
+  /**
+   * Cache files are named "<identity>-<stamp>" followed by their extension,
+   * both being hashes. The identity hashes everything but the stamp of the
+   * source, so entries of older versions of a source share it
+   */
+  static std::string GetFileName(const std::string &identity,
+                                 SourceStamp const &stamp);
+
+  /**
+   * Returns false if the header of a cache file cannot be read, its version
+   * is outdated or its source changed since it was written
+   */
+  static bool IsCurrent(const std::string &path);
+
+  static std::string mDirectory;
+  static uint64_t mBudget;
+  static std::mutex mMutex;
+  static std::mutex mTrimMutex;
+};
+
+#endif // VESTEC_RASTER_DISK_CACHE
@@ -0,0 +1,319 @@
+#include "RasterLoader.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Every read already warps on multiple threads. A second loader thread lets a
+// small file pass while a large one is warped
+const int LOADER_THREADS = 2;
+
+// Low priority reads never occupy all loader threads, so a read the user waits
+// for does not have to wait for a prefetch
+const int MAX_RUNNING_LOW_PRIORITY = 1;
+
+} // namespace
+
+std::map<std::string, std::shared_ptr<RasterLoader::Job>> RasterLoader::mJobs;
+std::vector<std::thread> RasterLoader::mWorkers;
+std::mutex RasterLoader::mMutex;
+std::condition_variable RasterLoader::mWakeUp;
+bool RasterLoader::mIsStopping = false;
+uint64_t RasterLoader::mSequence = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterLoader::Ticket::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mIsCancelled || mIsDone) {
+      return;
+    }
+    mIsCancelled = true;
+  }
+  mDone.notify_all();
+
+  // A task which delivers its results right now finishes first
+  { std::lock_guard<std::mutex> lock(mDeliverMutex); }
+
+  RasterLoader::DropCancelled(mKey);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterLoader::Ticket::IsCancelled() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mIsCancelled;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterLoader::Ticket::Deliver(std::function<void()> const &deliver) {
+  std::lock_guard<std::mutex> lock(mDeliverMutex);
+  if (IsCancelled()) {
+    return false;
+  }
+  deliver();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::optional<GDALReader::GreyScaleTexture> RasterLoader::Ticket::Wait() {
+  std::unique_lock<std::mutex> lock(mMutex);
+  mDone.wait(lock, [this]() { return mIsDone || mIsCancelled; });
+  if (mIsCancelled) {
+    return std::nullopt;
+  }
+  return mTexture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterLoader::Ticket::Complete(
+    GDALReader::GreyScaleTexture const &texture) {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mIsCancelled) {
+      return;
+    }
+    mIsDone = true;
+    mTexture = texture;
+  }
+  mDone.notify_all();
+
+  if (mOnLoaded) {
+    mOnLoaded(texture);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterLoader::Ticket::ShowPreview(
+    GDALReader::GreyScaleTexture const &preview) {
+  if (WantsPreview()) {
+    mOnPreview(preview);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterLoader::Ticket::WantsPreview() const {
+  return mOnPreview && !IsCancelled();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<RasterLoader::Ticket>
+RasterLoader::Load(const std::string &filename, int layer,
+                   std::optional<GDALReader::Window> const &window,
+                   Priority priority, Callback onLoaded, Callback onPreview) {
+  auto ticket = std::make_shared<Ticket>();
+  ticket->mKey = GDALReader::GetCacheKey(filename, layer, window);
+  ticket->mOnLoaded = std::move(onLoaded);
+  ticket->mOnPreview = std::move(onPreview);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto &job = mJobs[ticket->mKey];
+  if (job) {
+    // Coalesce with the queued or running read of the same layer
+    job->priority = std::max(job->priority, priority);
+    job->tickets.push_back(ticket);
+    csp::vestec::logger().debug("[RasterLoader] Coalesced request for {}",
+                                ticket->mKey);
+
+    // A held back prefetch may be served right away now
+    mWakeUp.notify_one();
+    return ticket;
+  }
+
+  job = std::make_shared<Job>();
+  job->key = ticket->mKey;
+  job->filename = filename;
+  job->layer = layer;
+  job->window = window;
+  job->priority = priority;
+  job->tickets.push_back(ticket);
+  Enqueue(job);
+  return ticket;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<RasterLoader::Ticket>
+RasterLoader::Run(const std::string &name, Priority priority, Task task) {
+  auto ticket = std::make_shared<Ticket>();
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto job = std::make_shared<Job>();
+  job->task = std::move(task);
+  job->priority = priority;
+  job->tickets.push_back(ticket);
+  Enqueue(job);
+
+  // The sequence makes the key of each task unique
+  job->key = "task:" + name + "#" + std::to_string(job->sequence);
+  ticket->mKey = job->key;
+  mJobs[job->key] = job;
+  return ticket;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t RasterLoader::GetPendingCount() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mJobs.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterLoader::Shutdown() {
+  std::vector<std::thread> workers;
+  std::vector<std::shared_ptr<Ticket>> tickets;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIsStopping = true;
+    workers.swap(mWorkers);
+    for (auto const &job : mJobs) {
+      if (!job.second->isRunning) {
+        tickets.insert(tickets.end(), job.second->tickets.begin(),
+                       job.second->tickets.end());
+      }
+    }
+  }
+  mWakeUp.notify_all();
+
+  // Cancelling removes the queued jobs
+  for (auto const &ticket : tickets) {
+    ticket->Cancel();
+  }
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  mIsStopping = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterLoader::Enqueue(std::shared_ptr<Job> const &job) {
+  job->sequence = ++mSequence;
+
+  if (mWorkers.empty()) {
+    for (int i = 0; i < LOADER_THREADS; ++i) {
+      mWorkers.emplace_back(&RasterLoader::Work);
+    }
+  }
+
+  mWakeUp.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterLoader::Work() {
+  while (true) {
+    std::shared_ptr<Job> job;
+    std::vector<std::shared_ptr<Ticket>> tickets;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWakeUp.wait(lock, [&job]() {
+        job = mIsStopping ? nullptr : NextJob();
+        return mIsStopping || job;
+      });
+      if (mIsStopping) {
+        return;
+      }
+
+      job->isRunning = true;
+      tickets = job->tickets;
+    }
+
+    if (job->task) {
+      // A task is cancelled by its only ticket
+      if (!tickets[0]->IsCancelled()) {
+        job->task(*tickets[0]);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.erase(job->key);
+      }
+      tickets[0]->Complete(GDALReader::GreyScaleTexture());
+      continue;
+    }
+
+    // Requests coalesced after this point get the full resolution only
+    bool wantsPreview =
+        std::any_of(tickets.begin(), tickets.end(),
+                    [](auto const &ticket) { return ticket->WantsPreview(); });
+    GDALReader::GreyScaleTexture preview;
+    if (wantsPreview && GDALReader::ReadPreviewTexture(preview, job->filename,
+                                                       job->layer,
+                                                       job->window)) {
+      for (auto const &ticket : tickets) {
+        ticket->ShowPreview(preview);
+      }
+    }
+
+    GDALReader::GreyScaleTexture texture;
+    GDALReader::ReadGrayScaleTexture(texture, job->filename, job->layer,
+                                     job->window);
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      tickets = job->tickets;
+      mJobs.erase(job->key);
+    }
+
+    for (auto const &ticket : tickets) {
+      ticket->Complete(texture);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterLoader::DropCancelled(const std::string &key) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mJobs.find(key);
+  if (it == mJobs.end() || it->second->isRunning) {
+    return;
+  }
+
+  auto const &tickets = it->second->tickets;
+  if (std::all_of(tickets.begin(), tickets.end(),
+                  [](auto const &ticket) { return ticket->IsCancelled(); })) {
+    csp::vestec::logger().debug("[RasterLoader] Dropped cancelled read of {}",
+                                key);
+    mJobs.erase(it);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<RasterLoader::Job> RasterLoader::NextJob() {
+  int runningLowPriority = 0;
+  for (auto const &entry : mJobs) {
+    if (entry.second->isRunning &&
+        entry.second->priority == Priority::Low) {
+      ++runningLowPriority;
+    }
+  }
+
+  std::shared_ptr<Job> next;
+  for (auto const &entry : mJobs) {
+    auto const &job = entry.second;
+    if (job->isRunning || (job->priority == Priority::Low &&
+                           runningLowPriority >= MAX_RUNNING_LOW_PRIORITY)) {
+      continue;
+    }
+
+    if (!next || job->priority > next->priority ||
+        (job->priority == next->priority && job->sequence < next->sequence)) {
+      next = job;
+    }
+  }
+  return next;
+}
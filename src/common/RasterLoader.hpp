@@ -0,0 +1,170 @@
+#ifndef VESTEC_RASTER_LOADER
+#define VESTEC_RASTER_LOADER
+
+#include "GDALReader.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Loads texture layers with the GDALReader on a small pool of background
+ * threads, so the GUI callbacks never block on a file. Requests are served by
+ * priority, requests for the same layer (and window) are coalesced into a
+ * single read. A request can be cancelled at any time, a queued read whose
+ * requests are all cancelled is dropped before it touches the file. Reads
+ * which are already running finish and end up in the texture cache.
+ *
+ * Work on loaded layers, e.g. raster algebra or isolines, is run as a task on
+ * the same threads, so it shares their priorities and cancellation and does
+ * not add threads of its own.
+ */
+class RasterLoader {
+public:
+  enum class Priority {
+    Low,    //! e.g. prefetching
+    Normal, //! Data which is needed soon
+    High    //! Data which the user waits for
+  };
+
+  /**
+   * Called on a loader thread with the loaded texture. The buffer of the
+   * texture is empty if the file could not be read
+   */
+  using Callback = std::function<void(GDALReader::GreyScaleTexture const &)>;
+
+  class Ticket;
+
+  /**
+   * Called on a loader thread with the ticket of the task. Tasks hand their
+   * results over with Ticket::Deliver and may stop early once it is cancelled
+   */
+  using Task = std::function<void(Ticket &)>;
+
+  /**
+   * Handle of a single request. Dropping the ticket does not cancel the
+   * request
+   */
+  class Ticket {
+  public:
+    /**
+     * No callback of the request is called after Cancel returns, except one
+     * which is running on a loader thread at the same time
+     */
+    void Cancel();
+    bool IsCancelled() const;
+
+    /**
+     * Calls deliver unless the request is cancelled. Cancel waits for a
+     * running delivery, so deliver may access the owner of the ticket. Returns
+     * false if the request is cancelled
+     */
+    bool Deliver(std::function<void()> const &deliver);
+
+    /**
+     * Blocks until the texture is loaded. Returns nothing if the request was
+     * cancelled
+     */
+    std::optional<GDALReader::GreyScaleTexture> Wait();
+
+  private:
+    friend class RasterLoader;
+
+    void Complete(GDALReader::GreyScaleTexture const &texture);
+    void ShowPreview(GDALReader::GreyScaleTexture const &preview);
+    bool WantsPreview() const;
+
+    std::string mKey; //! Cache key of the requested layer
+    Callback mOnLoaded;
+    Callback mOnPreview;
+
+    mutable std::mutex mMutex;
+    std::mutex mDeliverMutex; //! Held while a task delivers its results
+    std::condition_variable mDone;
+    bool mIsCancelled = false;
+    bool mIsDone = false;
+    GDALReader::GreyScaleTexture mTexture;
+  };
+
+  /**
+   * Requests a layer of a file. onLoaded is called once the full resolution
+   * texture is loaded. If onPreview is set, a low resolution preview is read
+   * first (see GDALReader::ReadPreviewTexture) and passed to it, unless the
+   * read was already running when this request was made
+   */
+  static std::shared_ptr<Ticket>
+  Load(const std::string &filename, int layer,
+       std::optional<GDALReader::Window> const &window, Priority priority,
+       Callback onLoaded = {}, Callback onPreview = {});
+
+  /**
+   * Runs a task on a loader thread. Tasks are never coalesced, the name is
+   * only used for logging. Wait returns an empty texture once the task is done
+   */
+  static std::shared_ptr<Ticket> Run(const std::string &name,
+                                     Priority priority, Task task);
+
+  /**
+   * Number of reads and tasks which are queued or running
+   */
+  static size_t GetPendingCount();
+
+  /**
+   * Cancels all queued reads and waits for the running ones. Loader threads
+   * are started again by the next request
+   */
+  static void Shutdown();
+
+private:
+  /**
+   * A read of one layer which serves all coalesced requests, or a task
+   */
+  struct Job {
+    std::string key;
+    std::string filename;
+    int layer{};
+    std::optional<GDALReader::Window> window;
+    Task task; //! Run instead of reading a layer if set
+    Priority priority{};
+    uint64_t sequence{}; //! Requests of the same priority are served in order
+    bool isRunning = false;
+    std::vector<std::shared_ptr<Ticket>> tickets;
+  };
+
+  static void Work();
+
+  /**
+   * Queues a job and starts the loader threads. Needs to be called with a
+   * locked mutex
+   */
+  static void Enqueue(std::shared_ptr<Job> const &job);
+
+  /**
+   * Removes the queued job of the key if all of its requests are cancelled
+   */
+  static void DropCancelled(const std::string &key);
+
+  /**
+   * Returns the queued job which is served next or nullptr. Low priority jobs
+   * are only served while a loader thread is left for other jobs. Needs to be
+   * called with a locked mutex
+   */
+  static std::shared_ptr<Job> NextJob();
+
+  static std::map<std::string, std::shared_ptr<Job>>
+      mJobs; //! Queued and running jobs by cache key
+  static std::vector<std::thread> mWorkers;
+  static std::mutex mMutex;
+  static std::condition_variable mWakeUp;
+  static bool mIsStopping;
+  static uint64_t mSequence;
+};
+
+#endif // VESTEC_RASTER_LOADER
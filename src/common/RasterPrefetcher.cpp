@@ -0,0 +1,213 @@
+#include "RasterPrefetcher.hpp"
+#include "ArchiveReader.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Larger jumps are not scrubbing but selecting a layer
+const int MAX_STRIDE = 8;
+
+// Layers are prefetched for about this time of scrubbing at the current speed
+const double LOOKAHEAD_SECONDS = 1.0;
+
+// Pauses longer than this start a new measurement of the scrubbing speed
+const double MAX_INTERVAL = 2.0;
+
+} // namespace
+
+std::atomic<int> RasterPrefetcher::mMaxLayers{4};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterPrefetcher::~RasterPrefetcher() { Cancel(); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterPrefetcher::SetMaxLayers(int layers) {
+  mMaxLayers = std::max(layers, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RasterPrefetcher::GetMaxLayers() { return mMaxLayers; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterPrefetcher::Update(const std::string &filename, int layer,
+                              std::optional<GDALReader::Window> const &window) {
+  int maxLayers = GetMaxLayers();
+  Position position;
+  if (maxLayers == 0 || !GetPosition(filename, layer, position)) {
+    Cancel();
+    return;
+  }
+
+  // Follow the direction and speed of the last change
+  auto now = std::chrono::steady_clock::now();
+  if (mLast && IsSameSequence(*mLast, position)) {
+    int stride = position.index - mLast->index;
+    double interval = std::chrono::duration<double>(now - mLastTime).count();
+    if (stride != 0 && std::abs(stride) <= MAX_STRIDE) {
+      mStride = stride;
+      mInterval = (mInterval > 0.0 && interval < MAX_INTERVAL)
+                      ? 0.5 * (mInterval + interval)
+                      : interval;
+    }
+  } else {
+    mStride = 1;
+    mInterval = 0.0;
+  }
+  mLast = position;
+  mLastTime = now;
+
+  // Unknown speeds only prefetch the next layer
+  int count = 1;
+  if (mInterval > 0.0 && mInterval < MAX_INTERVAL) {
+    count = static_cast<int>(std::ceil(LOOKAHEAD_SECONDS / mInterval));
+  }
+  count = std::clamp(count, 1, maxLayers);
+
+  std::set<std::string> keys;
+  std::vector<std::pair<std::string, int>> steps;
+  for (int i = 1; i <= count; ++i) {
+    std::string stepFile;
+    int stepLayer = 1;
+    if (!GetStep(position, position.index + i * mStride, stepFile, stepLayer)) {
+      break;
+    }
+    keys.insert(GDALReader::GetCacheKey(stepFile, stepLayer, window));
+    steps.emplace_back(stepFile, stepLayer);
+  }
+
+  // Prefetches which fall out of the window are not needed anymore
+  for (auto it = mTickets.begin(); it != mTickets.end();) {
+    if (keys.find(it->first) == keys.end()) {
+      it->second->Cancel();
+      it = mTickets.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (auto const &step : steps) {
+    std::string key = GDALReader::GetCacheKey(step.first, step.second, window);
+    if (mTickets.find(key) != mTickets.end() ||
+        GDALReader::IsTextureCached(step.first, step.second, window)) {
+      continue;
+    }
+
+    mTickets[key] = RasterLoader::Load(step.first, step.second, window,
+                                       RasterLoader::Priority::Low);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterPrefetcher::Cancel() {
+  for (auto const &ticket : mTickets) {
+    ticket.second->Cancel();
+  }
+  mTickets.clear();
+  mLast.reset();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterPrefetcher::GetPosition(const std::string &filename, int layer,
+                                   Position &position) {
+  std::string dataset = filename;
+  if (GDALReader::ResolveLayerPath(dataset, layer)) {
+    position = {Position::Kind::LayerPaths, dataset, "", 0, layer};
+    return true;
+  }
+
+  if (GetLayerCount(filename) > 1) {
+    position = {Position::Kind::Layers, filename, "", 0, layer};
+    return true;
+  }
+
+  // The last number in the name of the file, e.g. day_12.nc
+  size_t nameStart = filename.find_last_of("/\\");
+  nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+  size_t end = filename.size();
+  auto isDigit = [&filename](size_t i) {
+    return std::isdigit(static_cast<unsigned char>(filename[i])) != 0;
+  };
+  while (end > nameStart && !isDigit(end - 1)) {
+    --end;
+  }
+  size_t start = end;
+  while (start > nameStart && isDigit(start - 1)) {
+    --start;
+  }
+  if (start == end || end - start > 9) {
+    return false;
+  }
+
+  std::string number = filename.substr(start, end - start);
+  int width = number.size() > 1 && number[0] == '0'
+                  ? static_cast<int>(number.size())
+                  : 0;
+  position = {Position::Kind::NumberedFile, filename.substr(0, start),
+              filename.substr(end), width, std::stoi(number)};
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterPrefetcher::GetStep(Position const &position, int index,
+                               std::string &filename, int &layer) {
+  if (index < 0) {
+    return false;
+  }
+
+  switch (position.kind) {
+  case Position::Kind::Layers:
+    filename = position.base;
+    layer = index;
+    return index >= 1 && index <= GetLayerCount(position.base);
+
+  case Position::Kind::LayerPaths:
+    filename = GDALReader::GetLayerPath(position.base, index);
+    layer = index;
+    return index >= 1 && index <= GetLayerCount(position.base);
+
+  case Position::Kind::NumberedFile: {
+    std::stringstream name;
+    name << position.base << std::setw(position.width) << std::setfill('0')
+         << index << position.suffix;
+    filename = name.str();
+    layer = 1;
+
+    return ArchiveReader::IsFile(filename);
+  }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RasterPrefetcher::GetLayerCount(const std::string &filename) {
+  auto it = mLayerCounts.find(filename);
+  if (it == mLayerCounts.end()) {
+    it = mLayerCounts
+             .emplace(filename, GDALReader::ReadNumberOfLayers(filename))
+             .first;
+  }
+  return it->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterPrefetcher::IsSameSequence(Position const &a, Position const &b) {
+  return a.kind == b.kind && a.base == b.base && a.suffix == b.suffix;
+}
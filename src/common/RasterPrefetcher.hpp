@@ -0,0 +1,99 @@
+#ifndef VESTEC_RASTER_PREFETCHER
+#define VESTEC_RASTER_PREFETCHER
+
+#include "RasterLoader.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+/**
+ * Warms the texture cache with the layers a node is likely to show next. The
+ * prefetcher watches the layers a node selects: consecutive layers of a file,
+ * time slices of a netCDF variable (see NetCDFReader) or numbered files like
+ * day_12.nc. It follows the direction and step size of the last change and
+ * requests the next layers with low priority from the RasterLoader. The faster
+ * the selection changes, the more layers are requested. Prefetches which fall
+ * out of this window are cancelled.
+ *
+ * A prefetcher belongs to a single node and is not thread safe.
+ */
+class RasterPrefetcher {
+public:
+  RasterPrefetcher() = default;
+  ~RasterPrefetcher();
+
+  RasterPrefetcher(RasterPrefetcher const &) = delete;
+  RasterPrefetcher &operator=(RasterPrefetcher const &) = delete;
+
+  /**
+   * Maximum number of layers which are prefetched ahead of the selected one,
+   * 0 disables prefetching
+   */
+  static void SetMaxLayers(int layers);
+  static int GetMaxLayers();
+
+  /**
+   * Reports the layer the node selected and prefetches the layers after it
+   */
+  void Update(const std::string &filename, int layer,
+              std::optional<GDALReader::Window> const &window);
+
+  /**
+   * Cancels all prefetches and forgets the selection history
+   */
+  void Cancel();
+
+private:
+  /**
+   * A position within a sequence of layers
+   */
+  struct Position {
+    enum class Kind {
+      Layers,      //! Bands of a file
+      LayerPaths,  //! Layer paths of a dataset
+      NumberedFile //! Files which only differ by a number
+    };
+
+    Kind kind{};
+    std::string base;   //! File or dataset, or the file name before the number
+    std::string suffix; //! File name after the number
+    int width{};        //! Digits of a zero padded file number
+    int index{};        //! Layer or file number
+  };
+
+  /**
+   * Finds the sequence of a selected layer. Returns false if it is not part of
+   * a sequence
+   */
+  bool GetPosition(const std::string &filename, int layer, Position &position);
+
+  /**
+   * Returns the file and layer at another index of a sequence. Returns false
+   * if the sequence has no such index
+   */
+  bool GetStep(Position const &position, int index, std::string &filename,
+               int &layer);
+
+  /**
+   * Number of layers of a file, which is only read once per file
+   */
+  int GetLayerCount(const std::string &filename);
+
+  static bool IsSameSequence(Position const &a, Position const &b);
+
+  static std::atomic<int> mMaxLayers;
+
+  std::optional<Position> mLast; //! The previously selected layer
+  std::chrono::steady_clock::time_point mLastTime;
+  int mStride = 1;         //! Index change of the last selection
+  double mInterval = 0.0;  //! Smoothed seconds between selections, 0 unknown
+  std::map<std::string, int> mLayerCounts;
+  std::map<std::string, std::shared_ptr<RasterLoader::Ticket>>
+      mTickets; //! Prefetches by cache key
+};
+
+#endif // VESTEC_RASTER_PREFETCHER
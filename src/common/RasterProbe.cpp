@@ -0,0 +1,103 @@
+#include "RasterProbe.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Smaller batches are not worth starting threads for
+const int MIN_PARALLEL_POSITIONS = 4096;
+
+bool IsNoData(float value) {
+  return std::isnan(value) || value == RASTER_NO_DATA;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterProbe::Sample(GDALReader::GreyScaleTexture const &texture,
+                         double lng, double lat, float &value,
+                         Interpolation interpolation) {
+  RasterView const &view = texture.buffer;
+  if (!view) {
+    return false;
+  }
+
+  // The warped grid is a regular lng/lat grid, latitude decreases downwards
+  auto const &bounds = texture.lnglatBounds;
+  double u = (lng - bounds[0]) / (bounds[2] - bounds[0]);
+  double v = (lat - bounds[1]) / (bounds[3] - bounds[1]);
+  if (!(u >= 0.0 && u <= 1.0 && v >= 0.0 && v <= 1.0)) {
+    return false;
+  }
+
+  int width = view.Width();
+  int height = view.Height();
+  double px = u * width;
+  double py = v * height;
+
+  int x = std::min(static_cast<int>(px), width - 1);
+  int y = std::min(static_cast<int>(py), height - 1);
+  float nearest = view.At(x, y);
+  if (IsNoData(nearest)) {
+    return false;
+  }
+
+  if (interpolation == Interpolation::Nearest) {
+    value = nearest;
+    return true;
+  }
+
+  // Relative to the pixel centers, the neighbours are clamped to the edges
+  px -= 0.5;
+  py -= 0.5;
+  int x0 = static_cast<int>(std::floor(px));
+  int y0 = static_cast<int>(std::floor(py));
+  double fx = px - x0;
+  double fy = py - y0;
+  int xs[2] = {std::clamp(x0, 0, width - 1), std::clamp(x0 + 1, 0, width - 1)};
+  int ys[2] = {std::clamp(y0, 0, height - 1),
+               std::clamp(y0 + 1, 0, height - 1)};
+
+  double sum = 0.0;
+  double weights = 0.0;
+  for (int j = 0; j < 2; ++j) {
+    for (int i = 0; i < 2; ++i) {
+      float sample = view.At(xs[i], ys[j]);
+      if (IsNoData(sample)) {
+        continue;
+      }
+      double weight = (i == 0 ? 1.0 - fx : fx) * (j == 0 ? 1.0 - fy : fy);
+      sum += weight * sample;
+      weights += weight;
+    }
+  }
+
+  // The nearest pixel is one of the neighbours with a weight of at least a
+  // quarter, so the weights never sum up to zero
+  value = static_cast<float>(sum / weights);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t RasterProbe::Sample(GDALReader::GreyScaleTexture const &texture,
+                           std::vector<std::array<double, 2>> const &positions,
+                           std::vector<float> &values,
+                           Interpolation interpolation) {
+  int count = static_cast<int>(positions.size());
+  values.assign(positions.size(), RASTER_NO_DATA);
+  size_t validPositions = 0;
+
+#pragma omp parallel for reduction(+ : validPositions)                         \
+    if (count >= MIN_PARALLEL_POSITIONS)
+  for (int i = 0; i < count; ++i) {
+    if (Sample(texture, positions[i][0], positions[i][1], values[i],
+               interpolation)) {
+      ++validPositions;
+    }
+  }
+
+  return validPositions;
+}
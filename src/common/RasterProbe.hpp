@@ -0,0 +1,46 @@
+#ifndef VESTEC_RASTER_PROBE
+#define VESTEC_RASTER_PROBE
+
+#include "GDALReader.hpp"
+
+#include <array>
+#include <vector>
+
+/**
+ * Looks up the values of a texture at geographic positions, e.g. the value
+ * under the mouse cursor. The lookup runs on the pixels of the GreyScaleTexture
+ * in main memory, so it neither reads back from nor synchronizes with the GPU.
+ *
+ * Positions are longitude and latitude in radians. Pixels which decode to
+ * RASTER_NO_DATA or NaN are never interpolated: a position whose nearest pixel
+ * has no data has no value, otherwise bilinear interpolation only weights the
+ * valid neighbours.
+ */
+class RasterProbe {
+public:
+  enum class Interpolation {
+    Nearest, //! Value of the pixel which contains the position
+    Bilinear //! Weighted value of the four closest pixel centers
+  };
+
+  /**
+   * Looks up the value at a position. Returns false if the position is
+   * outside of the texture or has no data
+   */
+  static bool Sample(GDALReader::GreyScaleTexture const &texture, double lng,
+                     double lat, float &value,
+                     Interpolation interpolation = Interpolation::Bilinear);
+
+  /**
+   * Looks up the values at many positions at once, large batches are spread
+   * over all cores. Positions without a value get RASTER_NO_DATA. Returns the
+   * number of positions with a value
+   */
+  static size_t
+  Sample(GDALReader::GreyScaleTexture const &texture,
+         std::vector<std::array<double, 2>> const &positions,
+         std::vector<float> &values,
+         Interpolation interpolation = Interpolation::Bilinear);
+};
+
+#endif // VESTEC_RASTER_PROBE
@@ -0,0 +1,317 @@
+#include "RasterStatistics.hpp"
+#include "GDALReader.hpp"
+#include "RasterDiskCache.hpp"
+
+// GDAL c++ includes
+#include "gdal_priv.h"
+
+#include <boost/filesystem.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+const int ROWS_PER_TASK = 64;
+
+// Version 2 has the histograms of TextureStatistics
+const int SIDECAR_VERSION = 2;
+
+} // namespace
+
+std::map<std::string, RasterStatistics::Entry> RasterStatistics::mEntries;
+std::map<std::string,
+         std::shared_future<std::shared_ptr<const RasterStatistics::File>>>
+    RasterStatistics::mPending;
+std::mutex RasterStatistics::mMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const RasterStatistics::File>
+RasterStatistics::Get(const std::string &filename) {
+  // Files which are not on the file system keep an empty stamp, their
+  // statistics are computed once per session
+  RasterDiskCache::SourceStamp stamp;
+  RasterDiskCache::GetSourceStamp(filename, stamp);
+
+  std::promise<std::shared_ptr<const File>> promise;
+  std::shared_future<std::shared_ptr<const File>> pending;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(filename);
+    if (it != mEntries.end() && it->second.stamp.size == stamp.size &&
+        it->second.stamp.modificationTime == stamp.modificationTime) {
+      return it->second.statistics;
+    }
+
+    // Wait for the thread which is computing the statistics already, e.g. the
+    // loader and the prefetcher requesting the same file
+    auto running = mPending.find(filename);
+    if (running != mPending.end()) {
+      pending = running->second;
+    } else {
+      mPending[filename] = promise.get_future().share();
+    }
+  }
+
+  if (pending.valid()) {
+    return pending.get();
+  }
+
+  std::shared_ptr<const File> statistics;
+  try {
+    std::string sidecar =
+        RasterDiskCache::GetDerivedPath(filename, ".stats.json");
+    if (!sidecar.empty()) {
+      statistics = LoadSidecar(sidecar, filename);
+    }
+
+    if (!statistics) {
+      statistics = Compute(filename);
+      if (statistics && !sidecar.empty()) {
+        StoreSidecar(sidecar, filename, *statistics);
+      }
+    }
+  } catch (...) {
+    // The waiting threads must not block forever, e.g. if memory runs out
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mPending.erase(filename);
+    }
+    promise.set_exception(std::current_exception());
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (statistics) {
+      mEntries[filename] = Entry{stamp, statistics};
+    }
+    mPending.erase(filename);
+  }
+
+  promise.set_value(statistics);
+  return statistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool RasterStatistics::GetRange(std::string filename, int layer,
+                                std::array<double, 2> &range) {
+  GDALReader::ResolveLayerPath(filename, layer);
+  auto statistics = Get(filename);
+  if (!statistics) {
+    return false;
+  }
+
+  if (layer == 0) {
+    range = statistics->range;
+    return true;
+  }
+
+  if (layer < 1 || layer > static_cast<int>(statistics->bands.size())) {
+    return false;
+  }
+
+  auto const &band = statistics->bands[layer - 1];
+  range = {band.min, band.max};
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const RasterStatistics::File>
+RasterStatistics::Compute(const std::string &filename) {
+  DatasetPool::Handle dataset = GDALReader::OpenDataset(filename);
+  if (dataset == nullptr) {
+    return nullptr;
+  }
+
+  int bands = dataset->GetRasterCount();
+  int width = dataset->GetRasterXSize();
+  int height = dataset->GetRasterYSize();
+  int threads = GDALReader::GetReadThreads(dataset.get());
+
+  std::vector<int> hasNoData(bands);
+  std::vector<double> noData(bands);
+  for (int band = 0; band < bands; ++band) {
+    noData[band] = dataset->GetRasterBand(band + 1)->GetNoDataValue(
+        &hasNoData[band]);
+  }
+
+  // Each task processes a block of rows of one band. The source is read twice,
+  // first for the value range and then for the histogram within that range
+  int tasksPerBand = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+  int tasks = bands * tasksPerBand;
+  std::vector<Band> partial(tasks);
+  auto result = std::make_shared<File>();
+  result->bands.resize(bands);
+
+  auto forEachTask = [&](auto const &kernel) {
+#pragma omp parallel num_threads(threads)
+    {
+#ifdef _OPENMP
+      bool isFirstThread = omp_get_thread_num() == 0;
+#else
+      bool isFirstThread = true;
+#endif
+      // GDAL datasets must not be shared between threads
+      DatasetPool::Handle local =
+          isFirstThread ? dataset : GDALReader::OpenDataset(filename);
+      auto rows =
+          RasterBuffer::Allocate(static_cast<size_t>(width) * ROWS_PER_TASK);
+      auto *values = static_cast<float *>(rows->Data());
+
+#pragma omp for schedule(dynamic)
+      for (int task = 0; task < tasks; ++task) {
+        if (local == nullptr) {
+          continue;
+        }
+
+        int band = task / tasksPerBand;
+        int firstRow = (task % tasksPerBand) * ROWS_PER_TASK;
+        int rowCount = std::min(ROWS_PER_TASK, height - firstRow);
+        if (local->GetRasterBand(band + 1)->RasterIO(
+                GF_Read, 0, firstRow, width, rowCount, values, width,
+                rowCount, GDT_Float32, 0, 0) != CE_None) {
+          continue;
+        }
+
+        // The kernels only know RASTER_NO_DATA and NaN as no data
+        size_t count = static_cast<size_t>(width) * rowCount;
+        auto sourceNoData = static_cast<float>(noData[band]);
+        if (hasNoData[band]) {
+          std::replace(values, values + count, sourceNoData, RASTER_NO_DATA);
+        }
+        kernel(partial[task], RasterView(rows, width, rowCount));
+      }
+    }
+  };
+
+  // First pass: value range, mean and no data count
+  forEachTask([](Band &acc, RasterView const &view) {
+    TextureStatistics::AccumulateRange(view, acc);
+  });
+
+  for (int band = 0; band < bands; ++band) {
+    auto &statistics = result->bands[band];
+    for (int task = band * tasksPerBand; task < (band + 1) * tasksPerBand;
+         ++task) {
+      TextureStatistics::Merge(partial[task], statistics);
+    }
+  }
+
+  // Second pass: histogram between the minimum and maximum of each band
+  for (int task = 0; task < tasks; ++task) {
+    partial[task] = result->bands[task / tasksPerBand];
+    partial[task].histogram.assign(HISTOGRAM_BINS, 0);
+  }
+
+  forEachTask([](Band &acc, RasterView const &view) {
+    TextureStatistics::AccumulateHistogram(view, acc);
+  });
+
+  dataset.reset();
+
+  bool hasRange = false;
+  for (int band = 0; band < bands; ++band) {
+    auto &statistics = result->bands[band];
+    statistics.histogram.assign(HISTOGRAM_BINS, 0);
+    for (int task = band * tasksPerBand; task < (band + 1) * tasksPerBand;
+         ++task) {
+      for (int bin = 0; bin < HISTOGRAM_BINS; ++bin) {
+        statistics.histogram[bin] += partial[task].histogram[bin];
+      }
+    }
+
+    if (statistics.validPixels == 0) {
+      continue;
+    }
+
+    result->range[0] =
+        hasRange ? std::min(result->range[0], statistics.min) : statistics.min;
+    result->range[1] =
+        hasRange ? std::max(result->range[1], statistics.max) : statistics.max;
+    hasRange = true;
+  }
+
+  csp::vestec::logger().debug(
+      "[RasterStatistics] Computed statistics of {} bands of {}", bands,
+      filename);
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const RasterStatistics::File>
+RasterStatistics::LoadSidecar(const std::string &path,
+                              const std::string &filename) {
+  boost::system::error_code error;
+  if (!boost::filesystem::exists(path, error)) {
+    return nullptr;
+  }
+
+  std::ifstream in(path);
+  nlohmann::json json = nlohmann::json::parse(in, nullptr, false);
+
+  // A hash collision, an old version or a broken file is a cache miss
+  if (json.is_discarded() || json.value("version", 0) != SIDECAR_VERSION ||
+      json.value("source", "") != filename ||
+      json.value("bins", 0) != HISTOGRAM_BINS || !json["bands"].is_array() ||
+      !json["range"].is_array() || json["range"].size() != 2) {
+    csp::vestec::logger().debug("[RasterStatistics] Ignoring stale sidecar {}",
+                                path);
+    return nullptr;
+  }
+
+  auto result = std::make_shared<File>();
+  result->range = {json["range"][0].get<double>(),
+                   json["range"][1].get<double>()};
+  for (auto const &entry : json["bands"]) {
+    Band band;
+    band.min = entry.value("min", 0.0);
+    band.max = entry.value("max", 0.0);
+    band.mean = entry.value("mean", 0.0);
+    band.validPixels = entry.value("validPixels", uint64_t(0));
+    band.noDataPixels = entry.value("noDataPixels", uint64_t(0));
+    band.histogram = entry.value("histogram", std::vector<uint64_t>());
+    band.histogram.resize(HISTOGRAM_BINS, 0);
+    result->bands.push_back(std::move(band));
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RasterStatistics::StoreSidecar(const std::string &path,
+                                    const std::string &filename,
+                                    File const &statistics) {
+  nlohmann::json json;
+  json["version"] = SIDECAR_VERSION;
+  json["source"] = filename;
+  json["bins"] = HISTOGRAM_BINS;
+  json["range"] = statistics.range;
+  json["bands"] = nlohmann::json::array();
+  for (auto const &band : statistics.bands) {
+    json["bands"].push_back({{"min", band.min},
+                             {"max", band.max},
+                             {"mean", band.mean},
+                             {"validPixels", band.validPixels},
+                             {"noDataPixels", band.noDataPixels},
+                             {"histogram", band.histogram}});
+  }
+
+  // The sidecar is small, a partially written file fails to parse and is
+  // recomputed
+  std::ofstream out(path);
+  out << json.dump();
+  if (!out) {
+    csp::vestec::logger().warn("[RasterStatistics] Failed to write {}", path);
+  }
+}
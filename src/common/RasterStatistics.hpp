@@ -0,0 +1,80 @@
+#ifndef VESTEC_RASTER_STATISTICS
+#define VESTEC_RASTER_STATISTICS
+
+#include "RasterDiskCache.hpp"
+#include "TextureStatistics.hpp"
+
+#include <array>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * Per band statistics of raster files. The statistics are computed once from
+ * the source pixels (not from the warped textures) and are kept in memory and
+ * as a json sidecar in the raster cache directory. Both are invalidated when
+ * the source file changes. Afterwards, data range queries are simple lookups
+ * and do not require to warp any band. The pixels are processed with the
+ * kernels of TextureStatistics, so both have the same histograms.
+ */
+class RasterStatistics {
+public:
+  static const int HISTOGRAM_BINS = TextureStatistics::HISTOGRAM_BINS;
+
+  /**
+   * Statistics of the valid (not no data) pixels of a single band
+   */
+  using Band = TextureStatistics::Result;
+
+  /**
+   * Statistics of all bands of a file
+   */
+  struct File {
+    std::vector<Band> bands;
+    std::array<double, 2> range{}; //! Value range over all bands
+  };
+
+  /**
+   * Returns the statistics of a file. They are computed if neither the memory
+   * nor the sidecar contains them, which blocks until all bands have been read.
+   * Concurrent requests of the same file wait for a single computation.
+   * Returns nullptr if the file cannot be read
+   */
+  static std::shared_ptr<const File> Get(const std::string &filename);
+
+  /**
+   * Writes the value range of a layer (starting at 1) into range. Layer 0
+   * returns the range over all layers. Returns false if the file cannot be
+   * read or the layer does not exist
+   */
+  static bool GetRange(std::string filename, int layer,
+                       std::array<double, 2> &range);
+
+private:
+  struct Entry {
+    RasterDiskCache::SourceStamp stamp; //! Of the file when it was read
+    std::shared_ptr<const File> statistics;
+  };
+
+  /**
+   * Reads all bands of the file in parallel and computes their statistics
+   */
+  static std::shared_ptr<const File> Compute(const std::string &filename);
+
+  static std::shared_ptr<const File> LoadSidecar(const std::string &path,
+                                                 const std::string &filename);
+  static void StoreSidecar(const std::string &path, const std::string &filename,
+                           File const &statistics);
+
+  static std::map<std::string, Entry> mEntries; //! Statistics per file
+  static std::map<std::string,
+                  std::shared_future<std::shared_ptr<const File>>>
+      mPending; //! Running computations per file
+  static std::mutex mMutex;
+};
+
+#endif // VESTEC_RASTER_STATISTICS
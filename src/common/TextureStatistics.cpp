@@ -0,0 +1,498 @@
+#include "TextureStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define VESTEC_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const int ROWS_PER_TASK = 64;
+
+/**
+ * Statistics of a block of rows
+ */
+struct Partial {
+  float min = std::numeric_limits<float>::infinity();
+  float max = -std::numeric_limits<float>::infinity();
+  double sum = 0.0;
+  uint64_t validPixels = 0;
+  uint64_t noDataPixels = 0;
+};
+
+/**
+ * Bins of a histogram from min to max. The last entry of the counts is not a
+ * bin, it receives the no data pixels so that the kernels need no branches
+ */
+struct Binning {
+  float min;
+  float scale; //! Bins per value
+  int bins;
+};
+
+bool IsNoData(float value) {
+  return std::isnan(value) || value == RASTER_NO_DATA;
+}
+
+void AccumulateScalar(const float *row, int count, Partial &partial) {
+  for (int i = 0; i < count; ++i) {
+    float value = row[i];
+    if (IsNoData(value)) {
+      ++partial.noDataPixels;
+      continue;
+    }
+    partial.min = std::min(partial.min, value);
+    partial.max = std::max(partial.max, value);
+    partial.sum += value;
+    ++partial.validPixels;
+  }
+}
+
+void BinScalar(const float *row, int count, Binning const &binning,
+               uint64_t *counts) {
+  for (int i = 0; i < count; ++i) {
+    float value = row[i];
+    int bin = binning.bins;
+    if (!IsNoData(value)) {
+      bin = std::clamp(static_cast<int>((value - binning.min) * binning.scale),
+                       0, binning.bins - 1);
+    }
+    ++counts[bin];
+  }
+}
+
+/**
+ * Finds the first and last valid pixel of a row. Returns false if the row has
+ * no valid pixels
+ */
+bool FindValidScalar(const float *row, int count, int &first, int &last) {
+  first = 0;
+  while (first < count && IsNoData(row[first])) {
+    ++first;
+  }
+  if (first == count) {
+    return false;
+  }
+
+  last = count - 1;
+  while (IsNoData(row[last])) {
+    --last;
+  }
+  return true;
+}
+
+#ifdef VESTEC_AVX2_KERNELS
+
+bool CpuSupportsAVX2() {
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+
+__attribute__((target("avx2"))) void
+AccumulateAVX2(const float *row, int count, Partial &partial) {
+  const __m256 noData = _mm256_set1_ps(RASTER_NO_DATA);
+  const __m256 positiveInfinity =
+      _mm256_set1_ps(std::numeric_limits<float>::infinity());
+  const __m256 negativeInfinity =
+      _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+
+  __m256 min = positiveInfinity;
+  __m256 max = negativeInfinity;
+  __m256d sumLow = _mm256_setzero_pd();
+  __m256d sumHigh = _mm256_setzero_pd();
+  uint64_t valid = 0;
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 values = _mm256_loadu_ps(row + i);
+
+    // Ordered comparison, so NaN is no data as well
+    __m256 isValid = _mm256_cmp_ps(values, noData, _CMP_NEQ_OQ);
+    min = _mm256_min_ps(min,
+                        _mm256_blendv_ps(positiveInfinity, values, isValid));
+    max = _mm256_max_ps(max,
+                        _mm256_blendv_ps(negativeInfinity, values, isValid));
+
+    // The sum is accumulated in double precision like in the scalar kernel
+    __m256 masked = _mm256_and_ps(values, isValid);
+    sumLow = _mm256_add_pd(sumLow,
+                           _mm256_cvtps_pd(_mm256_castps256_ps128(masked)));
+    sumHigh = _mm256_add_pd(sumHigh,
+                            _mm256_cvtps_pd(_mm256_extractf128_ps(masked, 1)));
+    valid += __builtin_popcount(_mm256_movemask_ps(isValid));
+  }
+
+  alignas(32) float mins[8];
+  alignas(32) float maxs[8];
+  alignas(32) double sums[4];
+  _mm256_store_ps(mins, min);
+  _mm256_store_ps(maxs, max);
+  _mm256_store_pd(sums, _mm256_add_pd(sumLow, sumHigh));
+  for (int lane = 0; lane < 8; ++lane) {
+    partial.min = std::min(partial.min, mins[lane]);
+    partial.max = std::max(partial.max, maxs[lane]);
+  }
+  partial.sum += sums[0] + sums[1] + sums[2] + sums[3];
+  partial.validPixels += valid;
+  partial.noDataPixels += static_cast<uint64_t>(i) - valid;
+
+  AccumulateScalar(row + i, count - i, partial);
+}
+
+__attribute__((target("avx2"))) void BinAVX2(const float *row, int count,
+                                             Binning const &binning,
+                                             uint64_t *counts) {
+  const __m256 noData = _mm256_set1_ps(RASTER_NO_DATA);
+  const __m256 min = _mm256_set1_ps(binning.min);
+  const __m256 scale = _mm256_set1_ps(binning.scale);
+  const __m256i lastBin = _mm256_set1_epi32(binning.bins - 1);
+  const __m256i noDataBin = _mm256_set1_epi32(binning.bins);
+
+  alignas(32) int32_t bins[8];
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 values = _mm256_loadu_ps(row + i);
+    __m256 isValid = _mm256_cmp_ps(values, noData, _CMP_NEQ_OQ);
+
+    __m256i bin = _mm256_cvttps_epi32(
+        _mm256_mul_ps(_mm256_sub_ps(values, min), scale));
+    bin = _mm256_max_epi32(_mm256_min_epi32(bin, lastBin),
+                           _mm256_setzero_si256());
+    bin = _mm256_blendv_epi8(noDataBin, bin, _mm256_castps_si256(isValid));
+    _mm256_store_si256(reinterpret_cast<__m256i *>(bins), bin);
+
+    // Scattered increments have no vector instruction
+    for (int lane = 0; lane < 8; ++lane) {
+      ++counts[bins[lane]];
+    }
+  }
+
+  BinScalar(row + i, count - i, binning, counts);
+}
+
+/**
+ * Bit mask of the valid pixels among the eight at the given address
+ */
+__attribute__((target("avx2"))) int ValidMaskAVX2(const float *pixels) {
+  __m256 values = _mm256_loadu_ps(pixels);
+  return _mm256_movemask_ps(
+      _mm256_cmp_ps(values, _mm256_set1_ps(RASTER_NO_DATA), _CMP_NEQ_OQ));
+}
+
+__attribute__((target("avx2"))) bool
+FindValidAVX2(const float *row, int count, int &first, int &last) {
+
+  // Eight pixels at a time from the left, the remainder is left to the
+  // scalar kernel
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    int mask = ValidMaskAVX2(row + i);
+    if (mask != 0) {
+      first = i + __builtin_ctz(mask);
+      break;
+    }
+  }
+  if (i + 8 > count) {
+    int tailFirst = 0;
+    if (!FindValidScalar(row + i, count - i, tailFirst, last)) {
+      return false;
+    }
+    first = i + tailFirst;
+    last += i;
+    return true;
+  }
+
+  // There is a valid pixel, so the search from the right stops at first
+  int j = count;
+  for (; j - 8 >= first; j -= 8) {
+    int mask = ValidMaskAVX2(row + j - 8);
+    if (mask != 0) {
+      last = j - 8 + 31 - __builtin_clz(mask);
+      return true;
+    }
+  }
+
+  last = j - 1;
+  while (IsNoData(row[last])) {
+    --last;
+  }
+  return true;
+}
+
+#else
+
+bool CpuSupportsAVX2() { return false; }
+
+#endif
+
+using AccumulateKernel = void (*)(const float *, int, Partial &);
+using BinKernel = void (*)(const float *, int, Binning const &, uint64_t *);
+using FindValidKernel = bool (*)(const float *, int, int &, int &);
+
+/**
+ * Calls the function for every row of the view with decoded floats. Plain
+ * float rows are passed without a copy
+ */
+template <typename F>
+void ForEachRow(RasterView const &view, F const &function) {
+  int height = view.Height();
+  int width = view.Width();
+  int tasks = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+  bool isDirect = view.IsPlainFloat() && view.PixelStride() == 1;
+
+#pragma omp parallel
+  {
+    std::vector<float> decoded(isDirect ? 0 : width);
+
+#pragma omp for schedule(dynamic)
+    for (int task = 0; task < tasks; ++task) {
+      int lastRow = std::min((task + 1) * ROWS_PER_TASK, height);
+      for (int y = task * ROWS_PER_TASK; y < lastRow; ++y) {
+        const float *row = nullptr;
+        if (isDirect) {
+          row = static_cast<const float *>(view.Data()) + y * view.RowStride();
+        } else {
+          view.DecodeRow(y, decoded.data());
+          row = decoded.data();
+        }
+        function(task, y, row, width);
+      }
+    }
+  }
+}
+
+Partial Accumulate(RasterView const &view, bool isVectorized) {
+  AccumulateKernel kernel = AccumulateScalar;
+#ifdef VESTEC_AVX2_KERNELS
+  if (isVectorized) {
+    kernel = AccumulateAVX2;
+  }
+#endif
+
+  int tasks = (view.Height() + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+  std::vector<Partial> partials(tasks);
+  ForEachRow(view, [&](int task, int /*y*/, const float *row, int width) {
+    kernel(row, width, partials[task]);
+  });
+
+  Partial total;
+  for (auto const &partial : partials) {
+    total.min = std::min(total.min, partial.min);
+    total.max = std::max(total.max, partial.max);
+    total.sum += partial.sum;
+    total.validPixels += partial.validPixels;
+    total.noDataPixels += partial.noDataPixels;
+  }
+  return total;
+}
+
+} // namespace
+
+std::atomic<bool> TextureStatistics::mIsVectorized{true};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureStatistics::ComputeRange(RasterView const &view,
+                                     std::array<double, 2> &range) {
+  Partial total = Accumulate(view, IsVectorized());
+  if (total.validPixels == 0) {
+    return false;
+  }
+
+  range = {total.min, total.max};
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureStatistics::ComputeValidExtent(RasterView const &view,
+                                           std::array<int, 4> &extent) {
+  FindValidKernel kernel = FindValidScalar;
+#ifdef VESTEC_AVX2_KERNELS
+  if (IsVectorized()) {
+    kernel = FindValidAVX2;
+  }
+#endif
+
+  // Corners of the valid pixels per block of rows
+  struct Bounds {
+    int minX = std::numeric_limits<int>::max();
+    int minY = std::numeric_limits<int>::max();
+    int maxX = -1;
+    int maxY = -1;
+  };
+
+  int tasks = (view.Height() + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+  std::vector<Bounds> partials(tasks);
+  ForEachRow(view, [&](int task, int y, const float *row, int width) {
+    int first = 0;
+    int last = 0;
+    if (kernel(row, width, first, last)) {
+      Bounds &bounds = partials[task];
+      bounds.minX = std::min(bounds.minX, first);
+      bounds.maxX = std::max(bounds.maxX, last);
+      bounds.minY = std::min(bounds.minY, y);
+      bounds.maxY = std::max(bounds.maxY, y);
+    }
+  });
+
+  Bounds total;
+  for (auto const &partial : partials) {
+    total.minX = std::min(total.minX, partial.minX);
+    total.minY = std::min(total.minY, partial.minY);
+    total.maxX = std::max(total.maxX, partial.maxX);
+    total.maxY = std::max(total.maxY, partial.maxY);
+  }
+  if (total.maxX < 0) {
+    return false;
+  }
+
+  extent = {total.minX, total.minY, total.maxX - total.minX + 1,
+            total.maxY - total.minY + 1};
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureStatistics::Result TextureStatistics::Compute(RasterView const &view,
+                                                     int bins) {
+  // First pass: value range, mean and no data count
+  Result result;
+  AccumulateRange(view, result);
+
+  // Second pass: histogram between the minimum and the maximum
+  result.histogram.assign(std::max(bins, 1), 0);
+  AccumulateHistogram(view, result);
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureStatistics::AccumulateRange(RasterView const &view,
+                                        Result &result) {
+  Partial total = Accumulate(view, IsVectorized());
+
+  Result partial;
+  partial.validPixels = total.validPixels;
+  partial.noDataPixels = total.noDataPixels;
+  if (total.validPixels > 0) {
+    partial.min = total.min;
+    partial.max = total.max;
+    partial.mean = total.sum / static_cast<double>(total.validPixels);
+  }
+  Merge(partial, result);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureStatistics::AccumulateHistogram(RasterView const &view,
+                                            Result &result) {
+  int bins = static_cast<int>(result.histogram.size());
+  if (result.validPixels == 0 || bins == 0) {
+    return;
+  }
+
+  BinKernel kernel = BinScalar;
+#ifdef VESTEC_AVX2_KERNELS
+  if (IsVectorized()) {
+    kernel = BinAVX2;
+  }
+#endif
+
+  auto extent = static_cast<float>(result.max - result.min);
+  Binning binning{static_cast<float>(result.min),
+                  extent > 0.F ? bins / extent : 0.F, bins};
+  int tasks = (view.Height() + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+  std::vector<std::vector<uint64_t>> counts(tasks);
+  ForEachRow(view, [&](int task, int /*y*/, const float *row, int width) {
+    if (counts[task].empty()) {
+      counts[task].assign(bins + 1, 0);
+    }
+    kernel(row, width, binning, counts[task].data());
+  });
+
+  for (auto const &partial : counts) {
+    for (int bin = 0; bin < static_cast<int>(partial.size()) && bin < bins;
+         ++bin) {
+      result.histogram[bin] += partial[bin];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureStatistics::Merge(Result const &partial, Result &result) {
+  result.noDataPixels += partial.noDataPixels;
+  if (partial.validPixels > 0) {
+    if (result.validPixels == 0) {
+      result.min = partial.min;
+      result.max = partial.max;
+    } else {
+      result.min = std::min(result.min, partial.min);
+      result.max = std::max(result.max, partial.max);
+    }
+
+    uint64_t validPixels = result.validPixels + partial.validPixels;
+    result.mean = (result.mean * static_cast<double>(result.validPixels) +
+                   partial.mean * static_cast<double>(partial.validPixels)) /
+                  static_cast<double>(validPixels);
+    result.validPixels = validPixels;
+  }
+
+  if (partial.histogram.size() == result.histogram.size()) {
+    for (size_t bin = 0; bin < result.histogram.size(); ++bin) {
+      result.histogram[bin] += partial.histogram[bin];
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double TextureStatistics::GetPercentile(Result const &result,
+                                        double fraction) {
+  if (result.validPixels == 0 || result.histogram.empty()) {
+    return 0.0;
+  }
+
+  // Pixels are assumed to be evenly distributed within each bin
+  double target = std::clamp(fraction, 0.0, 1.0) * result.validPixels;
+  double binWidth = (result.max - result.min) / result.histogram.size();
+  double count = 0.0;
+  for (size_t bin = 0; bin < result.histogram.size(); ++bin) {
+    double binCount = static_cast<double>(result.histogram[bin]);
+    if (binCount > 0.0 && count + binCount >= target) {
+      return result.min + (bin + (target - count) / binCount) * binWidth;
+    }
+    count += binCount;
+  }
+  return result.max;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureStatistics::GetAutoRange(
+    GDALReader::GreyScaleTexture const &texture, std::array<double, 2> &range,
+    double low, double high) {
+  // More bins than the default make the percentiles more accurate
+  Result result = Compute(texture.buffer, 4 * HISTOGRAM_BINS);
+  if (result.validPixels == 0) {
+    return false;
+  }
+
+  range = {GetPercentile(result, low), GetPercentile(result, high)};
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureStatistics::IsVectorized() {
+  return mIsVectorized && CpuSupportsAVX2();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureStatistics::SetVectorized(bool enable) { mIsVectorized = enable; }
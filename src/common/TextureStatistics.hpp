@@ -0,0 +1,105 @@
+#ifndef VESTEC_TEXTURE_STATISTICS
+#define VESTEC_TEXTURE_STATISTICS
+
+#include "GDALReader.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Statistics of raster views, e.g. of warped rasters, i.e. of the pixels
+ * which are actually shown. RasterStatistics uses the same kernels for the
+ * bands of the source files, block by block with AccumulateRange and
+ * AccumulateHistogram. Pixels which decode to RASTER_NO_DATA or NaN are
+ * counted as no data and are ignored otherwise.
+ *
+ * The kernels process rows of decoded floats with AVX2 if the CPU supports it
+ * and with a scalar fallback otherwise. Blocks of rows are distributed over
+ * all cores with OpenMP.
+ */
+class TextureStatistics {
+public:
+  static const int HISTOGRAM_BINS = 256;
+
+  /**
+   * Statistics of the valid pixels of a texture
+   */
+  struct Result {
+    double min{};
+    double max{};
+    double mean{};
+    uint64_t validPixels{};
+    uint64_t noDataPixels{};
+    std::vector<uint64_t> histogram; //! Bins of equal size from min to max
+  };
+
+  /**
+   * Computes the value range of a texture in a single pass. Returns false if
+   * the texture has no valid pixels
+   */
+  static bool ComputeRange(RasterView const &view,
+                           std::array<double, 2> &range);
+
+  /**
+   * Finds the smallest rectangle which contains all valid pixels as x, y,
+   * width and height. Returns false if the texture has no valid pixels
+   */
+  static bool ComputeValidExtent(RasterView const &view,
+                                 std::array<int, 4> &extent);
+
+  /**
+   * Computes the value range, mean, pixel counts and a histogram with the
+   * given number of bins. The histogram needs a second pass over the pixels
+   */
+  static Result Compute(RasterView const &view, int bins = HISTOGRAM_BINS);
+
+  /**
+   * Adds the value range, mean and pixel counts of a view to a result, e.g.
+   * for the blocks of a band which is too large to be read at once. The
+   * histogram is not changed
+   */
+  static void AccumulateRange(RasterView const &view, Result &result);
+
+  /**
+   * Adds the valid pixels of a view to the histogram of a result. The range
+   * and the size of the histogram define the bins, so the range must be
+   * accumulated over all blocks before
+   */
+  static void AccumulateHistogram(RasterView const &view, Result &result);
+
+  /**
+   * Adds a partial result to another one. Histograms are only added if both
+   * have the same size, they must cover the same range then
+   */
+  static void Merge(Result const &partial, Result &result);
+
+  /**
+   * Returns the approximate value below which the given fraction (0 to 1) of
+   * the valid pixels lies. The error is at most the width of one histogram
+   * bin
+   */
+  static double GetPercentile(Result const &result, double fraction);
+
+  /**
+   * Range for a transfer function which ignores outliers: the values between
+   * the low and high percentile of the valid pixels. Returns false if the
+   * texture has no valid pixels
+   */
+  static bool GetAutoRange(GDALReader::GreyScaleTexture const &texture,
+                           std::array<double, 2> &range, double low = 0.02,
+                           double high = 0.98);
+
+  /**
+   * Returns true if the vectorized kernels are used. They can be disabled,
+   * e.g. to compare them with the scalar kernels
+   */
+  static bool IsVectorized();
+  static void SetVectorized(bool enable);
+
+private:
+  static std::atomic<bool> mIsVectorized;
+};
+
+#endif // VESTEC_TEXTURE_STATISTICS
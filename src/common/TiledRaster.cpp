@@ -0,0 +1,277 @@
+#include "TiledRaster.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileId::operator==(TileId const &other) const {
+  return level == other.level && x == other.x && y == other.y;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileId::operator<(TileId const &other) const {
+  if (level != other.level) {
+    return level < other.level;
+  }
+  if (y != other.y) {
+    return y < other.y;
+  }
+  return x < other.x;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TiledRaster::TiledRaster(GDALReader::GreyScaleTexture texture, int tileSize)
+    : mTexture(std::move(texture)), mTileSize(std::max(tileSize, 1)) {
+  int size = std::max(mTexture.x, mTexture.y);
+  while ((size + (1 << (mLevels - 1)) - 1) >> (mLevels - 1) > mTileSize) {
+    ++mLevels;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TiledRaster::TileSize() const { return mTileSize; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TiledRaster::Levels() const { return mLevels; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TiledRaster::TilesX(int level) const {
+  int width = (mTexture.x + (1 << level) - 1) >> level;
+  return (width + mTileSize - 1) / mTileSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int TiledRaster::TilesY(int level) const {
+  int height = (mTexture.y + (1 << level) - 1) >> level;
+  return (height + mTileSize - 1) / mTileSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TiledRaster::Contains(TileId const &tile) const {
+  return tile.level >= 0 && tile.level < mLevels && tile.x >= 0 &&
+         tile.y >= 0 && tile.x < TilesX(tile.level) &&
+         tile.y < TilesY(tile.level);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::array<int, 4> TiledRaster::PixelExtents(TileId const &tile) const {
+  // A pixel of the tile level covers step x step full resolution pixels
+  int64_t span = static_cast<int64_t>(mTileSize) << tile.level;
+  auto clampX = [this](int64_t x) {
+    return static_cast<int>(std::min<int64_t>(x, mTexture.x));
+  };
+  auto clampY = [this](int64_t y) {
+    return static_cast<int>(std::min<int64_t>(y, mTexture.y));
+  };
+  return {clampX(tile.x * span), clampY(tile.y * span),
+          clampX((tile.x + 1) * span), clampY((tile.y + 1) * span)};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::array<double, 4> TiledRaster::TileBounds(TileId const &tile) const {
+  auto extents = PixelExtents(tile);
+  auto const &bounds = mTexture.lnglatBounds;
+  double lngPerPixel = (bounds[2] - bounds[0]) / std::max(mTexture.x, 1);
+  double latPerPixel = (bounds[3] - bounds[1]) / std::max(mTexture.y, 1);
+  return {bounds[0] + extents[0] * lngPerPixel,
+          bounds[1] + extents[1] * latPerPixel,
+          bounds[0] + extents[2] * lngPerPixel,
+          bounds[1] + extents[3] * latPerPixel};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RasterView TiledRaster::TilePixels(TileId const &tile) const {
+  int step = 1 << tile.level;
+  return mTexture.buffer.Strided(step, step)
+      .SubRect(tile.x * mTileSize, tile.y * mTileSize, mTileSize, mTileSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GDALReader::GreyScaleTexture const &TiledRaster::Texture() const {
+  return mTexture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileSelector::TileSelector(double planetRadius, double pixelAngle,
+                           size_t maxTiles)
+    : mPlanetRadius(planetRadius), mPixelAngle(pixelAngle),
+      mMaxTiles(std::max<size_t>(maxTiles, 1)) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double TileSelector::GetAngularDistance(std::array<double, 4> const &bounds,
+                                        Observer const &observer) const {
+  // Closest point of the tile, the bounds are ordered west, north, east, south
+  double lng = std::clamp(observer.lng, std::min(bounds[0], bounds[2]),
+                          std::max(bounds[0], bounds[2]));
+  double lat = std::clamp(observer.lat, std::min(bounds[1], bounds[3]),
+                          std::max(bounds[1], bounds[3]));
+
+  // Haversine formula
+  double sinLat = std::sin((lat - observer.lat) * 0.5);
+  double sinLng = std::sin((lng - observer.lng) * 0.5);
+  double a = sinLat * sinLat +
+             std::cos(lat) * std::cos(observer.lat) * sinLng * sinLng;
+  return 2.0 * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TileId>
+TileSelector::Select(TiledRaster const &raster,
+                     Observer const &observer) const {
+  double height = std::max(observer.height, 1.0);
+  double horizon = std::acos(mPlanetRadius / (mPlanetRadius + height));
+
+  // Angular size of a full resolution pixel
+  auto const &texture = raster.Texture();
+  double lngPerPixel = std::abs(texture.lnglatBounds[2] -
+                                texture.lnglatBounds[0]) /
+                       std::max(texture.x, 1);
+  double latPerPixel = std::abs(texture.lnglatBounds[3] -
+                                texture.lnglatBounds[1]) /
+                       std::max(texture.y, 1);
+
+  // Breadth first, so the budget is spent evenly on the visible area
+  std::deque<TileId> queue;
+  int coarsest = raster.Levels() - 1;
+  for (int y = 0; y < raster.TilesY(coarsest); ++y) {
+    for (int x = 0; x < raster.TilesX(coarsest); ++x) {
+      queue.push_back({coarsest, x, y});
+    }
+  }
+
+  std::vector<TileId> selected;
+  while (!queue.empty()) {
+    TileId tile = queue.front();
+    queue.pop_front();
+
+    auto bounds = raster.TileBounds(tile);
+    double angle = GetAngularDistance(bounds, observer);
+    if (angle > horizon) {
+      continue;
+    }
+
+    // Size of a tile pixel on the ground and its distance to the observer
+    double groundDistance = angle * mPlanetRadius;
+    double distance =
+        std::sqrt(groundDistance * groundDistance + height * height);
+    double lat = std::min(std::abs(bounds[1]), std::abs(bounds[3]));
+    double pixelSize = std::max(lngPerPixel * std::cos(lat), latPerPixel) *
+                       mPlanetRadius * (1 << tile.level);
+
+    // Each refined tile is replaced by up to four children
+    bool isTooCoarse = pixelSize > distance * mPixelAngle;
+    if (tile.level > 0 && isTooCoarse &&
+        selected.size() + queue.size() + 4 <= mMaxTiles) {
+      for (int child = 0; child < 4; ++child) {
+        TileId childTile{tile.level - 1, tile.x * 2 + child % 2,
+                         tile.y * 2 + child / 2};
+        if (raster.Contains(childTile)) {
+          queue.push_back(childTile);
+        }
+      }
+    } else {
+      selected.push_back(tile);
+    }
+  }
+
+  return selected;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileResidency::TileResidency(size_t maxResident)
+    : mMaxResident(std::max<size_t>(maxResident, 1)) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TileResidency::Changes TileResidency::Update(std::vector<TileId> const &needed,
+                                             size_t maxLoads) {
+  ++mFrame;
+  Changes changes;
+
+  // Coarse tiles cover more area and are loaded first
+  std::vector<TileId> missing;
+  for (auto const &tile : needed) {
+    if (IsResident(tile)) {
+      mLastUsed[tile] = mFrame;
+    } else {
+      missing.push_back(tile);
+    }
+  }
+  std::stable_sort(missing.begin(), missing.end(),
+                   [](TileId const &a, TileId const &b) {
+                     return a.level > b.level;
+                   });
+
+  for (size_t i = 0; i < missing.size() && i < maxLoads; ++i) {
+    mLastUsed[missing[i]] = mFrame;
+    changes.load.push_back(missing[i]);
+  }
+
+  // Tiles which are not resident yet are drawn with their closest ancestor.
+  // The ancestor is clipped to the needed tile, so it does not cover resident
+  // siblings of the needed tile
+  for (auto const &region : needed) {
+    // The level is bounded, a raster cannot have more than 31 levels
+    TileId tile = region;
+    while (!IsResident(tile) && tile.level < 31) {
+      tile = {tile.level + 1, tile.x / 2, tile.y / 2};
+    }
+    if (IsResident(tile)) {
+      mLastUsed[tile] = mFrame;
+      changes.draw.push_back({tile, region});
+    }
+  }
+
+  // Evict the tiles which were not needed for the longest time. Tiles of the
+  // current frame are kept even if this exceeds the budget
+  while (mLastUsed.size() > mMaxResident) {
+    auto oldest = std::min_element(
+        mLastUsed.begin(), mLastUsed.end(),
+        [](auto const &a, auto const &b) { return a.second < b.second; });
+    if (oldest->second == mFrame) {
+      break;
+    }
+    changes.evict.push_back(oldest->first);
+    mLastUsed.erase(oldest);
+  }
+
+  return changes;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<TileId> TileResidency::Clear() {
+  std::vector<TileId> tiles;
+  for (auto const &entry : mLastUsed) {
+    tiles.push_back(entry.first);
+  }
+  mLastUsed.clear();
+  return tiles;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TileResidency::IsResident(TileId const &tile) const {
+  return mLastUsed.find(tile) != mLastUsed.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t TileResidency::Size() const { return mLastUsed.size(); }
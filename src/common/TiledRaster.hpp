@@ -0,0 +1,167 @@
+#ifndef VESTEC_TILED_RASTER
+#define VESTEC_TILED_RASTER
+
+#include "GDALReader.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+/**
+ * Identifies a tile of a TiledRaster. Level 0 has the full resolution, the
+ * resolution halves with every level
+ */
+struct TileId {
+  int level{};
+  int x{};
+  int y{};
+
+  bool operator==(TileId const &other) const;
+  bool operator<(TileId const &other) const;
+};
+
+/**
+ * Splits a geo-referenced texture into a pyramid of fixed size tiles. Tiles of
+ * coarser levels are strided views on the full resolution pixels, so no pixel
+ * is copied before a tile is uploaded. The level with the lowest resolution
+ * fits into a single tile. Nothing here depends on OpenGL.
+ */
+class TiledRaster {
+public:
+  TiledRaster(GDALReader::GreyScaleTexture texture, int tileSize);
+
+  int TileSize() const;
+
+  /**
+   * Number of levels, the last level consists of a single tile
+   */
+  int Levels() const;
+
+  /**
+   * Number of tiles in each direction on a level
+   */
+  int TilesX(int level) const;
+  int TilesY(int level) const;
+
+  /**
+   * Returns false for tiles outside of the raster
+   */
+  bool Contains(TileId const &tile) const;
+
+  /**
+   * Geographic extents of a tile in radians, in the order of
+   * GreyScaleTexture::lnglatBounds (west, north, east, south)
+   */
+  std::array<double, 4> TileBounds(TileId const &tile) const;
+
+  /**
+   * The pixels of a tile, at most TileSize() x TileSize()
+   */
+  RasterView TilePixels(TileId const &tile) const;
+
+  GDALReader::GreyScaleTexture const &Texture() const;
+
+private:
+  /**
+   * Extents of a tile in full resolution pixels: x0, y0, x1, y1
+   */
+  std::array<int, 4> PixelExtents(TileId const &tile) const;
+
+  GDALReader::GreyScaleTexture mTexture;
+  int mTileSize;
+  int mLevels = 1;
+};
+
+/**
+ * Selects the tiles which are needed for the current observer. Starting with
+ * the coarsest level, tiles are refined like a quadtree until one tile pixel
+ * appears smaller than the given angle from the observer or the tile budget
+ * is used up. Tiles beyond the horizon are skipped.
+ */
+class TileSelector {
+public:
+  /**
+   * Position of the observer, longitude and latitude in radians and height
+   * above the surface in meters
+   */
+  struct Observer {
+    double lng{};
+    double lat{};
+    double height{};
+  };
+
+  TileSelector(double planetRadius, double pixelAngle, size_t maxTiles);
+
+  /**
+   * Returns non-overlapping tiles which cover the visible part of the raster
+   */
+  std::vector<TileId> Select(TiledRaster const &raster,
+                             Observer const &observer) const;
+
+private:
+  /**
+   * Angle between the observer position on the surface and the closest point
+   * of the tile, in radians
+   */
+  double GetAngularDistance(std::array<double, 4> const &bounds,
+                            Observer const &observer) const;
+
+  double mPlanetRadius; //! Meters
+  double mPixelAngle;   //! Radians
+  size_t mMaxTiles;
+};
+
+/**
+ * Decides which tiles are resident on the GPU. Tiles stay resident until the
+ * budget is exceeded, then the tiles which were not needed for the longest
+ * time are evicted first. Needed tiles which are not resident yet are drawn
+ * using their closest resident ancestor instead, clipped to the extent of the
+ * needed tile. Thus no area is drawn twice, which would blend it twice.
+ */
+class TileResidency {
+public:
+  /**
+   * A resident tile drawn in the extent of a needed tile. Both are the same
+   * unless the needed tile is not resident yet
+   */
+  struct DrawTile {
+    TileId tile;
+    TileId region;
+  };
+
+  /**
+   * Result of a frame: tiles to upload, tiles to release and the resident
+   * tiles to draw. The regions of the drawn tiles do not overlap
+   */
+  struct Changes {
+    std::vector<TileId> load;
+    std::vector<TileId> evict;
+    std::vector<DrawTile> draw;
+  };
+
+  explicit TileResidency(size_t maxResident);
+
+  /**
+   * Marks the needed tiles as used. At most maxLoads missing tiles are
+   * scheduled for upload, coarse tiles first. They are treated as resident
+   * from now on
+   */
+  Changes Update(std::vector<TileId> const &needed, size_t maxLoads);
+
+  /**
+   * Forgets all tiles and returns them, they need to be released
+   */
+  std::vector<TileId> Clear();
+
+  bool IsResident(TileId const &tile) const;
+  size_t Size() const;
+
+private:
+  std::map<TileId, uint64_t> mLastUsed; //! Frame in which a tile was needed
+  uint64_t mFrame = 0;
+  size_t mMaxResident;
+};
+
+#endif // VESTEC_TILED_RASTER
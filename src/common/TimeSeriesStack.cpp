@@ -0,0 +1,225 @@
+#include "TimeSeriesStack.hpp"
+#include "GridResampler.hpp"
+#include "TextureStatistics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+bool IsNoData(float value) {
+  return std::isnan(value) || value == RASTER_NO_DATA;
+}
+
+} // namespace
+
+// Default budget of the stacks, can be overwritten in the plugin settings with
+// "vestec-time-series-cache-size"
+LRUCache<std::shared_ptr<const TimeSeriesStack::Stack>>
+    TimeSeriesStack::StackCache(512ul * 1024ul * 1024ul);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const float *TimeSeriesStack::Stack::Series(int x, int y) const {
+  return static_cast<const float *>(values->Data()) +
+         (static_cast<size_t>(y) * width + x) * steps;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const TimeSeriesStack::Stack>
+TimeSeriesStack::Get(const std::string &filename,
+                     std::optional<GDALReader::Window> const &window) {
+  // Layer 0 does not exist, so the key does not collide with the textures
+  std::string key = GDALReader::GetCacheKey(filename, 0, window);
+  if (auto cached = StackCache.Get(key)) {
+    return cached.value();
+  }
+
+  std::vector<GDALReader::GreyScaleTexture> textures;
+  GDALReader::ReadAllLayers(textures, filename, window);
+  auto stack = Build(std::move(textures));
+  if (!stack) {
+    csp::vestec::logger().error(
+        "[TimeSeriesStack] Failed to build the time series of {}", filename);
+    return nullptr;
+  }
+
+  // Another thread may have built the same stack in the meantime
+  if (auto existing = StackCache.Insert(key, stack, stack->values->Bytes())) {
+    return existing.value();
+  }
+  return stack;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const TimeSeriesStack::Stack>
+TimeSeriesStack::Build(std::vector<GDALReader::GreyScaleTexture> textures) {
+  if (textures.empty()) {
+    return nullptr;
+  }
+  for (auto const &texture : textures) {
+    if (!texture.buffer) {
+      return nullptr;
+    }
+  }
+
+  // Cropping may have given each layer a different extent. The layers share
+  // their grid, so they are only padded
+  if (!GridResampler::Align(textures, GridResampler::Kernel::Nearest)) {
+    return nullptr;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  auto stack = std::make_shared<Stack>();
+  stack->width = textures[0].buffer.Width();
+  stack->height = textures[0].buffer.Height();
+  stack->steps = static_cast<int>(textures.size());
+  stack->lnglatBounds = textures[0].lnglatBounds;
+  for (auto const &texture : textures) {
+    stack->dataRanges.push_back(texture.dataRange);
+  }
+
+  int width = stack->width;
+  int height = stack->height;
+  int steps = stack->steps;
+  auto pixels =
+      RasterBuffer::Allocate(static_cast<size_t>(width) * height * steps);
+  auto *data = static_cast<float *>(pixels->Data());
+
+  // Each thread decodes the rows of all layers and interleaves them
+#pragma omp parallel
+  {
+    std::vector<float> rows(static_cast<size_t>(steps) * width);
+
+#pragma omp for schedule(dynamic)
+    for (int y = 0; y < height; ++y) {
+      for (int step = 0; step < steps; ++step) {
+        textures[step].buffer.DecodeRow(
+            y, rows.data() + static_cast<size_t>(step) * width);
+      }
+
+      float *target = data + static_cast<size_t>(y) * width * steps;
+      for (int x = 0; x < width; ++x) {
+        for (int step = 0; step < steps; ++step) {
+          float value = rows[static_cast<size_t>(step) * width + x];
+          *target++ = IsNoData(value) ? RASTER_NO_DATA : value;
+        }
+      }
+    }
+  }
+
+  stack->values = std::move(pixels);
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  csp::vestec::logger().debug(
+      "[TimeSeriesStack] Interleaved {} layers of {}x{} pixels in {:.1f} ms",
+      steps, width, height, elapsed.count());
+
+  return stack;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TimeSeriesStack::GetPixel(Stack const &stack, double lng, double lat,
+                               int &x, int &y) {
+  // The warped grid is a regular lng/lat grid, latitude decreases downwards
+  auto const &bounds = stack.lnglatBounds;
+  double u = (lng - bounds[0]) / (bounds[2] - bounds[0]);
+  double v = (lat - bounds[1]) / (bounds[3] - bounds[1]);
+  if (!(u >= 0.0 && u < 1.0 && v >= 0.0 && v < 1.0)) {
+    return false;
+  }
+
+  x = std::min(static_cast<int>(u * stack.width), stack.width - 1);
+  y = std::min(static_cast<int>(v * stack.height), stack.height - 1);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TimeSeriesStack::ReadSeries(Stack const &stack, double lng, double lat,
+                                 std::vector<float> &series) {
+  int x = 0;
+  int y = 0;
+  if (!GetPixel(stack, lng, lat, x, y)) {
+    return false;
+  }
+
+  const float *values = stack.Series(x, y);
+  series.assign(values, values + stack.steps);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GDALReader::GreyScaleTexture
+TimeSeriesStack::Aggregate(Stack const &stack, Aggregation aggregation,
+                           int firstStep, int steps) {
+  firstStep = std::clamp(firstStep, 0, stack.steps);
+  int lastStep = steps < 0 ? stack.steps
+                           : std::min(firstStep + steps, stack.steps);
+
+  GDALReader::GreyScaleTexture texture;
+  texture.x = stack.width;
+  texture.y = stack.height;
+  texture.lnglatBounds = stack.lnglatBounds;
+
+  size_t count = static_cast<size_t>(stack.width) * stack.height;
+  auto pixels = RasterBuffer::Allocate(count, RASTER_NO_DATA);
+  auto *data = static_cast<float *>(pixels->Data());
+
+#pragma omp parallel for schedule(dynamic)
+  for (int y = 0; y < stack.height; ++y) {
+    for (int x = 0; x < stack.width; ++x) {
+      const float *series = stack.Series(x, y);
+      float result = 0.F;
+      double sum = 0.0;
+      int valid = 0;
+      for (int step = firstStep; step < lastStep; ++step) {
+        float value = series[step];
+        if (value == RASTER_NO_DATA) {
+          continue;
+        }
+        if (valid == 0) {
+          result = value;
+        } else if (aggregation == Aggregation::Min) {
+          result = std::min(result, value);
+        } else if (aggregation == Aggregation::Max) {
+          result = std::max(result, value);
+        }
+        sum += value;
+        ++valid;
+      }
+
+      if (aggregation == Aggregation::Count) {
+        result = static_cast<float>(valid);
+      } else if (valid == 0) {
+        continue;
+      } else if (aggregation == Aggregation::Mean) {
+        result = static_cast<float>(sum / valid);
+      } else if (aggregation == Aggregation::Sum) {
+        result = static_cast<float>(sum);
+      }
+
+      data[static_cast<size_t>(y) * stack.width + x] = result;
+    }
+  }
+
+  texture.buffer = RasterView(std::move(pixels), stack.width, stack.height);
+  TextureStatistics::ComputeRange(texture.buffer, texture.dataRange);
+  return texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TimeSeriesStack::SetCacheBudget(size_t bytes) {
+  StackCache.SetBudget(bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TimeSeriesStack::ClearCache() { StackCache.Clear(); }
@@ -0,0 +1,110 @@
+#ifndef VESTEC_TIME_SERIES_STACK
+#define VESTEC_TIME_SERIES_STACK
+
+#include "GDALReader.hpp"
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Time major copies of multi band rasters, e.g. the monthly layers of
+ * rome_monthly_mean_temp.tif. The GDALReader stores every layer as an image of
+ * its own, so the values of a single pixel are spread over one buffer per
+ * layer. A stack stores all layers of a pixel next to each other instead:
+ * value (x, y, step) is at ((y * width) + x) * steps + step. Reading the time
+ * series of a pixel and aggregating over time are sequential scans then.
+ *
+ * Stacks are built from the warped layers of the GDALReader, so they share its
+ * grid and bounds. The values are decoded floats, pixels without data are
+ * RASTER_NO_DATA. Stacks are cached within their own byte budget.
+ */
+class TimeSeriesStack {
+public:
+  /**
+   * Reduction of the time series of each pixel to a single value
+   */
+  enum class Aggregation {
+    Min,  //! Smallest valid value
+    Max,  //! Largest valid value
+    Mean, //! Mean of the valid values
+    Sum,  //! Sum of the valid values
+    Count //! Number of valid values
+  };
+
+  /**
+   * All layers of a file in time major order
+   */
+  struct Stack {
+    int width{};
+    int height{};
+    int steps{};                                   //! Layers per pixel
+    std::array<double, 4> lnglatBounds{};          //! Like the textures
+    std::vector<std::array<double, 2>> dataRanges; //! Range per layer
+    std::shared_ptr<const RasterBuffer> values;    //! Steps floats per pixel
+
+    /**
+     * Pointer to the steps values of a pixel
+     */
+    const float *Series(int x, int y) const;
+  };
+
+  /**
+   * Returns the stack of all layers of a file within the optional window. The
+   * layers are read with GDALReader::ReadAllLayers if the stack is not cached
+   * yet, which blocks until all of them are warped. Returns nullptr if the
+   * file cannot be read
+   */
+  static std::shared_ptr<const Stack>
+  Get(const std::string &filename,
+      std::optional<GDALReader::Window> const &window = {});
+
+  /**
+   * Builds a stack from textures of the same grid, one per time step. The
+   * textures are aligned if they were cropped differently. Returns nullptr
+   * if one of them is empty. The stack is not cached
+   */
+  static std::shared_ptr<const Stack>
+  Build(std::vector<GDALReader::GreyScaleTexture> textures);
+
+  /**
+   * Converts a position in radians to the pixel of the stack which contains
+   * it. Returns false if the position is outside of the stack
+   */
+  static bool GetPixel(Stack const &stack, double lng, double lat, int &x,
+                       int &y);
+
+  /**
+   * Copies the time series at a position in radians into series. Returns
+   * false if the position is outside of the stack
+   */
+  static bool ReadSeries(Stack const &stack, double lng, double lat,
+                         std::vector<float> &series);
+
+  /**
+   * Reduces the steps [firstStep, firstStep + steps) of every pixel to a
+   * single value. A negative number of steps includes all remaining steps.
+   * Pixels without a single valid value are RASTER_NO_DATA
+   */
+  static GDALReader::GreyScaleTexture Aggregate(Stack const &stack,
+                                                Aggregation aggregation,
+                                                int firstStep = 0,
+                                                int steps = -1);
+
+  /**
+   * Sets the maximum number of bytes held by cached stacks
+   */
+  static void SetCacheBudget(size_t bytes);
+
+  /**
+   * Removes all stacks from the cache
+   */
+  static void ClearCache();
+
+private:
+  static LRUCache<std::shared_ptr<const Stack>> StackCache;
+};
+
+#endif // VESTEC_TIME_SERIES_STACK
@@ -0,0 +1,165 @@
+#include "ZonalStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+bool IsNoData(float value) {
+  return std::isnan(value) || value == RASTER_NO_DATA;
+}
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ZonalStatistics::GetRowSpans(
+    std::vector<std::array<double, 2>> const &pixels, int width, int y,
+    std::vector<std::array<int, 2>> &spans) {
+  spans.clear();
+
+  // Crossings of the edges with the line through the pixel centers. Edges
+  // include their lower end only, so shared vertices are counted once
+  thread_local std::vector<double> crossings;
+  crossings.clear();
+  double center = y + 0.5;
+  size_t count = pixels.size();
+  for (size_t i = 0; i < count; ++i) {
+    auto const &from = pixels[i];
+    auto const &to = pixels[(i + 1) % count];
+    if ((from[1] <= center) == (to[1] <= center)) {
+      continue;
+    }
+    crossings.push_back(from[0] + (center - from[1]) * (to[0] - from[0]) /
+                                      (to[1] - from[1]));
+  }
+  std::sort(crossings.begin(), crossings.end());
+
+  // Pixels whose centers lie between two crossings are inside
+  for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+    int first = static_cast<int>(std::ceil(crossings[i] - 0.5));
+    int last = static_cast<int>(std::ceil(crossings[i + 1] - 0.5));
+    first = std::clamp(first, 0, width);
+    last = std::clamp(last, 0, width);
+    if (first < last) {
+      spans.push_back({first, last});
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ZonalStatistics::Compute(GDALReader::GreyScaleTexture const &texture,
+                              Polygon const &polygon,
+                              Statistics &statistics, int bins) {
+  RasterView const &view = texture.buffer;
+  if (!view || polygon.size() < 3 || bins <= 0) {
+    return false;
+  }
+
+  // The warped grid is a regular lng/lat grid, so the polygon is converted to
+  // pixels once
+  int width = view.Width();
+  int height = view.Height();
+  auto const &bounds = texture.lnglatBounds;
+  double lngPerPixel = (bounds[2] - bounds[0]) / width;
+  double latPerPixel = (bounds[3] - bounds[1]) / height;
+
+  std::vector<std::array<double, 2>> pixels;
+  double minX = std::numeric_limits<double>::max();
+  double maxX = std::numeric_limits<double>::lowest();
+  double minY = std::numeric_limits<double>::max();
+  double maxY = std::numeric_limits<double>::lowest();
+  for (auto const &vertex : polygon) {
+    double x = (vertex[0] - bounds[0]) / lngPerPixel;
+    double y = (vertex[1] - bounds[1]) / latPerPixel;
+    pixels.push_back({x, y});
+    minX = std::min(minX, x);
+    maxX = std::max(maxX, x);
+    minY = std::min(minY, y);
+    maxY = std::max(maxY, y);
+  }
+
+  Statistics result;
+  result.histogramRange = texture.dataRange;
+  result.histogram.assign(bins, 0);
+  result.min = std::numeric_limits<float>::max();
+  result.max = std::numeric_limits<float>::lowest();
+
+  // Only the bounding box of the polygon is scanned and decoded
+  int firstRow = std::clamp(static_cast<int>(std::floor(minY)), 0, height);
+  int lastRow = std::clamp(static_cast<int>(std::ceil(maxY)), 0, height);
+  int firstColumn = std::clamp(static_cast<int>(std::floor(minX)), 0, width);
+  int lastColumn = std::clamp(static_cast<int>(std::ceil(maxX)), 0, width);
+
+  double binScale = 0.0;
+  if (result.histogramRange[1] > result.histogramRange[0]) {
+    binScale = bins / (result.histogramRange[1] - result.histogramRange[0]);
+  }
+
+  if (firstRow < lastRow && firstColumn < lastColumn) {
+    RasterView region = view.SubRect(firstColumn, firstRow,
+                                     lastColumn - firstColumn,
+                                     lastRow - firstRow);
+
+#pragma omp parallel
+    {
+      Statistics partial;
+      partial.histogram.assign(bins, 0);
+      partial.min = result.min;
+      partial.max = result.max;
+      std::vector<float> row(region.Width());
+      std::vector<std::array<int, 2>> spans;
+
+#pragma omp for schedule(dynamic, 16)
+      for (int y = firstRow; y < lastRow; ++y) {
+        GetRowSpans(pixels, width, y, spans);
+        if (spans.empty()) {
+          continue;
+        }
+
+        region.DecodeRow(y - firstRow, row.data());
+        for (auto const &span : spans) {
+          partial.pixels += span[1] - span[0];
+          for (int x = span[0]; x < span[1]; ++x) {
+            float value = row[x - firstColumn];
+            if (IsNoData(value)) {
+              continue;
+            }
+            ++partial.validPixels;
+            partial.sum += value;
+            partial.min = std::min(partial.min, value);
+            partial.max = std::max(partial.max, value);
+
+            int bin = static_cast<int>(
+                (value - result.histogramRange[0]) * binScale);
+            ++partial.histogram[std::clamp(bin, 0, bins - 1)];
+          }
+        }
+      }
+
+#pragma omp critical
+      {
+        result.pixels += partial.pixels;
+        result.validPixels += partial.validPixels;
+        result.sum += partial.sum;
+        result.min = std::min(result.min, partial.min);
+        result.max = std::max(result.max, partial.max);
+        for (int bin = 0; bin < bins; ++bin) {
+          result.histogram[bin] += partial.histogram[bin];
+        }
+      }
+    }
+  }
+
+  if (result.validPixels > 0) {
+    result.mean = result.sum / result.validPixels;
+  } else {
+    result.min = 0.F;
+    result.max = 0.F;
+  }
+
+  statistics = std::move(result);
+  return true;
+}
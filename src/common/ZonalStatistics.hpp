@@ -0,0 +1,56 @@
+#ifndef VESTEC_ZONAL_STATISTICS
+#define VESTEC_ZONAL_STATISTICS
+
+#include "GDALReader.hpp"
+
+#include <array>
+#include <vector>
+
+/**
+ * Statistics of the pixels of a texture within a polygon, e.g. the total
+ * population at risk within the incident area drawn with the
+ * IncidentsBoundsTool. A pixel is within the polygon if its center is (even
+ * odd rule). The polygon is rasterized with scanlines, the rows are processed
+ * in parallel and only the columns between the crossings of a row are
+ * decoded, so the statistics can be updated while a corner is dragged.
+ *
+ * Polygon vertices are longitude and latitude in radians, the polygon is
+ * closed implicitly. Pixels which decode to RASTER_NO_DATA or NaN are counted
+ * but not included in the values.
+ */
+class ZonalStatistics {
+public:
+  using Polygon = std::vector<std::array<double, 2>>;
+
+  struct Statistics {
+    size_t pixels{};      //! Pixels within the polygon
+    size_t validPixels{}; //! Pixels within the polygon which have data
+    double sum{};
+    double mean{};
+    float min{};
+    float max{};
+    std::array<double, 2> histogramRange{}; //! The data range of the texture
+    std::vector<size_t> histogram; //! Valid pixels per equally sized bin
+  };
+
+  /**
+   * Computes the statistics of the pixels within the polygon. The histogram
+   * covers the data range of the texture, so that the bins stay the same
+   * while the polygon changes. Returns false if the texture is empty or the
+   * polygon has less than three vertices
+   */
+  static bool Compute(GDALReader::GreyScaleTexture const &texture,
+                      Polygon const &polygon, Statistics &statistics,
+                      int bins = 32);
+
+  /**
+   * Returns the pixel ranges [first, last) of a row of the texture whose
+   * centers are within the polygon. The polygon is given in pixels of the
+   * texture, the ranges are ordered from left to right
+   */
+  static void GetRowSpans(std::vector<std::array<double, 2>> const &pixels,
+                          int width, int y,
+                          std::vector<std::array<int, 2>> &spans);
+};
+
+#endif // VESTEC_ZONAL_STATISTICS